@@ -85,6 +85,11 @@ namespace Tags
     const Identifier globalMidiPrograms = "globalMidiPrograms";
     const Identifier midiProgramsState  = "midiProgramsState";
     const Identifier renderMode         = "renderMode";
+    const Identifier multiCore          = "multiCore";
+    const Identifier skipSilence        = "skipSilence";
+    const Identifier renderQuantum      = "renderQuantum";
+    const Identifier renderAhead        = "renderAhead";
+    const Identifier pipelineStages     = "pipelineStages";
 
     const Identifier vertical           = "vertical";
     const Identifier staticPos          = "staticPos";
@@ -25,6 +25,7 @@
 #include "session/Session.h"
 #include "Settings.h"
 #include "URIs.h"
+#include "Utils.h"
 #include "session/CommandManager.h"
 #include "Globals.h"
 
@@ -32,16 +33,31 @@ namespace Element {
 
 static void buildCommandLine (CommandLine& cli, const String& c)
 {
-    cli.fullScreen = c.contains ("--full-screen");
-    const var port = c.fromFirstOccurrenceOf("--port=", false, false)
-                      .upToFirstOccurrenceOf(" ", false, false);
-    if (port.isInt() || port.isInt64())
-        cli.port = (int) port;
+    // whole arguments only, so a quoted path can't switch anything on
+    StringArray args;
+    args.addTokens (c, true);
+    args.trim();
+    args.removeEmptyStrings();
+
+    cli.fullScreen = args.contains ("--full-screen");
+    cli.render = args.contains ("--render");
+    cli.headless = cli.render || args.contains ("--headless");
+
+    for (const auto& arg : args)
+    {
+        if (! arg.startsWith ("--port="))
+            continue;
+        const String port = arg.fromFirstOccurrenceOf ("=", false, false);
+        if (port.isNotEmpty() && port.containsOnly ("0123456789"))
+            cli.port = port.getIntValue();
+    }
 }
 
 CommandLine::CommandLine (const String& c)
     : fullScreen (false),
       port (3123),
+      render (false),
+      headless (false),
       commandLine (c)
 {
     if (c.isNotEmpty())
@@ -103,6 +119,7 @@ Globals::Globals (const String& _cli)
       cli (_cli)
 {
     appName = "Element";
+    Util::setHeadless (cli.headless);
     impl = new Impl (*this);
     impl->init();
 }
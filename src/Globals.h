@@ -41,6 +41,8 @@ struct CommandLine
     explicit CommandLine (const String& cli = String());
     bool fullScreen;
     int port;
+    bool render;    ///< render a session or graph to a file and quit, see OfflineRenderer
+    bool headless;  ///< run without any GUI, implied by render
     
     const String commandLine;
 };
@@ -18,10 +18,12 @@
 
 #include "ElementApp.h"
 #include "controllers/AppController.h"
+#include "controllers/EngineController.h"
 #include "controllers/GraphController.h"
 #include "controllers/SessionController.h"
 #include "engine/InternalFormat.h"
 #include "engine/GraphProcessor.h"
+#include "engine/OfflineRenderer.h"
 #include "session/DeviceManager.h"
 #include "session/PluginManager.h"
 #include "Commands.h"
@@ -85,6 +87,13 @@ public:
         }
     }
 
+    /** Sets up the engine, plugins and controllers without opening audio
+        devices or sending "finishedLaunching", for rendering offline */
+    void launchWithoutDevices()
+    {
+        run();
+    }
+
     ScopedPointer<AppController> controller;
     
     const bool isUsingThread() const { return usingThread; }
@@ -236,6 +245,14 @@ public:
         world = new Globals (commandLine);
         if (maybeLaunchSlave (commandLine))
             return;
+
+        if (world->cli.render)
+        {
+            initializeModulePath();
+            setApplicationReturnValue (renderFromCommandLine());
+            quit();
+            return;
+        }
         
         if (sendCommandLineToPreexistingInstance())
         {
@@ -269,16 +286,21 @@ public:
         auto* props = settings.getUserSettings();
         plugins.setPropertiesFile (nullptr); // must be done before Settings is deleted
 
-        controller->saveSettings();
+        // an offline render leaves the user's settings alone
+        if (! world->cli.render)
+            controller->saveSettings();
         controller->deactivate();
         
-        plugins.saveUserPlugins (settings);
-        midi.writeSettings (settings);
+        if (! world->cli.render)
+        {
+            plugins.saveUserPlugins (settings);
+            midi.writeSettings (settings);
         
-        if (ScopedXml el = world->getDeviceManager().createStateXml())
-            props->setValue ("devices", el);
-        if (ScopedXml keymappings = world->getCommandManager().getKeyMappings()->createXml (true))
-            props->setValue ("keymappings", keymappings.get());
+            if (ScopedXml el = world->getDeviceManager().createStateXml())
+                props->setValue ("devices", el);
+            if (ScopedXml keymappings = world->getCommandManager().getKeyMappings()->createXml (true))
+                props->setValue ("keymappings", keymappings.get());
+        }
 
         engine = nullptr;
         controller = nullptr;
@@ -291,7 +313,8 @@ public:
 
     void systemRequestedQuit() override
     {
-        if (! controller)
+        // nobody to answer a save prompt when headless
+        if (! controller || world->cli.headless)
         {
             Application::quit();
             return;
@@ -388,14 +411,14 @@ public:
         controller->run();
 
        #ifndef EL_FREE
-        if (world->getSettings().checkForUpdates())
+        if (! world->cli.headless && world->getSettings().checkForUpdates())
             CurrentVersion::checkAfterDelay (12 * 1000, false);
        #endif
 
        #if EL_PRO
         if (auto* sc = controller->findChild<SessionController>())
         {
-            const auto path = world->cli.commandLine.unquoted().trim();
+            const auto path = getPathArgument (world->cli.commandLine);
             if (File::isAbsolutePath (path))
             {
                 const File file (path);
@@ -413,6 +436,17 @@ private:
     ScopedPointer<Startup>          startup;
     OwnedArray<kv::ChildProcessSlave>   slaves;
     
+    /** Returns the first argument which isn't an option, e.g. a session file */
+    static String getPathArgument (const String& commandLine)
+    {
+        StringArray args;
+        args.addTokens (commandLine, true);
+        for (const auto& arg : args)
+            if (! arg.startsWith ("-"))
+                return arg.unquoted().trim();
+        return String();
+    }
+
     void loadLicense()
     {
     
@@ -480,6 +514,68 @@ private:
         return false;
     }
     
+    /** Handles `element --render`. Returns the process exit code */
+    int renderFromCommandLine()
+    {
+        File source;
+        OfflineRenderer::Options options;
+        const auto parsed = OfflineRenderer::parseCommandLine (world->cli.commandLine, source, options);
+        if (parsed.failed())
+        {
+            Logger::writeToLog ("[EL] " + parsed.getErrorMessage());
+            return 1;
+        }
+
+        startup = new Startup (*world, false, false);
+        startup->launchWithoutDevices();
+        controller = startup->controller.release();
+        startup = nullptr;
+        controller->activate();
+
+        if (source.hasFileExtension ("els"))
+        {
+            if (auto* sc = controller->findChild<SessionController>())
+                sc->openFile (source);
+        }
+        else if (auto* gc = controller->findChild<GraphController>())
+        {
+            gc->openGraph (source);
+        }
+
+        // run what the controllers posted while loading, until the graphs
+        // are loaded and compiled
+        if (auto* ec = controller->findChild<EngineController>())
+        {
+            const uint32 timeout = Time::getMillisecondCounter() + 30000;
+            while (! ec->isReadyToRender())
+            {
+                if (Time::getMillisecondCounter() > timeout)
+                {
+                    Logger::writeToLog ("[EL] graphs didn't finish loading");
+                    return 1;
+                }
+
+                MessageManager::getInstance()->runDispatchLoopUntil (10);
+            }
+        }
+
+        OfflineRenderer renderer (*world->getAudioEngine());
+        const auto result = renderer.render (options);
+        if (result.failed())
+        {
+            Logger::writeToLog ("[EL] render failed: " + result.getErrorMessage());
+            return 1;
+        }
+
+        const auto& stats = renderer.getStats();
+        String message ("[EL] rendered ");
+        message << String ((double) stats.numSamples / stats.sampleRate, 2) << " s in "
+                << String (stats.renderSeconds, 2) << " s ("
+                << String (stats.getRealtimeFactor(), 1) << "x realtime)";
+        Logger::writeToLog (message);
+        return 0;
+    }
+
     void launchApplication()
     {
         if (nullptr != controller)
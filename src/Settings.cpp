@@ -38,6 +38,8 @@ const char* Settings::lastGraphKey              = "lastGraph";
 const char* Settings::legacyInterfaceKey        = "legacyInterface";
 const char* Settings::workspaceKey              = "workspace";
 const char* Settings::midiEngineKey             = "midiEngine";
+const char* Settings::loadGraphsOnDemandKey     = "loadGraphsOnDemand";
+const char* Settings::graphMemoryBudgetKey      = "graphMemoryBudget";
 
 enum OptionsMenuItemId
 {
@@ -296,6 +298,34 @@ void Settings::setUseLegacyInterface (const bool useLegacy)
         p->setValue (legacyInterfaceKey, useLegacy);
 }
 
+bool Settings::loadGraphsOnDemand() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (loadGraphsOnDemandKey, false);
+    return false;
+}
+
+void Settings::setLoadGraphsOnDemand (const bool onDemand)
+{
+    if (onDemand == loadGraphsOnDemand())
+        return;
+    if (auto* p = getProps())
+        p->setValue (loadGraphsOnDemandKey, onDemand);
+}
+
+int Settings::getGraphMemoryBudget() const
+{
+    if (auto* p = getProps())
+        return jmax (0, p->getIntValue (graphMemoryBudgetKey, 0));
+    return 0;
+}
+
+void Settings::setGraphMemoryBudget (const int megabytes)
+{
+    if (auto* p = getProps())
+        p->setValue (graphMemoryBudgetKey, jmax (0, megabytes));
+}
+
 void Settings::setWorkspace (const String& name)
 {
     if (getWorkspace() == name)
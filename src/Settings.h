@@ -47,6 +47,8 @@ public:
     static const char* legacyInterfaceKey;
     static const char* workspaceKey;
     static const char* midiEngineKey;
+    static const char* loadGraphsOnDemandKey;
+    static const char* graphMemoryBudgetKey;
 
     XmlElement* getLastGraph() const;
     void setLastGraph (const ValueTree& data);
@@ -100,6 +102,22 @@ public:
     void setUseLegacyInterface (const bool);
     bool useLegacyInterface() const;
 
+    /** True if a session's graphs are loaded when selected instead of all at once */
+    void setLoadGraphsOnDemand (const bool);
+    bool loadGraphsOnDemand() const;
+
+    /** Megabytes graphs loaded on demand may use before cold ones are unloaded.
+        0 means no limit.
+
+        A graph's size is only an estimate: the change in the process's
+        resident memory while it loads, or the length of its saved state where
+        that can't be measured, as on Windows. Memory plugins allocate later,
+        or share between instances, isn't counted, and the state length can
+        be far from what a plugin really uses. Treat the budget as a rough
+        limit. */
+    void setGraphMemoryBudget (const int megabytes);
+    int getGraphMemoryBudget() const;
+
     void setWorkspace (const String& name);
     String getWorkspace() const;
     File getWorkspaceFile() const;
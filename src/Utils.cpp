@@ -38,4 +38,20 @@ StringArray getFullVesrionPluginIdentifiers()
     };
 }
 
+static bool headless = false;
+
+void setHeadless (const bool isHeadless)    { headless = isHeadless; }
+bool isHeadless()                           { return headless; }
+
+void showAlert (const AlertWindow::AlertIconType icon, const String& title,
+                const String& message, const bool async)
+{
+    if (headless)
+        Logger::writeToLog (title + ": " + message);
+    else if (async)
+        AlertWindow::showMessageBoxAsync (icon, title, message);
+    else
+        AlertWindow::showMessageBox (icon, title, message);
+}
+
 }}
@@ -91,5 +91,16 @@ inline static bool isGmailExtended (const String& email)
 
 StringArray getFullVesrionPluginIdentifiers();
 
+/** Set when running without a GUI, see CommandLine::headless */
+void setHeadless (bool isHeadless);
+
+/** Returns true when running without a GUI */
+bool isHeadless();
+
+/** Tells the user about something. Shows an alert window, modal unless async
+    is true, when there is a GUI. Otherwise writes it to the log */
+void showAlert (AlertWindow::AlertIconType icon, const String& title,
+                const String& message, bool async = true);
+
 }
 }
@@ -47,7 +47,8 @@ Settings& AppController::Child::getSettings()           { return getWorld().getS
 AppController::AppController (Globals& g)
     : world (g)
 {
-    addChild (new GuiController (g, *this));
+    if (! g.cli.headless)
+        addChild (new GuiController (g, *this));
     addChild (new DevicesController());
     addChild (new EngineController());
     addChild (new MappingController());
@@ -55,15 +56,18 @@ AppController::AppController (Globals& g)
     addChild (new SessionController());
     addChild (new GraphController());
     addChild (new ScriptingController());
-    addChild (new WorkspacesController());
+    if (! g.cli.headless)
+        addChild (new WorkspacesController());
 
     lastExportedGraph = DataPath::defaultGraphDir();
 
     auto& commands = getWorld().getCommandManager();
     commands.registerAllCommandsForTarget (this);
    #if 1
-    commands.registerAllCommandsForTarget (findChild<GuiController>());
-    commands.registerAllCommandsForTarget (findChild<WorkspacesController>());
+    if (auto* gui = findChild<GuiController>())
+        commands.registerAllCommandsForTarget (gui);
+    if (auto* workspaces = findChild<WorkspacesController>())
+        commands.registerAllCommandsForTarget (workspaces);
    #else
     // can't do this yet until all controllers have a reliable way to
     // return the next command target
@@ -182,7 +186,7 @@ void AppController::handleMessage (const Message& msg)
     auto* devs      = findChild<DevicesController>();
     auto* maps      = findChild<MappingController>();
     auto* presets   = findChild<PresetsController>();
-	jassert(ec && gui && sess && devs && maps && presets);
+	jassert(ec && sess && devs && maps && presets); // gui is null when headless
 
     bool handled = false; // final else condition will set false
     
@@ -196,7 +200,8 @@ void AppController::handleMessage (const Message& msg)
             for (auto* action : actions)
                 undo.perform (action);
             actions.clearQuick (false);
-            gui->stabilizeViews();
+            if (gui != nullptr)
+                gui->stabilizeViews();
             return;
         }
 
@@ -330,7 +335,8 @@ void AppController::handleMessage (const Message& msg)
     {
         const auto controllerMap = removeMapMessage->controllerMap;
         maps->remove (controllerMap);
-        gui->stabilizeViews();
+        if (gui != nullptr)
+            gui->stabilizeViews();
     }
     else if (const auto* replaceNodeMessage = dynamic_cast<const ReplaceNodeMessage*> (&msg))
     {
@@ -400,7 +406,8 @@ void AppController::getAllCommands (Array<CommandID>& cids)
 
 void AppController::getCommandInfo (CommandID commandID, ApplicationCommandInfo& result)
 {
-    findChild<GuiController>()->getCommandInfo (commandID, result);
+    if (auto* gui = findChild<GuiController>())
+        gui->getCommandInfo (commandID, result);
     // for (auto* const child : getChildren())
     //     if (auto* const appChild = dynamic_cast<AppController::Child*> (child))
     //         appChild->getCommandInfo (commandID, result);
@@ -415,17 +422,23 @@ bool AppController::perform (const InvocationInfo& info)
         case Commands::undo: {
             if (undo.canUndo())
                 undo.undo();
-            if (auto* cc = findChild<GuiController>()->getContentComponent())
-                cc->stabilizeViews();
-            findChild<GuiController>()->refreshMainMenu();
+            if (auto* gui = findChild<GuiController>())
+            {
+                if (auto* cc = gui->getContentComponent())
+                    cc->stabilizeViews();
+                gui->refreshMainMenu();
+            }
         } break;
         
         case Commands::redo: {
             if (undo.canRedo())
                 undo.redo();
-            if (auto* cc = findChild<GuiController>()->getContentComponent())
-                cc->stabilizeViews();
-            findChild<GuiController>()->refreshMainMenu();
+            if (auto* gui = findChild<GuiController>())
+            {
+                if (auto* cc = gui->getContentComponent())
+                    cc->stabilizeViews();
+                gui->refreshMainMenu();
+            }
         } break;
 
         case Commands::sessionOpen:
@@ -584,8 +597,12 @@ void AppController::checkForegroundStatus()
             if (! app.getWorld().getSettings().hidePluginWindowsWhenFocusLost())
                 return;
 
+            auto* const guiPtr = app.findChild<GuiController>();
+            if (guiPtr == nullptr)
+                return;
+
             auto session  = app.getWorld().getSession();
-            auto& gui     = *app.findChild<GuiController>();
+            auto& gui     = *guiPtr;
             const Node graph (session->getCurrentGraph());
             jassert (session);
             if (foreground)
@@ -20,6 +20,7 @@
 #include "ElementApp.h"
 #include "controllers/AppController.h"
 #include "controllers/GuiController.h"
+#include "controllers/GraphLoadPolicy.h"
 #include "controllers/GraphManager.h"
 #include "engine/nodes/MidiDeviceProcessor.h"
 
@@ -29,6 +30,7 @@
 #include "session/Node.h"
 #include "Globals.h"
 #include "Settings.h"
+#include "Utils.h"
 
 #include "controllers/EngineController.h"
 
@@ -55,8 +57,9 @@ struct RootGraphHolder
 
     /** This will create a root graph processor/controller and load it if not
         done already. Properties are set from the model, so make sure they are
-        correct before calling this */
-    bool attach (AudioEnginePtr engine)
+        correct before calling this. If loadNodes is false the graph is added
+        to the engine empty, see load() */
+    bool attach (AudioEnginePtr engine, const bool loadNodes = true)
     {
         jassert (engine);
         if (! engine)
@@ -73,10 +76,20 @@ struct RootGraphHolder
             const auto mode = modeStr == "single" ? RootGraph::SingleGraph : RootGraph::Parallel;
             const auto channels = model.getMidiChannels();
             const auto program = (int) model.getProperty ("midiProgram", -1);
+            const bool multiCore = (bool) model.getProperty (Tags::multiCore, false);
+            const bool skipSilence = (bool) model.getProperty (Tags::skipSilence, false);
+            const int renderQuantum = (int) model.getProperty (Tags::renderQuantum, 0);
+            const bool renderAhead = (bool) model.getProperty (Tags::renderAhead, false);
+            const int pipelineStages = (int) model.getProperty (Tags::pipelineStages, 1);
 
             root->setLocked (false);
             root->setPlayConfigFor (devices);
             root->setRenderMode (mode);
+            root->setMultiCoreRendering (multiCore);
+            root->setSilentNodeSkipping (skipSilence);
+            root->setRenderQuantum (renderQuantum);
+            root->setAnticipativeRendering (renderAhead);
+            root->setPipelineStages (pipelineStages);
             root->setMidiChannels (channels);
             root->setMidiProgram (program);
 
@@ -84,8 +97,8 @@ struct RootGraphHolder
             {
                 controller = new RootGraphManager (*root, plugins);
                 model.setProperty (Tags::object, node.get());
-                controller->setNodeModel (model);
-                resetIONodePorts();
+                if (loadNodes)
+                    load();
             }
         }
         
@@ -113,6 +126,37 @@ struct RootGraphHolder
         return wasRemoved;
     }
     
+    /** Creates the nodes of an attached graph if not done already */
+    void load()
+    {
+        if (! attached() || controller->isLoaded())
+            return;
+
+        const int64 memoryBefore = GraphLoadPolicy::getResidentMemory();
+        controller->getRootGraph().setPlayConfigFor (devices);
+        controller->setNodeModel (model);
+        resetIONodePorts();
+
+        memoryBytes = GraphLoadPolicy::getResidentMemory() - memoryBefore;
+        if (memoryBytes <= 0)
+            memoryBytes = getStateSize (model.getValueTree());
+    }
+
+    /** Deletes the nodes of a loaded graph, keeping their state in the model */
+    void unload()
+    {
+        if (isLoaded())
+            controller->unloadGraph();
+    }
+
+    bool isLoaded() const { return attached() && controller->isLoaded(); }
+
+    /** True if the graph can be heard whichever graph is active */
+    bool isParallel() const
+    {
+        return model.getProperty (Tags::renderMode, "single").toString().trim().toLowerCase() != "single";
+    }
+
     RootGraphManager* getController() const { return controller; }
     RootGraph* getRootGraph() const { return dynamic_cast<RootGraph*> (node ? node->getAudioProcessor() : nullptr); }
     
@@ -138,15 +182,26 @@ private:
     ScopedPointer<RootGraphManager>  controller;
     Node                                model;
     GraphNodePtr                        node;
+    int64                               lastUsed = 0;
+    int64                               memoryBytes = 0;
+
+    /** Rough size of a graph where process memory can't be measured */
+    static int64 getStateSize (const ValueTree& tree)
+    {
+        int64 size = tree.getProperty (Tags::state).toString().length();
+        for (int i = tree.getNumChildren(); --i >= 0;)
+            size += getStateSize (tree.getChild (i));
+        return size;
+    }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RootGraphHolder);
 };
 
-class EngineController::RootGraphs
+class EngineController::RootGraphs : private Timer
 {
 public:
     RootGraphs (EngineController& e) : owner (e) { }
-    ~RootGraphs() { }
+    ~RootGraphs() { stopTimer(); }
     
     RootGraphHolder* add (RootGraphHolder* item)
     {
@@ -156,9 +211,35 @@ public:
     
     void clear()
     {
+        stopTimer();
         detachAll();
         graphs.clear();
     }
+
+    /** Marks a graph as just used */
+    void touch (RootGraphHolder* holder) { holder->lastUsed = ++useCounter; }
+
+    /** Unloads cold graphs which don't fit in the memory budget, then starts
+        prefetching the neighbours of the active graph */
+    void updateLoadedGraphs (RootGraphHolder* active)
+    {
+        auto& settings = owner.getWorld().getSettings();
+        policy.setMemoryBudget ((int64) settings.getGraphMemoryBudget() * 1024 * 1024);
+
+        const auto states = getLoadStates();
+        for (const int index : policy.findGraphsToUnload (states, graphs.indexOf (active)))
+        {
+            auto* const holder = graphs.getUnchecked (index);
+            if (auto* gui = owner.findSibling<GuiController>())
+                for (int i = holder->model.getNumNodes(); --i >= 0;)
+                    gui->closePluginWindowsFor (holder->model.getNode (i), true);
+            holder->unload();
+            DBG("[EL] graph unloaded: " << holder->model.getName());
+        }
+
+        prefetchFor = active;
+        startTimer (prefetchInterval);
+    }
     
     /** This is recursive! */
     GraphManager* findSubGraphManager (GraphManager* parent, const Node& n)
@@ -289,6 +370,8 @@ public:
     // remove the holder, this will also delete it!
     void remove (RootGraphHolder* g)
     {
+        if (g == prefetchFor)
+            prefetchFor = nullptr;
         graphs.removeObject (g, true);
     }
     
@@ -299,6 +382,46 @@ private:
     SessionPtr session;
     AudioEnginePtr engine;
     OwnedArray<RootGraphHolder> graphs;
+    GraphLoadPolicy policy;
+    RootGraphHolder* prefetchFor = nullptr;
+    int64 useCounter = 0;
+
+    // plugins are created on the message thread, one graph per tick keeps it responsive
+    static const int prefetchInterval = 100;
+
+    Array<GraphLoadPolicy::Graph> getLoadStates() const
+    {
+        Array<GraphLoadPolicy::Graph> states;
+        for (const auto* const holder : graphs)
+        {
+            GraphLoadPolicy::Graph state;
+            state.midiProgram   = (int) holder->model.getProperty ("midiProgram", -1);
+            state.loaded        = holder->isLoaded();
+            state.pinned        = holder->isParallel();
+            state.lastUsed      = holder->lastUsed;
+            state.memoryBytes   = holder->memoryBytes;
+            states.add (state);
+        }
+        return states;
+    }
+
+    void timerCallback() override
+    {
+        stopTimer();
+        const int active = graphs.indexOf (prefetchFor);
+        if (active < 0)
+            return;
+
+        const auto prefetch = policy.findGraphsToPrefetch (getLoadStates(), active);
+        if (prefetch.isEmpty())
+            return;
+
+        auto* const holder = graphs.getUnchecked (prefetch.getFirst());
+        holder->load();
+        DBG("[EL] graph prefetched: " << holder->model.getName());
+        if (prefetch.size() > 1)
+            startTimer (prefetchInterval);
+    }
 };
 
 EngineController::EngineController()
@@ -337,7 +460,8 @@ void EngineController::addGraph()
     Node node (Node::createDefaultGraph ("Graph " + String(session->getNumGraphs() + 1)));
     addGraph (node);
     
-    findSibling<GuiController>()->stabilizeContent();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeContent();
 }
 
 void EngineController::addGraph (const Node& newGraph)
@@ -352,7 +476,7 @@ void EngineController::addGraph (const Node& newGraph)
 
     if (err.isNotEmpty())
     {
-        AlertWindow::showMessageBoxAsync (AlertWindow::InfoIcon, "Audio Engine", err);
+        Util::showAlert (AlertWindow::InfoIcon, "Audio Engine", err);
         return;
     }
 
@@ -375,10 +499,11 @@ void EngineController::addGraph (const Node& newGraph)
     
     if (err.isNotEmpty())
     {
-        AlertWindow::showMessageBoxAsync (AlertWindow::InfoIcon, "Audio Engine", err);
+        Util::showAlert (AlertWindow::InfoIcon, "Audio Engine", err);
     }
 
-    findSibling<GuiController>()->stabilizeContent();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeContent();
 }
 
 void EngineController::duplicateGraph (const Node& graph)
@@ -461,7 +586,8 @@ void EngineController::removeGraph (int index)
         DBG("[EL] could not find root graph index: " << index);
     }
     
-    findSibling<GuiController>()->stabilizeContent();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeContent();
 }
 
 void EngineController::connectChannels (const uint32 s, const int sc, const uint32 d, const int dc)
@@ -514,12 +640,13 @@ void EngineController::addNode (const Node& node)
     {
         const Node actual (root->getNodeModelForId (nodeId));
         if (getWorld().getSettings().showPluginWindowsWhenAdded())
-            findSibling<GuiController>()->presentPluginWindow (actual);
+            if (auto* gui = findSibling<GuiController>())
+                gui->presentPluginWindow (actual);
     }
     else
     {
-        AlertWindow::showMessageBox (AlertWindow::InfoIcon,
-            "Audio Engine", String("Could not add node: ") + node.getName());
+        Util::showAlert (AlertWindow::InfoIcon,
+            "Audio Engine", String("Could not add node: ") + node.getName(), false);
     }
 }
 
@@ -552,13 +679,14 @@ void EngineController::addPlugin (const PluginDescription& desc, const bool veri
         {
             const Node node (root->getNodeModelForId (nodeId));
             if (getWorld().getSettings().showPluginWindowsWhenAdded())
-                findSibling<GuiController>()->presentPluginWindow (node);
+                if (auto* gui = findSibling<GuiController>())
+                    gui->presentPluginWindow (node);
         }
     }
     else
     {
-        AlertWindow::showMessageBoxAsync (AlertWindow::NoIcon, "Add Plugin",
-                                          String("Could not add ") + desc.name + " for an unknown reason");
+        Util::showAlert (AlertWindow::NoIcon, "Add Plugin",
+                         String("Could not add ") + desc.name + " for an unknown reason");
     }
 }
 
@@ -635,11 +763,14 @@ void EngineController::activate()
 
     sessionReloaded();
     devices.addChangeListener (this);
+    activeGraphConnection = engine->activeGraphChanged.connect (
+        std::bind (&EngineController::onActiveGraphChanged, this));
 }
 
 void EngineController::deactivate()
 {
     Controller::deactivate();
+    activeGraphConnection.disconnect();
     auto& globals (getWorld());
     auto& devices (globals.getDeviceManager());
     auto engine   (globals.getAudioEngine());
@@ -688,7 +819,6 @@ void EngineController::setRootNode (const Node& newRootNode)
     
     auto engine   = getWorld().getAudioEngine();
     auto session  = getWorld().getSession();
-    auto& devices = getWorld().getDeviceManager();
     
     if (! holder->attached())
         holder->attach (engine);
@@ -726,15 +856,13 @@ void EngineController::setRootNode (const Node& newRootNode)
         DBG("[EL] couldn't find graph processor for node.");
     }
     
-    if (auto* const r = holder->getController())
+    if (holder->getController() != nullptr)
     {
-        if (! r->isLoaded())
-        {
-            r->getRootGraph().setPlayConfigFor (devices);
-            r->setNodeModel (newRootNode);
-        }
-        
+        holder->load();
         engine->setCurrentGraph (index);
+        graphs->touch (holder);
+        if (getWorld().getSettings().loadGraphsOnDemand())
+            graphs->updateLoadedGraphs (holder);
     }
     else
     {
@@ -744,6 +872,20 @@ void EngineController::setRootNode (const Node& newRootNode)
     engine->refreshSession();
 }
 
+void EngineController::onActiveGraphChanged()
+{
+    if (! getWorld().getSettings().loadGraphsOnDemand())
+        return;
+
+    if (auto* holder = graphs->findActiveInEngine())
+    {
+        // a program change may have switched to a graph which isn't loaded
+        holder->load();
+        graphs->touch (holder);
+        graphs->updateLoadedGraphs (holder);
+    }
+}
+
 void EngineController::changeListenerCallback (ChangeBroadcaster* cb)
 {
     typedef GraphProcessor::AudioGraphIOProcessor IOP;
@@ -851,6 +993,7 @@ void EngineController::sessionReloaded()
 
     auto session = getWorld().getSession();
     auto engine  = getWorld().getAudioEngine();
+    const bool onDemand = getWorld().getSettings().loadGraphsOnDemand();
 
     if (session->getNumGraphs() > 0)
     {
@@ -859,7 +1002,9 @@ void EngineController::sessionReloaded()
             Node rootGraph (session->getGraph (i));
             if (auto* holder = graphs->add (new RootGraphHolder (rootGraph, getWorld())))
             {
-                holder->attach (engine);
+                // on demand, only parallel graphs load now: they're always heard.
+                // The active graph is loaded by setRootNode
+                holder->attach (engine, ! onDemand || holder->isParallel());
                 if (auto* const controller = holder->getController())
                 {
                     // noop: saving this logical block
@@ -871,6 +1016,23 @@ void EngineController::sessionReloaded()
     }
 }
 
+bool EngineController::isReadyToRender() const
+{
+    const auto* const active = graphs->findActive();
+    for (const auto* const holder : graphs->getGraphs())
+    {
+        if (holder != active && ! holder->isParallel())
+            continue;
+        if (! holder->isLoaded())
+            return false;
+        if (auto* const root = holder->getRootGraph())
+            if (root->isRenderingSequencePending())
+                return false;
+    }
+
+    return true;
+}
+
 Node EngineController::addPlugin (GraphManager& c, const PluginDescription& desc)
 {
     auto& plugins (getWorld().getPluginManager());
@@ -882,7 +1044,8 @@ Node EngineController::addPlugin (GraphManager& c, const PluginDescription& desc
         
         const Node node (c.getNodeModelForId (nodeId));
         if (getWorld().getSettings().showPluginWindowsWhenAdded())
-            findSibling<GuiController>()->presentPluginWindow (node);
+            if (auto* gui = findSibling<GuiController>())
+                gui->presentPluginWindow (node);
         if (!node.isValid())
         {
             jassertfalse; // fatal, but continue
@@ -970,7 +1133,8 @@ void EngineController::changeBusesLayout (const Node& n, const AudioProcessor::B
                 controller->removeIllegalConnections();
                 controller->syncArcsModel();
 
-                findSibling<GuiController>()->stabilizeViews();
+                if (auto* gui = findSibling<GuiController>())
+                    gui->stabilizeViews();
             }
         }
     }
@@ -1033,11 +1197,13 @@ void EngineController::replace (const Node& node, const PluginDescription& desc)
 
             removeNode (node);
             if (wasWindowOpen)
-                findSibling<GuiController>()->presentPluginWindow (newNode);
+                if (auto* gui = findSibling<GuiController>())
+                    gui->presentPluginWindow (newNode);
         }
     }
     
-    findSibling<GuiController>()->stabilizeViews();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeViews();
 }
 
 }
@@ -21,6 +21,7 @@
 
 #include "controllers/AppController.h"
 #include "session/Node.h"
+#include "Signals.h"
 
 namespace Element {
 
@@ -115,6 +116,9 @@ public:
     
     /** called when the session loads or re-loads */
     void sessionReloaded();
+
+    /** True once the graphs which can be heard are loaded and compiled */
+    bool isReadyToRender() const;
     
     /** replace a node with a given plugin */
     void replace (const Node&, const PluginDescription&);
@@ -126,6 +130,9 @@ private:
     class RootGraphs; friend class RootGraphs;
     ScopedPointer<RootGraphs> graphs;
     
+    SignalConnection activeGraphConnection;
+    void onActiveGraphChanged();
+
     friend class ChangeBroadcaster;
     void changeListenerCallback (ChangeBroadcaster*) override;
     Node addPlugin (GraphManager& controller, const PluginDescription& desc);
@@ -58,7 +58,8 @@ void GraphController::openDefaultGraph()
     graphChanged();
 
     refreshOtherControllers();
-    findSibling<GuiController>()->stabilizeContent();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeContent();
 }
 
 void GraphController::openGraph (const File& file)
@@ -76,21 +77,23 @@ void GraphController::openGraph (const File& file)
     
     if (result.wasOk())
     {
-        auto& gui = *findSibling<GuiController>();
+        auto* const gui = findSibling<GuiController>();
         GraphDocument::ScopedChangeStopper freeze (document, false);
-        findSibling<GuiController>()->closeAllPluginWindows();
+        if (gui != nullptr)
+            gui->closeAllPluginWindows();
         graphChanged();
         refreshOtherControllers();
 
         auto session = getWorld().getSession();
         
-        if (auto* const cc = gui.getContentComponent())
+        if (auto* const cc = gui != nullptr ? gui->getContentComponent() : nullptr)
         {
             auto ui = session->getValueTree().getOrCreateChildWithName (Tags::ui, nullptr);
             cc->applySessionState (ui.getProperty ("content").toString());
         }
 
-        findSibling<GuiController>()->stabilizeContent();
+        if (gui != nullptr)
+            gui->stabilizeContent();
     }
 }
 
@@ -101,10 +104,12 @@ void GraphController::loadGraph (const Node& graph)
     document.setFile (File());
 
     GraphDocument::ScopedChangeStopper freeze (document, false);
-    findSibling<GuiController>()->closeAllPluginWindows();
+    if (auto* gui = findSibling<GuiController>())
+        gui->closeAllPluginWindows();
     graphChanged();
     refreshOtherControllers();
-    findSibling<GuiController>()->stabilizeContent();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeContent();
 }
 
 void GraphController::newGraph()
@@ -123,7 +128,8 @@ void GraphController::newGraph()
     if (res == 1 || res == 2)
     {
         GraphDocument::ScopedChangeStopper freeze (document, false);
-        findSibling<GuiController>()->closeAllPluginWindows();
+        if (auto* gui = findSibling<GuiController>())
+            gui->closeAllPluginWindows();
 
         auto newGraph = Node::createDefaultGraph();
         document.setGraph (newGraph);
@@ -131,7 +137,8 @@ void GraphController::newGraph()
         graphChanged();
 
         refreshOtherControllers();
-        findSibling<GuiController>()->stabilizeContent();
+        if (auto* gui = findSibling<GuiController>())
+            gui->stabilizeContent();
     }
 }
 
@@ -139,9 +146,9 @@ void GraphController::saveGraph (const bool saveAs)
 {
     auto result = FileBasedDocument::userCancelledSave;
     auto session = getWorld().getSession();
-    auto& gui = *findSibling<GuiController>();
+    auto* const gui = findSibling<GuiController>();
 
-    if (auto* const cc = gui.getContentComponent())
+    if (auto* const cc = gui != nullptr ? gui->getContentComponent() : nullptr)
     {
         String state; cc->getSessionState (state);
         auto ui = session->getValueTree().getOrCreateChildWithName (Tags::ui, nullptr);
@@ -0,0 +1,164 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "controllers/GraphLoadPolicy.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+namespace Element {
+
+Array<int> GraphLoadPolicy::getProgramOrder (const Array<Graph>& graphs)
+{
+    Array<int> withProgram, withoutProgram;
+    for (int i = 0; i < graphs.size(); ++i)
+        (graphs.getReference(i).midiProgram >= 0 ? withProgram : withoutProgram).add (i);
+
+    std::stable_sort (withProgram.begin(), withProgram.end(), [&graphs] (int a, int b) {
+        return graphs.getReference(a).midiProgram < graphs.getReference(b).midiProgram;
+    });
+
+    withProgram.addArray (withoutProgram);
+    return withProgram;
+}
+
+Array<int> GraphLoadPolicy::findNeighbours (const Array<Graph>& graphs, const int active) const
+{
+    Array<int> neighbours;
+    const auto order = getProgramOrder (graphs);
+    const int position = order.indexOf (active);
+    if (position < 0)
+        return neighbours;
+
+    for (int distance = 1; distance <= numNeighbours; ++distance)
+    {
+        if (position + distance < order.size())
+            neighbours.add (order.getUnchecked (position + distance));
+        if (position - distance >= 0)
+            neighbours.add (order.getUnchecked (position - distance));
+    }
+
+    return neighbours;
+}
+
+Array<int> GraphLoadPolicy::findGraphsToPrefetch (const Array<Graph>& graphs, const int active) const
+{
+    Array<int> prefetch;
+    int64 total = getLoadedMemory (graphs);
+
+    for (const int index : findNeighbours (graphs, active))
+    {
+        if (graphs.getReference(index).loaded)
+            continue;
+
+        const int64 estimate = estimateMemory (graphs, index);
+        if (budget > 0 && total + estimate > budget)
+            break;
+        total += estimate;
+        prefetch.add (index);
+    }
+
+    return prefetch;
+}
+
+Array<int> GraphLoadPolicy::findGraphsToUnload (const Array<Graph>& graphs, const int active) const
+{
+    Array<int> unload;
+    int64 total = getLoadedMemory (graphs);
+    if (budget <= 0 || total <= budget)
+        return unload;
+
+    const auto neighbours = findNeighbours (graphs, active);
+    Array<int> candidates;
+    for (int i = 0; i < graphs.size(); ++i)
+    {
+        const auto& graph = graphs.getReference (i);
+        if (graph.loaded && ! graph.pinned && i != active && ! neighbours.contains (i))
+            candidates.add (i);
+    }
+
+    std::stable_sort (candidates.begin(), candidates.end(), [&graphs] (int a, int b) {
+        return graphs.getReference(a).lastUsed < graphs.getReference(b).lastUsed;
+    });
+
+    for (const int index : candidates)
+    {
+        if (total <= budget)
+            break;
+        total -= graphs.getReference(index).memoryBytes;
+        unload.add (index);
+    }
+
+    return unload;
+}
+
+int64 GraphLoadPolicy::getLoadedMemory (const Array<Graph>& graphs)
+{
+    int64 total = 0;
+    for (const auto& graph : graphs)
+        if (graph.loaded)
+            total += graph.memoryBytes;
+    return total;
+}
+
+int64 GraphLoadPolicy::estimateMemory (const Array<Graph>& graphs, const int index)
+{
+    if (graphs.getReference(index).memoryBytes > 0)
+        return graphs.getReference(index).memoryBytes;
+
+    // never loaded: assume it is about as big as the graphs that were
+    int64 total = 0; int numKnown = 0;
+    for (const auto& graph : graphs)
+    {
+        if (graph.memoryBytes > 0)
+        {
+            total += graph.memoryBytes;
+            ++numKnown;
+        }
+    }
+
+    return numKnown > 0 ? total / numKnown : 0;
+}
+
+int64 GraphLoadPolicy::getResidentMemory()
+{
+   #if JUCE_LINUX
+    long size = 0, resident = 0;
+    if (auto* const statm = fopen ("/proc/self/statm", "r"))
+    {
+        if (fscanf (statm, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        fclose (statm);
+    }
+    return (int64) resident * (int64) sysconf (_SC_PAGESIZE);
+   #elif JUCE_MAC
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+        return 0;
+    return (int64) info.resident_size;
+   #else
+    return 0;
+   #endif
+}
+
+}
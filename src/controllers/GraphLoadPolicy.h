@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Decides which root graphs stay loaded when graphs are loaded on demand.
+
+    Graphs are stepped through in MIDI program order. Neighbours of the active
+    graph in that order are prefetched, and the least recently used graphs are
+    unloaded while the loaded ones use more memory than the budget allows.
+ */
+class GraphLoadPolicy
+{
+public:
+    struct Graph
+    {
+        int midiProgram     = -1;       // RootGraph's program, -1 if none
+        bool loaded         = false;
+        bool pinned         = false;    // must stay loaded, e.g. parallel graphs
+        int64 lastUsed      = 0;        // larger is more recent
+        int64 memoryBytes   = 0;        // estimated when last loaded, 0 if unknown
+    };
+
+    GraphLoadPolicy() { }
+    ~GraphLoadPolicy() { }
+
+    /** Limit for the memory of all loaded graphs. 0 means no limit. Graph
+        sizes are estimates, see Settings::setGraphMemoryBudget() */
+    void setMemoryBudget (const int64 bytes) noexcept { budget = jmax ((int64) 0, bytes); }
+    int64 getMemoryBudget() const noexcept { return budget; }
+
+    /** Number of graphs on each side of the active one to keep warm */
+    void setNumNeighbours (const int num) noexcept { numNeighbours = jmax (0, num); }
+    int getNumNeighbours() const noexcept { return numNeighbours; }
+
+    /** Returns graph indexes in the order program changes step through them:
+        graphs with a program sorted by program, then the rest in session order */
+    static Array<int> getProgramOrder (const Array<Graph>& graphs);
+
+    /** Returns the neighbours of the active graph in program order, nearest first */
+    Array<int> findNeighbours (const Array<Graph>& graphs, const int active) const;
+
+    /** Returns unloaded neighbours of the active graph which fit in the budget,
+        nearest first */
+    Array<int> findGraphsToPrefetch (const Array<Graph>& graphs, const int active) const;
+
+    /** Returns loaded graphs to unload to get back under budget, least recently
+        used first. The active graph, pinned graphs and neighbours are kept */
+    Array<int> findGraphsToUnload (const Array<Graph>& graphs, const int active) const;
+
+    /** Returns the resident memory of this process, or 0 if it can't be measured */
+    static int64 getResidentMemory();
+
+private:
+    int64 budget = 0;
+    int numNeighbours = 1;
+
+    static int64 getLoadedMemory (const Array<Graph>& graphs);
+    static int64 estimateMemory (const Array<Graph>& graphs, const int index);
+};
+
+}
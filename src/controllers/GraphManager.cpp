@@ -59,10 +59,7 @@ static void showFailedInstantiationAlert (const PluginDescription& desc, const b
         message << desc.name << " could not be instantiated";
     }
 
-    if (async)
-        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, header, message);
-    else
-        AlertWindow::showMessageBox (AlertWindow::WarningIcon, header, message);
+    Util::showAlert (AlertWindow::WarningIcon, header, message, async);
 }
 
 /** This enforces correct IO nodes based on the graph processor's settings
@@ -244,8 +241,8 @@ uint32 GraphManager::addNode (const Node& newNode)
 {
     if (! newNode.isValid())
     {
-        AlertWindow::showMessageBox (AlertWindow::WarningIcon, TRANS ("Couldn't create Node"),
-                                     "Cannot instantiate node without a description");
+        Util::showAlert (AlertWindow::WarningIcon, TRANS ("Couldn't create Node"),
+                         "Cannot instantiate node without a description", false);
         return KV_INVALID_NODE;
     }
     
@@ -275,8 +272,8 @@ uint32 GraphManager::addNode (const Node& newNode)
     else
     {
         nodeId = KV_INVALID_NODE;
-        AlertWindow::showMessageBox (AlertWindow::WarningIcon, "Couldn't create filter",
-                                     "The plugin could not be instantiated");
+        Util::showAlert (AlertWindow::WarningIcon, "Couldn't create filter",
+                         "The plugin could not be instantiated", false);
     }
     
     return nodeId;
@@ -286,9 +283,9 @@ uint32 GraphManager::addFilter (const PluginDescription* desc, double rx, double
 {
     if (! desc)
     {
-        AlertWindow::showMessageBox (AlertWindow::WarningIcon,
-                                     TRANS ("Couldn't create filter"),
-                                     TRANS ("Cannot instantiate plugin without a description"));
+        Util::showAlert (AlertWindow::WarningIcon,
+                         TRANS ("Couldn't create filter"),
+                         TRANS ("Cannot instantiate plugin without a description"), false);
         return KV_INVALID_NODE;
     }
 
@@ -567,6 +564,16 @@ void GraphManager::savePluginStates()
     }
 }
 
+void GraphManager::unloadNodes()
+{
+    savePluginStates();
+    loaded = false;
+    processor.clear();
+    for (int i = 0; i < nodes.getNumChildren(); ++i)
+        Node::sanitizeRuntimeProperties (nodes.getChild (i), true);
+    changed();
+}
+
 void GraphManager::clear()
 {
     loaded = false;
@@ -667,7 +674,7 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
 // MARK: Root Graph Controller
 void RootGraphManager::unloadGraph()
 {
-    getRootGraph().clear();
+    unloadNodes();
 }
 
 }
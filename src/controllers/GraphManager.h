@@ -90,6 +90,10 @@ public:
     inline Node getGraphModel() const { return Node (graph, false); }
     
     void savePluginStates();
+
+    /** Saves plugin states into the model, then deletes the nodes. The model
+        is kept, so setNodeModel can load the graph again */
+    void unloadNodes();
     
     /** Rebuilds the arcs model according to the GraphProcessor */
     inline void syncArcsModel()
@@ -65,7 +65,8 @@ void SessionController::openDefaultSession()
         
     loadNewSessionData();
     refreshOtherControllers();
-    findSibling<GuiController>()->stabilizeContent();
+    if (auto* gui = findSibling<GuiController>())
+        gui->stabilizeContent();
     resetChanges();
 }
 
@@ -98,17 +99,19 @@ void SessionController::openFile (const File& file)
         
         if (result.wasOk())
         {
-            auto& gui = *findSibling<GuiController>();
-            gui.closeAllPluginWindows();
+            auto* const gui = findSibling<GuiController>();
+            if (gui != nullptr)
+                gui->closeAllPluginWindows();
             refreshOtherControllers();
             
-            if (auto* cc = gui.getContentComponent())
+            if (auto* cc = gui != nullptr ? gui->getContentComponent() : nullptr)
             {
                 auto ui = currentSession->getValueTree().getOrCreateChildWithName (Tags::ui, nullptr);
                 cc->applySessionState (ui.getProperty ("content").toString());
             }
 
-            findSibling<GuiController>()->stabilizeContent();
+            if (gui != nullptr)
+                gui->stabilizeContent();
             resetChanges();
         }
 
@@ -160,9 +163,9 @@ void SessionController::saveSession (const bool saveAs)
     jassert (document && currentSession);
     auto result = FileBasedDocument::userCancelledSave;
 
-    auto& gui = *findSibling<GuiController>();
+    auto* const gui = findSibling<GuiController>();
 
-    if (auto* cc = gui.getContentComponent())
+    if (auto* cc = gui != nullptr ? gui->getContentComponent() : nullptr)
     {
         String state; cc->getSessionState (state);
         auto ui = currentSession->getValueTree().getOrCreateChildWithName (Tags::ui, nullptr);
@@ -203,10 +206,12 @@ void SessionController::newSession()
     
     if (res == 1 || res == 2)
     {
-        findSibling<GuiController>()->closeAllPluginWindows();
+        if (auto* gui = findSibling<GuiController>())
+            gui->closeAllPluginWindows();
         loadNewSessionData();
         refreshOtherControllers();
-        findSibling<GuiController>()->stabilizeContent();
+        if (auto* gui = findSibling<GuiController>())
+            gui->stabilizeContent();
         resetChanges (true);
     }
 }
@@ -0,0 +1,253 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AheadBuffer.h"
+#include "engine/FixedMidiBuffer.h"
+
+namespace Element {
+
+/** Events of one stream, each stored as a 64-bit sample time, a 16-bit size
+    and the bytes, in a ring which may split an event across its end */
+struct AheadBuffer::MidiRing
+{
+    MidiRing() : fifo (FixedMidiBuffer::capacity * 4)
+    {
+        data.calloc ((size_t) fifo.getTotalSize());
+        scratch.calloc ((size_t) fifo.getTotalSize());
+    }
+
+    static const int headerSize = (int) (sizeof (int64) + sizeof (uint16));
+
+    /** Writer: stores an event, or returns false if there isn't room */
+    bool write (const int64 time, const uint8* bytes, const uint16 numBytes) noexcept
+    {
+        uint8 header [headerSize];
+        memcpy (header, &time, sizeof (int64));
+        memcpy (header + sizeof (int64), &numBytes, sizeof (uint16));
+
+        const int total = headerSize + (int) numBytes;
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (total, start1, size1, start2, size2);
+        if (size1 + size2 < total)
+            return false;
+
+        copyIn (start1, size1, start2, 0, header, headerSize);
+        copyIn (start1, size1, start2, headerSize, bytes, (int) numBytes);
+        fifo.finishedWrite (total);
+        return true;
+    }
+
+    /** Reader: looks at the next event without taking it */
+    bool peek (int64& time, uint16& numBytes) noexcept
+    {
+        uint8 header [headerSize];
+        if (! copyOut (header, 0, headerSize))
+            return false;
+        memcpy (&time, header, sizeof (int64));
+        memcpy (&numBytes, header + sizeof (int64), sizeof (uint16));
+        return true;
+    }
+
+    /** Reader: takes the next event, returning its bytes */
+    const uint8* take (const uint16 numBytes) noexcept
+    {
+        copyOut (scratch, headerSize, (int) numBytes);
+        fifo.finishedRead (headerSize + (int) numBytes);
+        return scratch;
+    }
+
+private:
+    AbstractFifo fifo;
+    HeapBlock<uint8> data, scratch;
+
+    void copyIn (const int start1, const int size1, const int start2,
+                 int offset, const uint8* source, int numBytes) noexcept
+    {
+        if (offset < size1)
+        {
+            const int num = jmin (numBytes, size1 - offset);
+            memcpy (data + start1 + offset, source, (size_t) num);
+            source += num; numBytes -= num; offset += num;
+        }
+
+        if (numBytes > 0)
+            memcpy (data + start2 + offset - size1, source, (size_t) numBytes);
+    }
+
+    bool copyOut (uint8* dest, int offset, int numBytes) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (offset + numBytes, start1, size1, start2, size2);
+        if (size1 + size2 < offset + numBytes)
+            return false;
+
+        if (offset < size1)
+        {
+            const int num = jmin (numBytes, size1 - offset);
+            memcpy (dest, data + start1 + offset, (size_t) num);
+            dest += num; numBytes -= num; offset += num;
+        }
+
+        if (numBytes > 0)
+            memcpy (dest, data + start2 + offset - size1, (size_t) numBytes);
+        return true;
+    }
+};
+
+AheadBuffer::AheadBuffer (const int numAudioChannels, const int numMidiStreams, const int capacityInSamples)
+    : fifo (capacityInSamples + 1),
+      audio (numAudioChannels, capacityInSamples + 1)
+{
+    audio.clear();
+    for (int i = 0; i < numMidiStreams; ++i)
+        midi.add (new MidiRing());
+}
+
+AheadBuffer::~AheadBuffer() { }
+
+void AheadBuffer::writeAudio (const int channel, const float* source, const int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+    jassert (size1 + size2 == numSamples);
+    audio.copyFrom (channel, start1, source, size1);
+    if (size2 > 0)
+        audio.copyFrom (channel, start2, source + size1, size2);
+}
+
+void AheadBuffer::writeMidi (const int stream, const MidiBuffer& source) noexcept
+{
+    auto& ring = *midi.getUnchecked (stream);
+    for (FixedMidiBuffer::Reader reader (source); ! reader.isDone(); reader.next())
+        if (! ring.write (writeTime + reader.getTime(), reader.getData(), (uint16) reader.getNumBytes()))
+            FixedMidiBuffer::countDroppedEvent();
+}
+
+void AheadBuffer::finishWrite (const int numSamples) noexcept
+{
+    writeTime += numSamples;
+    fifo.finishedWrite (numSamples);
+}
+
+void AheadBuffer::writeSilence (const int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+    jassert (size1 + size2 == numSamples);
+    for (int channel = audio.getNumChannels(); --channel >= 0;)
+    {
+        audio.clear (channel, start1, size1);
+        if (size2 > 0)
+            audio.clear (channel, start2, size2);
+    }
+
+    finishWrite (numSamples);
+}
+
+void AheadBuffer::moveFrom (AheadBuffer& source, const int numSamples) noexcept
+{
+    jassert (source.getNumReady() >= numSamples && getFreeSpace() >= numSamples);
+
+    int start1, size1, start2, size2;
+    source.fifo.prepareToRead (numSamples, start1, size1, start2, size2);
+    for (int channel = 0; channel < getNumAudioChannels(); ++channel)
+    {
+        if (channel < source.getNumAudioChannels())
+        {
+            int start3, size3, start4, size4;
+            fifo.prepareToWrite (numSamples, start3, size3, start4, size4);
+            const float* const parts[] = { source.audio.getReadPointer (channel, start1),
+                                           source.audio.getReadPointer (channel, start2) };
+            const int sizes[] = { size1, size2 };
+
+            // the two buffers' rings can wrap at different places
+            int part = 0, offset = 0;
+            for (int written = 0; written < numSamples;)
+            {
+                const int dest = written < size3 ? start3 + written : start4 + written - size3;
+                const int room = written < size3 ? size3 - written : size4 - (written - size3);
+                const int num = jmin (room, sizes[part] - offset);
+                audio.copyFrom (channel, dest, parts[part] + offset, num);
+                written += num;
+                offset += num;
+                if (offset == sizes[part])
+                {
+                    ++part;
+                    offset = 0;
+                }
+            }
+        }
+        else
+        {
+            int start3, size3, start4, size4;
+            fifo.prepareToWrite (numSamples, start3, size3, start4, size4);
+            audio.clear (channel, start3, size3);
+            if (size4 > 0)
+                audio.clear (channel, start4, size4);
+        }
+    }
+
+    for (int stream = 0; stream < jmin (getNumMidiStreams(), source.getNumMidiStreams()); ++stream)
+    {
+        auto& from = *source.midi.getUnchecked (stream);
+        auto& to   = *midi.getUnchecked (stream);
+
+        int64 time; uint16 numBytes;
+        while (from.peek (time, numBytes) && time < source.readTime + numSamples)
+        {
+            const int64 newTime = writeTime + jmax ((int64) 0, time - source.readTime);
+            if (! to.write (newTime, from.take (numBytes), numBytes))
+                FixedMidiBuffer::countDroppedEvent();
+        }
+    }
+
+    source.finishRead (numSamples);
+    finishWrite (numSamples);
+}
+
+void AheadBuffer::readAudio (const int channel, float* dest, const int numSamples) const noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numSamples, start1, size1, start2, size2);
+    jassert (size1 + size2 == numSamples);
+    FloatVectorOperations::copy (dest, audio.getReadPointer (channel, start1), size1);
+    if (size2 > 0)
+        FloatVectorOperations::copy (dest + size1, audio.getReadPointer (channel, start2), size2);
+}
+
+void AheadBuffer::readMidi (const int stream, MidiBuffer& dest, const int numSamples) noexcept
+{
+    auto& ring = *midi.getUnchecked (stream);
+    dest.clear();
+
+    int64 time; uint16 numBytes;
+    while (ring.peek (time, numBytes) && time < readTime + numSamples)
+    {
+        const auto* const bytes = ring.take (numBytes);
+        FixedMidiBuffer::addEvent (dest, bytes, (int) numBytes, jmax (0, (int) (time - readTime)));
+    }
+}
+
+void AheadBuffer::finishRead (const int numSamples) noexcept
+{
+    readTime += numSamples;
+    fifo.finishedRead (numSamples);
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Audio and MIDI rendered ahead of time by one thread and consumed later by
+    another, usually the audio thread. Lock free for a single writer and a
+    single reader.
+
+    The writer fills every channel and MIDI stream for a block and then calls
+    finishWrite(). The reader checks getNumReady(), takes what it needs from
+    each channel and stream, then calls finishRead(). MIDI event times are
+    relative to the block being written or read.
+ */
+class AheadBuffer : public ReferenceCountedObject
+{
+public:
+    AheadBuffer (int numAudioChannels, int numMidiStreams, int capacityInSamples);
+    ~AheadBuffer();
+
+    int getNumAudioChannels() const noexcept    { return audio.getNumChannels(); }
+    int getNumMidiStreams() const noexcept      { return midi.size(); }
+
+    /** Samples written and not yet read */
+    int getNumReady() const noexcept            { return fifo.getNumReady(); }
+
+    /** Samples which can be written */
+    int getFreeSpace() const noexcept           { return fifo.getFreeSpace(); }
+
+    /** Writer: copies samples for a channel. getFreeSpace() must be at least numSamples */
+    void writeAudio (int channel, const float* source, int numSamples) noexcept;
+
+    /** Writer: stores the events of a block for a MIDI stream. Events which
+        don't fit are dropped and counted with FixedMidiBuffer's drops */
+    void writeMidi (int stream, const MidiBuffer& source) noexcept;
+
+    /** Writer: makes numSamples of every channel and stream readable */
+    void finishWrite (int numSamples) noexcept;
+
+    /** Writer: makes numSamples of silence, with no MIDI, readable */
+    void writeSilence (int numSamples) noexcept;
+
+    /** Reader of source and writer of this: moves numSamples from one buffer
+        to the other, keeping event times. Channels and streams this has and
+        source doesn't get silence. Used to carry audio rendered ahead over to
+        a recompiled sequence */
+    void moveFrom (AheadBuffer& source, int numSamples) noexcept;
+
+    /** Reader: copies samples for a channel. getNumReady() must be at least numSamples */
+    void readAudio (int channel, float* dest, int numSamples) const noexcept;
+
+    /** Reader: replaces dest with a stream's events in the next numSamples */
+    void readMidi (int stream, MidiBuffer& dest, int numSamples) noexcept;
+
+    /** Reader: moves past numSamples of every channel and stream */
+    void finishRead (int numSamples) noexcept;
+
+    typedef ReferenceCountedObjectPtr<AheadBuffer> Ptr;
+
+private:
+    AbstractFifo fifo;
+    AudioSampleBuffer audio;
+    int64 writeTime = 0;    // writer only
+    int64 readTime = 0;     // reader only
+
+    struct MidiRing;
+    OwnedArray<MidiRing> midi;
+
+    JUCE_DECLARE_NON_COPYABLE (AheadBuffer)
+};
+
+}
@@ -0,0 +1,210 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AllocationCounter.h"
+
+#if EL_COUNT_ALLOCATIONS && JUCE_LINUX
+ // initial-exec TLS never allocates, so it is safe to touch from inside malloc
+ #define EL_RENDER_TLS __thread __attribute__ ((tls_model ("initial-exec")))
+#else
+ #define EL_RENDER_TLS thread_local
+#endif
+
+#if EL_COUNT_ALLOCATIONS && (JUCE_LINUX || JUCE_MAC)
+ #define EL_RECORD_STACKS 1
+ #include <execinfo.h>
+#else
+ #define EL_RECORD_STACKS 0
+#endif
+
+#if EL_COUNT_ALLOCATIONS && JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace Element {
+
+static EL_RENDER_TLS bool renderingOnThisThread = false;
+static EL_RENDER_TLS bool insideHook = false;
+static Atomic<int64> numAllocations { 0 };
+static Atomic<int64> numViolations { 0 };
+
+static const int maxStackFrames = 32;
+static const int maxRecordedViolations = 32;
+
+struct Violation
+{
+    AllocationCounter::ViolationType type;
+    int numFrames;
+    void* frames [maxStackFrames];
+};
+
+// fixed storage, recording must not allocate
+static Violation violations [maxRecordedViolations];
+
+#if EL_RECORD_STACKS
+// the first backtrace() loads the unwinder, which allocates. Do that up front
+static const int backtracePrimed = [] { void* frame; return backtrace (&frame, 1); }();
+#endif
+
+static void record (const AllocationCounter::ViolationType type) noexcept
+{
+    if (! renderingOnThisThread || insideHook)
+        return;
+
+    insideHook = true;
+    if (type == AllocationCounter::allocation)
+        ++numAllocations;
+
+    const int64 index = (++numViolations) - 1;
+    if (index < maxRecordedViolations)
+    {
+        auto& violation = violations [(int) index];
+        violation.type = type;
+       #if EL_RECORD_STACKS
+        violation.numFrames = backtrace (violation.frames, maxStackFrames);
+       #else
+        violation.numFrames = 0;
+       #endif
+    }
+
+    insideHook = false;
+}
+
+AllocationCounter::ScopedRender::ScopedRender() noexcept
+    : wasRendering (renderingOnThisThread)
+{
+    renderingOnThisThread = true;
+}
+
+AllocationCounter::ScopedRender::~ScopedRender() noexcept
+{
+    renderingOnThisThread = wasRendering;
+}
+
+bool AllocationCounter::isRendering() noexcept        { return renderingOnThisThread; }
+int64 AllocationCounter::getCount() noexcept          { return numAllocations.get(); }
+int64 AllocationCounter::getNumViolations() noexcept  { return numViolations.get(); }
+
+void AllocationCounter::reset() noexcept
+{
+    numAllocations = 0;
+    numViolations = 0;
+}
+
+void AllocationCounter::allocated() noexcept      { record (allocation); }
+void AllocationCounter::deallocated() noexcept    { record (deallocation); }
+void AllocationCounter::locked() noexcept         { record (lock); }
+
+String AllocationCounter::createReport()
+{
+    static const char* const typeNames[] = { "allocation", "free", "mutex lock" };
+    const int64 total = numViolations.get();
+    const int numRecorded = (int) jmin ((int64) maxRecordedViolations, total);
+
+    String report;
+    report << String (total) << " real-time violation(s) while rendering" << newLine;
+
+    for (int i = 0; i < numRecorded; ++i)
+    {
+        const auto& violation = violations [i];
+        report << "#" << String (i + 1) << " " << typeNames [violation.type] << newLine;
+
+       #if EL_RECORD_STACKS
+        if (char** const symbols = backtrace_symbols (violation.frames, violation.numFrames))
+        {
+            for (int f = 0; f < violation.numFrames; ++f)
+                report << "    " << symbols [f] << newLine;
+            ::free (symbols);
+        }
+       #endif
+    }
+
+    if (total > numRecorded)
+        report << String (total - numRecorded) << " more not recorded" << newLine;
+
+    return report;
+}
+
+}
+
+#if EL_COUNT_ALLOCATIONS
+ #if JUCE_LINUX
+// glibc lets malloc and pthreads be interposed, which also catches HeapBlock,
+// everything operator new does and CriticalSection
+extern "C" {
+extern void* __libc_malloc (size_t);
+extern void* __libc_calloc (size_t, size_t);
+extern void* __libc_realloc (void*, size_t);
+extern void __libc_free (void*);
+
+void* malloc (size_t size)
+{
+    Element::AllocationCounter::allocated();
+    return __libc_malloc (size);
+}
+
+void* calloc (size_t num, size_t size)
+{
+    Element::AllocationCounter::allocated();
+    return __libc_calloc (num, size);
+}
+
+void* realloc (void* ptr, size_t size)
+{
+    Element::AllocationCounter::allocated();
+    return __libc_realloc (ptr, size);
+}
+
+void free (void* ptr)
+{
+    if (ptr != nullptr)
+        Element::AllocationCounter::deallocated();
+    __libc_free (ptr);
+}
+
+typedef int (*MutexLockFunction) (pthread_mutex_t*);
+
+int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    // trylock never blocks, so only this one is audited
+    static MutexLockFunction nextLock = nullptr;
+    if (nextLock == nullptr)
+        nextLock = (MutexLockFunction) dlsym (RTLD_NEXT, "pthread_mutex_lock");
+    Element::AllocationCounter::locked();
+    return nextLock (mutex);
+}
+}
+ #else
+// elsewhere only operator new is replaceable
+void* operator new (std::size_t size)
+{
+    Element::AllocationCounter::allocated();
+    if (auto* const ptr = std::malloc (size > 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)                 { return operator new (size); }
+void operator delete (void* ptr) noexcept               { std::free (ptr); }
+void operator delete[] (void* ptr) noexcept             { std::free (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept  { std::free (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept { std::free (ptr); }
+ #endif
+#endif
@@ -0,0 +1,90 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#ifndef EL_COUNT_ALLOCATIONS
+ #define EL_COUNT_ALLOCATIONS 0
+#endif
+
+namespace Element {
+
+/** Audits threads while they render audio.
+
+    Heap allocations, frees and blocking mutex locks made by a thread inside
+    a ScopedRender are counted and recorded with the stack that made them.
+    The audio device callback, GraphProcessor::processBlock and the render
+    pool workers all mark themselves as rendering.
+
+    Auditing needs the allocator and lock hooks which are only compiled in
+    when EL_COUNT_ALLOCATIONS is set, by configuring a test or benchmark
+    build with --realtime-audit. Without them nothing is ever counted. Only
+    allocations can be seen on platforms other than Linux.
+ */
+class AllocationCounter
+{
+public:
+    /** Marks the calling thread as rendering for as long as this exists */
+    class ScopedRender
+    {
+    public:
+        ScopedRender() noexcept;
+        ~ScopedRender() noexcept;
+
+    private:
+        const bool wasRendering;
+        JUCE_DECLARE_NON_COPYABLE (ScopedRender)
+    };
+
+    /** Kinds of call which aren't real-time safe */
+    enum ViolationType
+    {
+        allocation = 0,
+        deallocation,
+        lock
+    };
+
+    /** True if rendering threads are audited in this build */
+    static constexpr bool isEnabled() noexcept { return EL_COUNT_ALLOCATIONS != 0; }
+
+    /** True if the calling thread is inside a ScopedRender */
+    static bool isRendering() noexcept;
+
+    /** Allocations made while rendering since the last reset() */
+    static int64 getCount() noexcept;
+
+    /** Allocations, frees and locks made while rendering since the last reset() */
+    static int64 getNumViolations() noexcept;
+
+    /** Sets the counts back to zero and forgets recorded stacks */
+    static void reset() noexcept;
+
+    /** Describes the recorded violations with symbolized stacks.
+        This allocates, don't call it while rendering */
+    static String createReport();
+
+    /** Called by the allocator and lock hooks */
+    static void allocated() noexcept;
+    static void deallocated() noexcept;
+    static void locked() noexcept;
+};
+
+}
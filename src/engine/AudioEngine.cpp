@@ -17,13 +17,18 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "engine/AllocationCounter.h"
 #include "engine/AudioEngine.h"
+#include "engine/CallbackTelemetry.h"
+#include "engine/FixedMidiBuffer.h"
 #include "engine/GraphProcessor.h"
 #include "engine/InternalFormat.h"
 #include "engine/MidiClock.h"
 #include "engine/MidiChannelMap.h"
 #include "engine/MidiEngine.h"
+#include "engine/MidiInputQueue.h"
 #include "engine/MidiTranspose.h"
+#include "engine/RenderPool.h"
 #include "engine/Transport.h"
 #include "Globals.h"
 #include "Settings.h"
@@ -98,10 +103,18 @@ void RootGraph::updateChannelNames (AudioIODevice* device)
 struct RootGraphRender : public AsyncUpdater
 {
     std::function<void()> onActiveGraphChanged;
+    CallbackTelemetry* telemetry = nullptr;
 
     RootGraphRender()
     {
         graphs.ensureStorageAllocated (32);
+        pending.ensureStorageAllocated (32);
+    }
+
+    ~RootGraphRender()
+    {
+        // a late render worker may still be looking at the graph job
+        renderPool->waitForRelease (renderPool->getEpoch());
     }
 
     void handleAsyncUpdate() override
@@ -131,27 +144,126 @@ struct RootGraphRender : public AsyncUpdater
     {
         numInputChans   = numIns;
         numOutputChans  = numOuts;
-        audioTemp.setSize (jmax (numIns, numOuts), numSamples);
-        audioOut.setSize (audioTemp.getNumChannels(), audioTemp.getNumSamples());
+        blockSize       = numSamples;
+        FixedMidiBuffer::reserve (midiOut);
+
+        for (auto* const graph : graphs)
+        {
+            prepareGraphBuffers (*graph);
+            graph->hibernating = 0;
+            graph->silentSamples = 0;
+        }
     }
 
     void releaseBuffers()
     {
         numInputChans = numOutputChans = 0;
+        blockSize = 0;
         midiOut.clear();
-        midiTemp.clear();
-        audioTemp.setSize (1, 1);
-        audioOut.setSize (1, 1);
+        for (auto* const graph : graphs)
+        {
+            graph->renderMidi.clear();
+            graph->renderAudio.setSize (1, 1);
+        }
     }
     void dumpGraphs() {
         
     }
 
-    void renderGraphs (AudioSampleBuffer& buffer, MidiBuffer& midi)
+    /** Renders a graph from the shared input into its own scratch buffers. This
+        may be called from a render pool worker, so telemetry is left to the caller */
+    void renderGraph (RootGraph& graph, const AudioSampleBuffer& input, const int numSamples)
+    {
+        const int64 startTicks = NodeProfile::startTimer();
+        const int numSequenceSwaps = graph.getNumSequenceSwaps();
+        if (&input == &graph.renderAudio)
+        {
+            if (graph.isSuspended())
+                graph.processBlockBypassed (graph.renderAudio, graph.renderMidi);
+            else
+                graph.processBlock (graph.renderAudio, graph.renderMidi);
+        }
+        else if (graph.isSuspended())
+        {
+            // pass the inputs through, as processBlockBypassed would in place
+            auto& output = graph.renderAudio;
+            const int numInputs = jmin (input.getNumChannels(), output.getNumChannels());
+            for (int i = 0; i < numInputs; ++i)
+                output.copyFrom (i, 0, input, i, 0, numSamples);
+            for (int i = numInputs; i < output.getNumChannels(); ++i)
+                output.clear (i, 0, numSamples);
+        }
+        else
+        {
+            graph.processBlock (input, graph.renderAudio, graph.renderMidi);
+        }
+        graph.profile.stopTimer (startTicks, numSamples, graph.getSampleRate());
+        graph.sequenceSwapped = numSequenceSwaps != graph.getNumSequenceSwaps();
+    }
+
+    /** Renders the pending graphs, at the same time on the render pool when
+        there is more than one. Only done once the pool's workers have realtime
+        priority, so the device callback never waits on a lower priority thread */
+    void renderPending (const AudioSampleBuffer& input, const int numSamples)
+    {
+        const int64 renderTicks = Time::getHighResolutionTicks();
+
+        if (pending.size() > 1 && renderPool->isRealtime())
+        {
+            graphJob.prepare (input, numSamples);
+            renderPool->run (graphJob);
+        }
+        else
+        {
+            for (auto* const graph : pending)
+                renderGraph (*graph, input, numSamples);
+        }
+
+        if (telemetry != nullptr)
+        {
+            telemetry->addGraphTicks (Time::getHighResolutionTicks() - renderTicks);
+            for (const auto* const graph : pending)
+                if (graph->sequenceSwapped)
+                    telemetry->addEvents (CallbackTelemetry::sequenceSwapped);
+        }
+    }
+
+    /** Pre-rolls a hibernating graph with a block of silence, so smoothed
+        parameters and filters have settled by the time it is heard */
+    void wakeGraph (RootGraph& graph, const int numChans, const int numSamples)
+    {
+        graph.renderAudio.setSize (numChans, numSamples, false, false, true);
+        for (int i = 0; i < numChans; ++i)
+            graph.renderAudio.clear (i, 0, numSamples);
+        graph.renderMidi.clear (0, numSamples);
+        renderGraph (graph, graph.renderAudio, numSamples);
+        graph.hibernating = 0;
+        graph.silentSamples = 0;
+    }
+
+    /** Hibernates a graph nobody hears once its output has faded out */
+    void updateHibernation (RootGraph& graph, const int numChans, const int numSamples)
+    {
+        bool silent = graph.renderMidi.isEmpty();
+        for (int i = 0; silent && i < numChans; ++i)
+            silent = graph.renderAudio.getMagnitude (i, 0, numSamples) < hibernateThreshold;
+
+        graph.silentSamples = silent ? graph.silentSamples + numSamples : 0;
+        if (graph.silentSamples >= roundToInt (hibernateAfterSeconds * graph.getSampleRate()))
+            graph.hibernating = 1;
+    }
+
+    /** Renders the graphs and mixes them into output. The graphs all read the
+        same input, which may be the output buffer itself: nothing is written
+        to the output until every graph has rendered */
+    void renderGraphs (const AudioSampleBuffer& input, AudioSampleBuffer& buffer, MidiBuffer& midi)
     {
        #if defined (EL_PRO)
         if (program.wasRequested())
         {
+            if (telemetry != nullptr)
+                telemetry->addEvents (CallbackTelemetry::programChanged);
+
             if (! locked)
             {
                 const int nextGraph = findGraphForProgram (program);
@@ -181,31 +293,34 @@ struct RootGraphRender : public AsyncUpdater
 
         const int numSamples = buffer.getNumSamples();
         const int numChans   = buffer.getNumChannels();
+        const int numOuts    = jmin (numOutputChans, numChans);
         const bool graphChanged = lastGraph != currentGraph;
         const bool shouldProcess = true;
         const RootGraph::RenderMode mode = current->getRenderMode();
         const bool modeChanged = graphChanged && mode != last->getRenderMode();
+        if (graphChanged && telemetry != nullptr)
+            telemetry->addEvents (CallbackTelemetry::graphSwitched);
 
         if (shouldProcess)
         {
-			audioOut.setSize (buffer.getNumChannels(), buffer.getNumSamples(),
-							  false, false, true);
-			audioTemp.setSize (buffer.getNumChannels(), buffer.getNumSamples(),
-							  false, false, true);
-
-            // clear the mixing area
-            for (int i = numChans; --i >= 0;)
-                audioOut.clear (i, 0, numSamples);
             midiOut.clear();
-            
+            pending.clearQuick();
+
             for (auto* const graph : graphs)
             {
-                // copy inputs, clear outs if more than input count
-                for (int i = 0; i < numInputChans; ++i)
-                    audioTemp.copyFrom (i, 0, buffer, i, 0, numSamples);
-                for (int i = numInputChans; i < numChans; ++i)
-                    audioTemp.clear (i, 0, numSamples);
-                
+                // graphs nobody hears are left hibernating until switched to
+                const bool audible = (graph == current && graph->isSingle())
+                    || (! current->isSingle() && ! graph->isSingle());
+                if (graph->hibernating.get() != 0)
+                {
+                    if (! audible)
+                        continue;
+                    wakeGraph (*graph, numChans, numSamples);
+                }
+
+                auto& midiTemp = graph->renderMidi;
+                graph->renderAudio.setSize (numChans, numSamples, false, false, true);
+
                 // clear so messages: avoids feedback loop when IO node ins are 
                 // connected to IO node outs
                 midiTemp.clear (0, numSamples);
@@ -231,29 +346,34 @@ struct RootGraphRender : public AsyncUpdater
                             || (current != nullptr && !current->isSingle() && !graph->isSingle()))
                 {
                     // current single graph or parallel graphs get MIDI always
-                    midiTemp.addEvents (midi, 0, numSamples, 0);
+                    FixedMidiBuffer::copy (midiTemp, midi);
                 }
 
-                {
-                    const ScopedLock sl (graph->getCallbackLock());
-                    if (graph->isSuspended())
-                    {
-                        graph->processBlockBypassed (audioTemp, midiTemp);
-                    }
-                    else
-                    {
-                        graph->processBlock (audioTemp, midiTemp);
-                    }
-                }
-                
+                pending.add (graph);
+            }
+
+            renderPending (input, numSamples);
+
+            // mix down in graph order, so the result doesn't depend on which
+            // thread finished first
+            for (int i = numChans; --i >= 0;)
+                buffer.clear (i, 0, numSamples);
+
+            for (auto* const graph : pending)
+            {
+                const auto& audioTemp = graph->renderAudio;
+                const auto& midiTemp  = graph->renderMidi;
+                const bool audible = (graph == current && graph->isSingle())
+                    || (! current->isSingle() && ! graph->isSingle());
+
                 if (graphChanged && ((current->isSingle() && current != graph) ||
                                      (modeChanged && !current->isSingle() && graph->isSingle())))
                                      
                 {
                     // DBG("  FADE OUT LAST GRAPH: " << graph->engineIndex);
-                    for (int i = 0; i < numOutputChans; ++i)
-                            audioOut.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
-                                                      numSamples, 1.f, 0.f);
+                    for (int i = 0; i < numOuts; ++i)
+                            buffer.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
+                                                    numSamples, 1.f, 0.f);
                 }
                 else if ((graph == current && graph->isSingle()) ||
                          (!graph->isSingle() && (current != nullptr) && !current->isSingle()))
@@ -263,22 +383,24 @@ struct RootGraphRender : public AsyncUpdater
                                         (modeChanged && !graph->isSingle() && !current->isSingle())))
                     {
                         // DBG("  FADE IN NEW GRAPH: " << graph->engineIndex);
-                        for (int i = 0; i < numOutputChans; ++i)
-                            audioOut.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
-                                                      numSamples, 0.f, 1.f);
+                        for (int i = 0; i < numOuts; ++i)
+                            buffer.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
+                                                    numSamples, 0.f, 1.f);
                     }
                     else
                     {
-                        for (int i = 0; i < numOutputChans; ++i)
-                            audioOut.addFrom (i, 0, audioTemp, i, 0, numSamples);
+                        for (int i = 0; i < numOuts; ++i)
+                            buffer.addFrom (i, 0, audioTemp, i, 0, numSamples);
                     }
                     
                     midiOut.addEvents (midiTemp, 0, numSamples, 0);
                 }
-            }
 
-            for (int i = 0; i < numChans; ++i)
-                buffer.copyFrom (i, 0, audioOut, i, 0, numSamples);
+                if (audible)
+                    graph->silentSamples = 0;
+                else
+                    updateHibernation (*graph, numChans, numSamples);
+            }
 
             MidiBuffer::Iterator iter (midi);
             MidiMessage msg; int frame = 0;
@@ -312,7 +434,9 @@ struct RootGraphRender : public AsyncUpdater
     bool addGraph (RootGraph* graph)
     {
         graph->setLocked (locked);
+        prepareGraphBuffers (*graph);
         graphs.add (graph);
+        pending.ensureStorageAllocated (graphs.size());
         graph->engineIndex = graphs.size() - 1;
 
         if (graph->engineIndex == 0)
@@ -339,6 +463,10 @@ struct RootGraphRender : public AsyncUpdater
 
     int size() const { return graphs.size(); }
 
+    /** Starts the threads used to render several graphs at once. Don't call
+        this from the audio thread */
+    void startRenderPool() { renderPool->start(); }
+
     RootGraph* getGraph (const int i) const { return graphs.getUnchecked (i); }
     int getGraphIndex() const { return currentGraph; }
     const Array<RootGraph*>& getGraphs() const { return graphs; }
@@ -352,6 +480,10 @@ struct RootGraphRender : public AsyncUpdater
     }
 
 private:
+    // -100 dB for half a second
+    static constexpr float hibernateThreshold = 0.00001f;
+    static constexpr double hibernateAfterSeconds = 0.5;
+
     Array<RootGraph*> graphs;
     bool locked             = false;
     int currentGraph        = -1;
@@ -372,9 +504,58 @@ private:
 
     int numInputChans       = -1;
     int numOutputChans      = -1;
-    AudioSampleBuffer   audioOut, audioTemp;
+    int blockSize           = 0;
+    MidiBuffer midiOut;
 
-    MidiBuffer midiOut, midiTemp;
+    /** Graphs to render this block, in engine order */
+    Array<RootGraph*> pending;
+
+    /** Renders the pending graphs, one graph per task */
+    class GraphJob : public RenderPool::Job
+    {
+    public:
+        GraphJob (RootGraphRender& r) : render (r) { }
+
+        void prepare (const AudioSampleBuffer& inputToRead, const int numSamples) noexcept
+        {
+            input = &inputToRead;
+            numSamplesToRender = numSamples;
+            remaining = render.pending.size();
+            tasks.reset (render.pending.size());
+        }
+
+        bool performNextTask() override
+        {
+            const int index = tasks.claim();
+            if (index < 0)
+                return false;
+
+            render.renderGraph (*render.pending.getUnchecked (index), *input, numSamplesToRender);
+            --remaining;
+            return true;
+        }
+
+        bool isFinished() const override { return remaining.get() <= 0; }
+
+    private:
+        RootGraphRender& render;
+        const AudioSampleBuffer* input = nullptr;
+        int numSamplesToRender = 0;
+        RenderPool::TaskCounter tasks;
+        Atomic<int> remaining { 0 };
+    };
+
+    SharedResourcePointer<RenderPool> renderPool;
+    GraphJob graphJob { *this };
+
+    /** not realtime safe! */
+    void prepareGraphBuffers (RootGraph& graph)
+    {
+        if (blockSize <= 0)
+            return;
+        graph.renderAudio.setSize (jmax (1, numInputChans, numOutputChans), blockSize);
+        FixedMidiBuffer::reserve (graph.renderMidi);
+    }
 
     void updateIndexes()
     {
@@ -389,7 +570,7 @@ private:
             for (int i = 0; i < graphs.size(); ++i)
             {
                 auto* const g = graphs.getUnchecked (i);
-                if (g->midiProgram == r.program && g->acceptsMidiChannel (program.channel))
+                if (g->midiProgram.get() == r.program && g->acceptsMidiChannel (program.channel))
                     return g->engineIndex;
             }
         }
@@ -400,6 +581,7 @@ private:
 
 class AudioEngine::Private : public AudioIODeviceCallback,
                              public MidiInputCallback,
+                             public MidiKeyboardStateListener,
                              public Value::Listener,
                              public MidiClock::Listener,
                              public Timer
@@ -407,8 +589,7 @@ class AudioEngine::Private : public AudioIODeviceCallback,
 public:
     Private (AudioEngine& e)
         : engine (e),sampleRate (0), blockSize (0), isPrepared (false),
-          numInputChans (0), numOutputChans (0),
-          tempBuffer (1, 1)
+          numInputChans (0), numOutputChans (0)
     {
         tempoValue.addListener (this);
         externalClockValue.addListener (this);
@@ -417,6 +598,7 @@ public:
         sessionWantsExternalClock.set (0);
         midiClock.addListener (this);
         graphs.onActiveGraphChanged = std::bind (&AudioEngine::Private::onCurrentGraphChanged, this);
+        graphs.telemetry = &telemetry;
         midiIOMonitor = new MidiIOMonitor();
         startTimerHz (90);
     }
@@ -460,57 +642,31 @@ public:
             auto graphs = session->getValueTree().getChildWithName (Tags::graphs);
             graphs.setProperty (Tags::active, currentGraph, nullptr);
         }
+
+        engine.activeGraphChanged();
     }
     
     void audioDeviceIOCallback (const float** const inputChannelData, const int numInputChannels,
                                 float** const outputChannelData, const int numOutputChannels,
                                 const int numSamples) override
     {
+        const AllocationCounter::ScopedRender rendering;
+        const int64 startTicks = telemetry.callbackStarted();
+        midiInputClock.update (Time::getMillisecondCounterHiRes(), numSamples);
         jassert (sampleRate > 0 && blockSize > 0);
-        int totalNumChans = 0;
         ScopedNoDenormals denormals;
-        if (numInputChannels > numOutputChannels)
-        {
-            // if there aren't enough output channels for the number of
-            // inputs, we need to create some temporary extra ones (can't
-            // use the input data in case it gets written to)
-            tempBuffer.setSize (numInputChannels - numOutputChannels, numSamples,
-                                false, false, true);
-            
-            for (int i = 0; i < numOutputChannels; ++i)
-            {
-                channels[totalNumChans] = outputChannelData[i];
-                memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
-                ++totalNumChans;
-            }
-            
-            for (int i = numOutputChannels; i < numInputChannels; ++i)
-            {
-                channels[totalNumChans] = tempBuffer.getWritePointer (i - numOutputChannels, 0);
-                memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
-                ++totalNumChans;
-            }
-        }
-        else
-        {
-            for (int i = 0; i < numInputChannels; ++i)
-            {
-                channels[totalNumChans] = outputChannelData[i];
-                memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
-                ++totalNumChans;
-            }
-            
-            for (int i = numInputChannels; i < numOutputChannels; ++i)
-            {
-                channels[totalNumChans] = outputChannelData[i];
-                zeromem (channels[totalNumChans], sizeof (float) * (size_t) numSamples);
-                ++totalNumChans;
-            }
-        }
+
+        // the device buffers go to the graphs as they are: every graph reads
+        // the same inputs and the mix is written straight into the outputs
+        for (int i = 0; i < numInputChannels; ++i)
+            channels[i] = const_cast<float*> (inputChannelData[i]);
+        for (int i = 0; i < numOutputChannels; ++i)
+            channels[numInputChannels + i] = outputChannelData[i];
 
         const bool wasPlaying = transport.isPlaying();
-        AudioSampleBuffer buffer (channels, totalNumChans, numSamples);
-        processCurrentGraph (buffer, incomingMidi);
+        const AudioSampleBuffer input (channels, numInputChannels, numSamples);
+        AudioSampleBuffer output (channels + numInputChannels, numOutputChannels, numSamples);
+        processCurrentGraph (input, output, incomingMidi);
 
         {
             ScopedLock lockMidiOut (engine.world.getMidiEngine().getMidiOutputLock());
@@ -547,12 +703,13 @@ public:
         }
         
         incomingMidi.clear();
+        telemetry.callbackFinished (startTicks, numSamples, sampleRate);
     }
     
-    void processCurrentGraph (AudioBuffer<float>& buffer, MidiBuffer& midi)
+    void processCurrentGraph (const AudioSampleBuffer& input, AudioSampleBuffer& buffer, MidiBuffer& midi)
     {
         const int numSamples = buffer.getNumSamples();
-        messageCollector.removeNextBlockOfMessages (midi, numSamples);
+        midiInputs.pull (midi, midiInputClock, numSamples);
         
         const ScopedLock sl (lock);
         const bool shouldProcess = shouldBeLocked.get() == 0;
@@ -583,7 +740,7 @@ public:
 
             if (currentGraph.get() != graphs.getCurrentGraphIndex())
                 graphs.setCurrentGraph (currentGraph.get());
-            graphs.renderGraphs (buffer, midi);  // user requested index can be cancelled by program changed
+            graphs.renderGraphs (input, buffer, midi);  // user requested index can be cancelled by program changed
             currentGraph.set (graphs.getCurrentGraphIndex());
         }
         else
@@ -614,6 +771,8 @@ public:
         const int numChansIn       = device->getActiveInputChannels().countNumberOfSetBits();
         const int numChansOut      = device->getActiveOutputChannels().countNumberOfSetBits();
         audioAboutToStart (newSampleRate, newBlockSize, numChansIn, numChansOut);
+        deviceXrunsAtReset = device->getXRunCount();
+        telemetry.reset();
     }
     
     void audioAboutToStart (const double newSampleRate, const int newBlockSize,
@@ -627,9 +786,11 @@ public:
         numOutputChans  = numChansOut;
         
         midiClock.reset (sampleRate, blockSize);
-        messageCollector.reset (sampleRate);
-        keyboardState.addListener (&messageCollector);
-        channels.calloc ((size_t) jmax (numChansIn, numChansOut) + 2);
+        midiInputClock.reset (sampleRate);
+        midiInputs.clear();
+        keyboardState.addListener (this);
+        channels.calloc ((size_t) (numChansIn + numChansOut) + 2);
+        FixedMidiBuffer::reserve (incomingMidi);
         
         graphs.prepareBuffers (numInputChans, numOutputChans, blockSize);
 
@@ -651,21 +812,20 @@ public:
     void audioStopped()
     {
         const ScopedLock sl (lock);
-        keyboardState.removeListener (&messageCollector);
+        keyboardState.removeListener (this);
         if (isPrepared)
             releaseResources();
         isPrepared  = false;
         sampleRate  = 0.0;
         blockSize   = 0;
-        tempBuffer.setSize (1, 1);
         graphs.releaseBuffers();
     }
     
-    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message) override
+    void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override
     {
         if (! message.isActiveSense() && ! message.isMidiClock())
             midiIOMonitor->received();
-        messageCollector.addMessageToQueue (message);
+        midiInputs.push (source, message);
         const bool clockWanted = processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0;
         if (clockWanted && message.isMidiClock())
         {
@@ -685,12 +845,26 @@ public:
             transport.requestPlayState (true);
         }   
     }
+
+    void handleNoteOn (MidiKeyboardState*, int channel, int note, float velocity) override
+    {
+        midiInputs.push (nullptr, MidiMessage::noteOn (channel, note, velocity)
+            .withTimeStamp (0.001 * Time::getMillisecondCounterHiRes()));
+    }
+
+    void handleNoteOff (MidiKeyboardState*, int channel, int note, float velocity) override
+    {
+        midiInputs.push (nullptr, MidiMessage::noteOff (channel, note, velocity)
+            .withTimeStamp (0.001 * Time::getMillisecondCounterHiRes()));
+    }
     
     void addGraph (RootGraph* graph)
     {
         jassert (graph);
         if (isPrepared)
             prepareGraph (graph, sampleRate, blockSize);
+        if (graphs.size() > 0)
+            graphs.startRenderPool();
         ScopedLock sl (lock);
         if (graphs.addGraph (graph))
         {
@@ -798,9 +972,9 @@ private:
 
     int numInputChans, numOutputChans;
     HeapBlock<float*> channels;
-    AudioSampleBuffer tempBuffer;
     MidiBuffer incomingMidi;
-    MidiMessageCollector messageCollector;
+    MidiInputQueueSet midiInputs;
+    MidiInputClock midiInputClock;
     MidiKeyboardState keyboardState;
 
     AudioSampleBuffer graphBuffer;
@@ -823,6 +997,8 @@ private:
     Atomic<int> shouldBeLocked { 0 };
 
     MidiIOMonitorPtr midiIOMonitor;
+    CallbackTelemetry telemetry;
+    Atomic<int> deviceXrunsAtReset { 0 };
 
     void prepareGraph (RootGraph* graph, double sampleRate, int estimatedBlockSize)
     {
@@ -912,6 +1088,62 @@ RootGraph* AudioEngine::getGraph (const int index)
     return nullptr;
 }
 
+void AudioEngine::setNodeProfilingEnabled (const bool shouldProfile)
+{
+    if (shouldProfile == NodeProfile::isEnabled())
+        return;
+    resetProfiles();
+    NodeProfile::setEnabled (shouldProfile);
+}
+
+bool AudioEngine::isNodeProfilingEnabled() const
+{
+    return NodeProfile::isEnabled();
+}
+
+NodeProfile::Stats AudioEngine::getGraphProfile (const int index)
+{
+    if (auto* graph = getGraph (index))
+        return graph->getProfile().getStats();
+    return {};
+}
+
+static void resetNodeProfiles (const GraphProcessor& graph)
+{
+    for (int i = 0; i < graph.getNumNodes(); ++i)
+    {
+        auto* const node = graph.getNode (i);
+        node->getProfile().reset();
+        if (auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+            resetNodeProfiles (*sub);
+    }
+}
+
+void AudioEngine::resetProfiles()
+{
+    ScopedLock sl (priv->lock);
+    for (auto* const graph : priv->graphs.getGraphs())
+    {
+        graph->getProfile().reset();
+        resetNodeProfiles (*graph);
+    }
+}
+
+CallbackTelemetry::Stats AudioEngine::getCallbackStats()
+{
+    auto stats = priv->telemetry.getStats();
+    if (auto* const device = world.getDeviceManager().getCurrentAudioDevice())
+        stats.numDeviceXruns = jmax (0, device->getXRunCount() - priv->deviceXrunsAtReset.get());
+    return stats;
+}
+
+void AudioEngine::resetCallbackStats()
+{
+    auto* const device = world.getDeviceManager().getCurrentAudioDevice();
+    priv->deviceXrunsAtReset = device != nullptr ? device->getXRunCount() : 0;
+    priv->telemetry.reset();
+}
+
 void AudioEngine::addMidiMessage (const MidiMessage msg, bool handleOnDeviceQueue)
 {
     if (priv == nullptr)
@@ -919,7 +1151,7 @@ void AudioEngine::addMidiMessage (const MidiMessage msg, bool handleOnDeviceQueu
     if (handleOnDeviceQueue)
         priv->handleIncomingMidiMessage (nullptr, msg);
     else
-        priv->messageCollector.addMessageToQueue (msg);
+        priv->midiInputs.push (nullptr, msg);
 }
     
 void AudioEngine::setActiveGraph (const int index)
@@ -996,9 +1228,13 @@ void AudioEngine::processExternalBuffers (AudioBuffer<float>& buffer, MidiBuffer
     if (priv)
     {
        #if EL_RUNNING_AS_PLUGIN
-        world.getMidiEngine().processMidiBuffer (midi, buffer.getNumSamples(), priv->sampleRate);
+        // the host's MIDI goes straight to the graphs, already sample accurate.
+        // Queueing it with the device input would restamp it from the clock
+        world.getMidiEngine().processMidiBuffer (midi, buffer.getNumSamples(), priv->sampleRate,
+                                                 &getMidiInputCallback());
        #endif
-        priv->processCurrentGraph (buffer, midi);
+        priv->midiInputClock.update (Time::getMillisecondCounterHiRes(), buffer.getNumSamples());
+        priv->processCurrentGraph (buffer, buffer, midi);
     }
 }
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/CallbackTelemetry.h"
 #include "engine/Engine.h"
 #include "engine/GraphProcessor.h"
 #include "engine/MidiIOMonitor.h"
@@ -51,7 +52,6 @@ public:
     inline void setLocked (const var&)
     {
         const bool isNowLocked = false;
-        ScopedLock sl (getCallbackLock());
         locked = isNowLocked;
     }
 
@@ -74,24 +74,18 @@ public:
     void setPlayConfigFor (const DeviceManager::AudioDeviceSetup& setup);
     void setPlayConfigFor (DeviceManager&);
     
-    inline RenderMode getRenderMode() const { return renderMode; }
-    inline String getRenderModeSlug() const { return getSlugForRenderMode (renderMode); }
+    inline RenderMode getRenderMode() const { return static_cast<RenderMode> (renderMode.get()); }
+    inline String getRenderModeSlug() const { return getSlugForRenderMode (getRenderMode()); }
     inline bool isSingle() const { return getRenderMode() == SingleGraph; }
     
     inline void setRenderMode (const RenderMode mode)
     {
-        // TODO: don't use a lock
-        if (! locked && renderMode == static_cast<int> (mode))
-            return;
-        ScopedLock sl (getCallbackLock());
+        // read by the audio thread without locking
         renderMode = locked ? SingleGraph : mode;
     }
 
     inline void setMidiProgram (const int program)
     {
-        if (program == midiProgram)
-            return;
-        ScopedLock sl (getCallbackLock());
         midiProgram = program;
     }
     
@@ -105,6 +99,13 @@ public:
         is not attached */
     int getEngineIndex()    const { return engineIndex; }
 
+    /** Timings of this graph's whole render, collected while NodeProfile is enabled */
+    NodeProfile& getProfile() noexcept { return profile; }
+
+    /** True if the engine has stopped rendering this graph because it isn't
+        heard and its output has faded out. It wakes when switched to */
+    bool isHibernating() const noexcept { return hibernating.get() != 0; }
+
 private:
     friend class AudioEngine;
     friend struct RootGraphRender;
@@ -115,11 +116,19 @@ private:
     StringArray audioInputNames;
     StringArray audioOutputNames;
     int midiChannel = 0;
-    int midiProgram = -1;
+    Atomic<int> midiProgram { -1 };
     int engineIndex = -1;
-    RenderMode renderMode = Parallel;
+    Atomic<int> renderMode { Parallel };
+    NodeProfile profile;
+    Atomic<int> hibernating { 0 };
+    int silentSamples = 0;      // audio thread only
+
+    // scratch buffers this graph renders into, owned by the engine
+    AudioSampleBuffer renderAudio;
+    MidiBuffer renderMidi;
+    bool sequenceSwapped = false;
     
-    bool locked = true;
+    bool locked = true;         // message thread only
 
     void updateChannelNames (AudioIODevice* device);
 };
@@ -129,6 +138,10 @@ class AudioEngine : public Engine
 public:
     Signal<void()> sampleLatencyChanged;
 
+    /** Emitted on the message thread after the engine switched graphs by itself,
+        e.g. because of a program change */
+    Signal<void()> activeGraphChanged;
+
     AudioEngine (Globals&);
     virtual ~AudioEngine() noexcept;
 
@@ -160,6 +173,26 @@ public:
     int getActiveGraph() const;
     
     RootGraph* getGraph (const int index);
+
+    /** Enable or disable DSP load profiling of every node and root graph. See
+        GraphNode::getProfileStats() for results of individual nodes */
+    void setNodeProfilingEnabled (const bool shouldProfile);
+
+    /** Returns true if nodes are being profiled */
+    bool isNodeProfilingEnabled() const;
+
+    /** Returns the render timings of the root graph at index */
+    NodeProfile::Stats getGraphProfile (const int index);
+
+    /** Clears the timings of all root graphs and their nodes */
+    void resetProfiles();
+
+    /** Returns the timing of device callbacks against their buffer period,
+        including xruns reported by the device, since the last reset */
+    CallbackTelemetry::Stats getCallbackStats();
+
+    /** Clears the callback timings and xrun counts */
+    void resetCallbackStats();
     
     void setPlaying (const bool shouldBePlaying);
     void setRecording (const bool shouldBeRecording);
@@ -0,0 +1,184 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/CallbackTelemetry.h"
+
+namespace Element {
+
+String CallbackTelemetry::Block::toString() const
+{
+    String text = Time (time).formatted ("%H:%M:%S");
+    text << "." << String (time % 1000).paddedLeft ('0', 3)
+         << " load " << String (roundToInt (load)) << "%"
+         << ", graphs " << String (roundToInt (graphLoad)) << "%";
+    if (interval > 150.f)
+        text << ", started " << String (roundToInt (interval)) << "% late";
+
+    StringArray names;
+    if (events & graphSwitched)     names.add ("graph switch");
+    if (events & sequenceSwapped)   names.add ("sequence swap");
+    if (events & programChanged)    names.add ("program change");
+    if (names.size() > 0)
+        text << " [" << names.joinIntoString (", ") << "]";
+
+    return text;
+}
+
+CallbackTelemetry::CallbackTelemetry()
+{
+    clear();
+}
+
+void CallbackTelemetry::clear() noexcept
+{
+    for (auto& bucket : buckets)
+        bucket = 0;
+    numCallbacks = numOverruns = numLate = totalPermille = maxPermille = 0;
+
+    for (int i = 0; i < numWorstBlocks; ++i)
+    {
+        auto& slot = worst [i];
+        ++slot.sequence;
+        slot.load = slot.graphLoad = slot.interval = slot.events = 0;
+        slot.time = 0;
+        ++slot.sequence;
+        worstPermille [i] = 0;
+    }
+}
+
+void CallbackTelemetry::reset() noexcept
+{
+    resetPending = 1;
+}
+
+int64 CallbackTelemetry::callbackStarted() noexcept
+{
+    graphTicks = 0;
+    events = 0;
+    return Time::getHighResolutionTicks();
+}
+
+void CallbackTelemetry::callbackFinished (const int64 startTicks, const int numSamples,
+                                          const double sampleRate) noexcept
+{
+    const int64 endTicks = Time::getHighResolutionTicks();
+
+    if (resetPending.compareAndSetBool (0, 1))
+        clear();
+
+    const int64 previousStartTicks = lastStartTicks;
+    lastStartTicks = startTicks;
+    if (numSamples <= 0 || sampleRate <= 0.0)
+        return;
+
+    // loads are kept in permille of the buffer period
+    static const double ticksPerSecond = (double) Time::getHighResolutionTicksPerSecond();
+    const double periodTicks = ticksPerSecond * (double) numSamples / sampleRate;
+    const int load      = roundToInt (1000.0 * (double) (endTicks - startTicks) / periodTicks);
+    const int graphLoad = roundToInt (1000.0 * (double) graphTicks / periodTicks);
+    const int interval  = previousStartTicks > 0
+        ? roundToInt (1000.0 * (double) (startTicks - previousStartTicks) / periodTicks) : 1000;
+
+    ++buckets [jlimit (0, (int) numBuckets - 1, load / (10 * Stats::bucketPercent))];
+    ++numCallbacks;
+    totalPermille = totalPermille.get() + load;
+    if (load > maxPermille.get())
+        maxPermille = load;
+    if (load > 1000)
+        ++numOverruns;
+    if (interval > 1500)
+        ++numLate;
+
+    // replace the least slow of the kept blocks
+    int least = 0;
+    for (int i = 1; i < numWorstBlocks; ++i)
+        if (worstPermille [i] < worstPermille [least])
+            least = i;
+
+    if (load > worstPermille [least])
+    {
+        worstPermille [least] = load;
+        auto& slot = worst [least];
+        ++slot.sequence;
+        slot.load       = load;
+        slot.graphLoad  = graphLoad;
+        slot.interval   = interval;
+        slot.events     = events;
+        slot.time       = Time::currentTimeMillis();
+        ++slot.sequence;
+    }
+}
+
+CallbackTelemetry::Stats CallbackTelemetry::getStats() const
+{
+    Stats stats;
+    if (resetPending.get() != 0)
+        return stats;
+
+    stats.numCallbacks  = numCallbacks.get();
+    stats.numOverruns   = numOverruns.get();
+    stats.numLate       = numLate.get();
+    if (stats.numCallbacks <= 0)
+        return stats;
+
+    stats.meanLoad = 0.1 * (double) totalPermille.get() / (double) stats.numCallbacks;
+    stats.maxLoad  = 0.1 * (double) maxPermille.get();
+
+    int64 total = 0;
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        stats.histogram.add (buckets[i].get());
+        total += stats.histogram.getLast();
+    }
+
+    int64 count = 0;
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        count += stats.histogram [i];
+        if (count * 100 >= total * 99)
+        {
+            stats.p99Load = jmin (stats.maxLoad, (double) ((i + 1) * Stats::bucketPercent));
+            break;
+        }
+    }
+
+    for (const auto& slot : worst)
+    {
+        Block block;
+        int before = 0;
+        do
+        {
+            before = slot.sequence.get();
+            block.load      = 0.1f * (float) slot.load.get();
+            block.graphLoad = 0.1f * (float) slot.graphLoad.get();
+            block.interval  = 0.1f * (float) slot.interval.get();
+            block.events    = slot.events.get();
+            block.time      = slot.time.get();
+        } while ((before & 1) != 0 || before != slot.sequence.get());
+
+        if (block.time > 0)
+            stats.worstBlocks.add (block);
+    }
+
+    std::sort (stats.worstBlocks.begin(), stats.worstBlocks.end(),
+        [](const Block& a, const Block& b) { return a.load > b.load; });
+    return stats;
+}
+
+}
@@ -0,0 +1,124 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Measures each audio device callback against its buffer period.
+
+    The DSP load of every callback goes into a lock-free histogram, callbacks
+    which miss their deadline are counted and the slowest few are kept along
+    with what happened during them. Everything is written by the device
+    thread and may be read from any other.
+
+    A slow block with a high graph load means a node spiked. A slow block
+    where the graphs took little of it, or a callback which started late,
+    points at the engine or the device stalling.
+ */
+class CallbackTelemetry
+{
+public:
+    /** Things which happened during a callback */
+    enum Event
+    {
+        graphSwitched   = 1 << 0,
+        sequenceSwapped = 1 << 1,
+        programChanged  = 1 << 2
+    };
+
+    /** One of the slowest callbacks */
+    struct Block
+    {
+        int64 time = 0;             ///< when it finished, in Time::currentTimeMillis()
+        float load = 0.f;           ///< callback time as a percentage of the buffer period
+        float graphLoad = 0.f;      ///< time spent rendering graphs, as above
+        float interval = 0.f;       ///< time since the previous callback started, as above
+        int events = 0;             ///< Event flags
+
+        /** A one line summary, e.g. for tooltips and logs */
+        String toString() const;
+    };
+
+    struct Stats
+    {
+        enum { bucketPercent = 2 };
+
+        int64 numCallbacks = 0;
+        int64 numOverruns = 0;      ///< callbacks which took longer than their period
+        int64 numLate = 0;          ///< callbacks which started over 1.5 periods after the last
+        int numDeviceXruns = 0;     ///< as reported by the device, filled in by AudioEngine
+        double meanLoad = 0.0;      ///< percentages of the buffer period
+        double p99Load = 0.0;
+        double maxLoad = 0.0;
+        Array<int> histogram;       ///< callbacks per bucketPercent wide load range
+        Array<Block> worstBlocks;   ///< slowest first
+    };
+
+    CallbackTelemetry();
+
+    /** Call at the start of the device callback. Returns the tick count to
+        pass to callbackFinished() */
+    int64 callbackStarted() noexcept;
+
+    /** Add time spent rendering graphs in the current callback */
+    void addGraphTicks (const int64 ticks) noexcept { graphTicks += ticks; }
+
+    /** Flag something which happened in the current callback */
+    void addEvents (const int eventFlags) noexcept { events |= eventFlags; }
+
+    /** Call at the end of the device callback */
+    void callbackFinished (const int64 startTicks, const int numSamples, const double sampleRate) noexcept;
+
+    /** Clears everything collected. The device thread does the actual
+        clearing the next time it finishes a callback */
+    void reset() noexcept;
+
+    /** Summarises the callbacks measured so far */
+    Stats getStats() const;
+
+private:
+    enum { numBuckets = 100, numWorstBlocks = 8 };
+
+    Atomic<int> buckets [numBuckets];
+    Atomic<int64> numCallbacks, numOverruns, numLate, totalPermille, maxPermille;
+    Atomic<int> resetPending { 0 };
+
+    // written with a sequence lock so readers never see half a block
+    struct BlockSlot
+    {
+        Atomic<int> sequence, load, graphLoad, interval, events;
+        Atomic<int64> time;
+    };
+    BlockSlot worst [numWorstBlocks];
+
+    // device thread only
+    int64 lastStartTicks = 0;
+    int64 graphTicks = 0;
+    int events = 0;
+    int worstPermille [numWorstBlocks];
+
+    void clear() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (CallbackTelemetry)
+};
+
+}
@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/FixedMidiBuffer.h"
+
+namespace Element {
+
+Atomic<int64> FixedMidiBuffer::numDropped { 0 };
+
+void FixedMidiBuffer::Reader::reset (const MidiBuffer& buffer) noexcept
+{
+    new (&iterator) MidiBuffer::Iterator (buffer);
+    next();
+}
+
+void FixedMidiBuffer::Reader::next() noexcept
+{
+    if (! getIterator().getNextEvent (data, numBytes, time))
+        data = nullptr;
+}
+
+int FixedMidiBuffer::getNumBytesUsed (const MidiBuffer& buffer) noexcept
+{
+    int numBytes = 0;
+    for (Reader reader (buffer); ! reader.isDone(); reader.next())
+        numBytes += reader.getEventSize();
+    return numBytes;
+}
+
+void FixedMidiBuffer::addIfRoom (MidiBuffer& dest, int& numBytesUsed, const Reader& reader, const int frame) noexcept
+{
+    const int eventSize = reader.getEventSize();
+    if (numBytesUsed + eventSize > capacity)
+    {
+        ++numDropped;
+        return;
+    }
+
+    dest.addEvent (reader.getData(), reader.getNumBytes(), frame);
+    numBytesUsed += eventSize;
+}
+
+bool FixedMidiBuffer::addEvent (MidiBuffer& buffer, const uint8* data, int numBytes, int frame) noexcept
+{
+    if (numBytes <= 0)
+        return false;
+
+    if (getNumBytesUsed (buffer) + getEventSize (numBytes) > capacity)
+    {
+        ++numDropped;
+        return false;
+    }
+
+    buffer.addEvent (data, numBytes, frame);
+    return true;
+}
+
+void FixedMidiBuffer::copy (MidiBuffer& dest, const MidiBuffer& source) noexcept
+{
+    jassert (&dest != &source);
+    dest.clear();
+
+    int numBytesUsed = 0;
+    for (Reader reader (source); ! reader.isDone(); reader.next())
+        addIfRoom (dest, numBytesUsed, reader, reader.getTime());
+}
+
+void FixedMidiBuffer::merge (MidiBuffer& dest, Reader* readers, const int numReaders) noexcept
+{
+    dest.clear();
+    int numBytesUsed = 0;
+
+    for (;;)
+    {
+        Reader* next = nullptr;
+        for (int i = 0; i < numReaders; ++i)
+            if (! readers[i].isDone() && (next == nullptr || readers[i].getTime() < next->getTime()))
+                next = readers + i;
+
+        if (next == nullptr)
+            break;
+
+        // events come out in time order, so each one goes on the end
+        addIfRoom (dest, numBytesUsed, *next, next->getTime());
+        next->next();
+    }
+}
+
+void FixedMidiBuffer::append (MidiBuffer& dest, Reader& reader, const int endTime, const int timeOffset) noexcept
+{
+    int numBytesUsed = getNumBytesUsed (dest);
+    for (; ! reader.isDone() && reader.getTime() < endTime; reader.next())
+        addIfRoom (dest, numBytesUsed, reader, reader.getTime() + timeOffset);
+}
+
+int64 FixedMidiBuffer::getNumDroppedEvents() noexcept   { return numDropped.get(); }
+void FixedMidiBuffer::resetNumDroppedEvents() noexcept  { numDropped = 0; }
+
+}
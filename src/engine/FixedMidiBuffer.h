@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Audio thread writes to MidiBuffers which never make them grow.
+
+    Every MIDI buffer the engine renders with is reserved to the same capacity
+    up front, so any two of them can be swapped freely. Writes made through
+    here drop events which don't fit instead of reallocating, and count them.
+    Only MidiBuffer's public API is used, so sizes are what a MidiBuffer
+    stores per event rather than read from its storage.
+ */
+struct FixedMidiBuffer
+{
+    /** Bytes reserved for each buffer: a little over a thousand 3-byte events */
+    static const int capacity = 8192;
+
+    /** Reserves the full capacity in a buffer. Not realtime safe */
+    static void reserve (MidiBuffer& buffer)
+    {
+        buffer.ensureSize ((size_t) capacity);
+    }
+
+    /** Bytes a MidiBuffer stores for an event with numBytes of data */
+    static int getEventSize (const int numBytes) noexcept
+    {
+        return numBytes + (int) (sizeof (int32) + sizeof (uint16));
+    }
+
+    /** Bytes currently used by a buffer's events. This walks the events */
+    static int getNumBytesUsed (const MidiBuffer& buffer) noexcept;
+
+    /** Adds an event if it fits. Returns false and counts a drop if not */
+    static bool addEvent (MidiBuffer& buffer, const uint8* data, int numBytes, int frame) noexcept;
+
+    /** Adds an event if it fits. Returns false and counts a drop if not */
+    static bool addEvent (MidiBuffer& buffer, const MidiMessage& msg, int frame) noexcept
+    {
+        return addEvent (buffer, msg.getRawData(), msg.getRawDataSize(), frame);
+    }
+
+    /** Replaces the events in dest with those in source. Unlike
+        MidiBuffer::operator= this reuses dest's storage */
+    static void copy (MidiBuffer& dest, const MidiBuffer& source) noexcept;
+
+    /** Walks the events in a MidiBuffer, one at a time. A default constructed
+        reader is done until reset() gives it a buffer. Zeroed memory is a
+        valid default reader too */
+    class Reader
+    {
+    public:
+        Reader() noexcept { }
+        explicit Reader (const MidiBuffer& buffer) noexcept  { reset (buffer); }
+
+        /** Starts reading a buffer from its first event */
+        void reset (const MidiBuffer& buffer) noexcept;
+
+        bool isDone() const noexcept            { return data == nullptr; }
+        int getTime() const noexcept            { return time; }
+        int getNumBytes() const noexcept        { return numBytes; }
+        const uint8* getData() const noexcept   { return data; }
+        int getEventSize() const noexcept       { return FixedMidiBuffer::getEventSize (numBytes); }
+        void next() noexcept;
+
+    private:
+        // MidiBuffer::Iterator can't be reassigned, so it's built in place.
+        // It owns nothing and is never destroyed
+        std::aligned_storage<sizeof (MidiBuffer::Iterator),
+                             alignof (MidiBuffer::Iterator)>::type iterator;
+        const uint8* data = nullptr;
+        int numBytes = 0, time = 0;
+
+        MidiBuffer::Iterator& getIterator() noexcept { return *reinterpret_cast<MidiBuffer::Iterator*> (&iterator); }
+        JUCE_DECLARE_NON_COPYABLE (Reader)
+    };
+
+    /** Clears dest and fills it with the events of every reader in time order.
+        Events at the same time keep the order of the readers they came from,
+        which matches adding the buffers one after another with addEvents().
+        This is a single k-way pass which only ever appends to dest, where
+        addEvents() would sort the events of each buffer in. dest must not be
+        read from. */
+    static void merge (MidiBuffer& dest, Reader* readers, int numReaders) noexcept;
+
+    /** Appends the events of a reader that come before endTime to dest, moved
+        by timeOffset, and leaves the reader on the first event it didn't take.
+        The moved events must not be earlier than any already in dest */
+    static void append (MidiBuffer& dest, Reader& reader, int endTime, int timeOffset) noexcept;
+
+    /** Number of events dropped because a buffer was full */
+    static int64 getNumDroppedEvents() noexcept;
+
+    /** Counts an event dropped by some other fixed size store of MIDI */
+    static void countDroppedEvent() noexcept { ++numDropped; }
+
+    /** Sets the dropped event count back to zero */
+    static void resetNumDroppedEvents() noexcept;
+
+private:
+    static Atomic<int64> numDropped;
+
+    /** Adds the reader's current event at 'frame' if it fits in the
+        numBytesUsed already taken. Counts a drop if not */
+    static void addIfRoom (MidiBuffer& dest, int& numBytesUsed, const Reader& reader, int frame) noexcept;
+
+};
+
+}
@@ -54,6 +54,24 @@ GraphNode::~GraphNode()
     parent = nullptr;
 }
 
+bool GraphNode::MidiFilterSettings::isDefault() const noexcept
+{
+    return keyRange == Range<int> (0, 127) && transposeOffset == 0
+        && midiChannels.isOmni() && ! midiProgramsEnabled;
+}
+
+void GraphNode::publishMidiFilterSettings()
+{
+    // the lock keeps more than one thread from writing at once
+    ScopedLock sl (propertyLock);
+    auto& settings = midiFilterSettings.getWriteBuffer();
+    settings.keyRange = getKeyRange();
+    settings.transposeOffset = getTransposeOffset();
+    settings.midiChannels = midiChannels;
+    settings.midiProgramsEnabled = areMidiProgramsEnabled();
+    midiFilterSettings.publish();
+}
+
 bool GraphNode::isSpecialParameter (int parameter)
 {
     return parameter >= SpecialParameterBegin && parameter < SpecialParameterEnd;
@@ -191,6 +209,18 @@ void GraphNode::setOutputRMS (int chan, float val)
         outRMS.getUnchecked(chan)->set(val);
 }
 
+void GraphNode::setInputPeak (int chan, float val)
+{
+    if (chan < inPeak.size())
+        inPeak.getUnchecked(chan)->set(val);
+}
+
+void GraphNode::setOutputPeak (int chan, float val)
+{
+    if (chan < outPeak.size())
+        outPeak.getUnchecked(chan)->set(val);
+}
+
 bool GraphNode::isSuspended() const
 {
     return bypassed.get() == 1;
@@ -299,19 +329,27 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
             suspendProcessing (true);
 
         inRMS.clearQuick (true);
+        inPeak.clearQuick (true);
         for (int i = 0; i < getNumAudioInputs(); ++i)
         {
             AtomicValue<float>* avf = new AtomicValue<float>();
             avf->set(0);
             inRMS.add (avf);
+            avf = new AtomicValue<float>();
+            avf->set(0);
+            inPeak.add (avf);
         }
 
         outRMS.clearQuick (true);
+        outPeak.clearQuick (true);
         for (int i = 0; i < getNumAudioOutputs(); ++i)
         {
             AtomicValue<float>* avf = new AtomicValue<float>();
             avf->set(0);
             outRMS.add(avf);
+            avf = new AtomicValue<float>();
+            avf->set(0);
+            outPeak.add (avf);
         }
     }
 }
@@ -323,6 +361,8 @@ void GraphNode::unprepare()
         isPrepared = false;
         inRMS.clear (true);
         outRMS.clear (true);
+        inPeak.clear (true);
+        outPeak.clear (true);
         releaseResources();
     }
 }
@@ -646,6 +686,14 @@ void GraphNode::setParentGraph (GraphProcessor* const graph)
         metadata.setProperty (Slugs::name, iop->getName(), nullptr);
         resetPorts();
     }
+    else if (auto* const device = dynamic_cast<MidiDeviceProcessor*> (getAudioProcessor()))
+    {
+        device->setParentGraph (parent);
+    }
+    else if (auto* const subGraph = dynamic_cast<GraphProcessor*> (getAudioProcessor()))
+    {
+        subGraph->setParentGraph (parent);
+    }
 }
 
 void GraphNode::setMuted (bool muted)
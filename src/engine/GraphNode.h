@@ -20,6 +20,8 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/NodeProfile.h"
+#include "engine/TripleBuffer.h"
 
 namespace Element {
 
@@ -184,6 +186,27 @@ public:
     float getInputRMS(int chan) const { return (chan < inRMS.size()) ? inRMS.getUnchecked(chan)->get() : 0.0f; }
     void setOutputRMS (int chan, float val);
     float getOutputRMS (int chan) const { return (chan < outRMS.size()) ? outRMS.getUnchecked(chan)->get() : 0.0f; }
+    void setInputPeak (int chan, float val);
+    float getInputPeak (int chan) const { return (chan < inPeak.size()) ? inPeak.getUnchecked(chan)->get() : 0.0f; }
+    void setOutputPeak (int chan, float val);
+    float getOutputPeak (int chan) const { return (chan < outPeak.size()) ? outPeak.getUnchecked(chan)->get() : 0.0f; }
+
+    /** Levels are only measured while something is watching them. Call this
+        when a meter for this node is shown, and removeMeterWatcher() when it
+        is hidden again */
+    void addMeterWatcher() noexcept         { ++meterWatchers; }
+
+    /** Call when a meter added with addMeterWatcher() is hidden */
+    void removeMeterWatcher() noexcept      { jassert (meterWatchers.get() > 0); --meterWatchers; }
+
+    /** Returns true if levels should be measured */
+    bool isMetering() const noexcept        { return meterWatchers.get() > 0; }
+
+    /** Render timings for this node, collected while NodeProfile is enabled */
+    NodeProfile& getProfile() noexcept { return profile; }
+
+    /** Returns a summary of this node's render timings */
+    NodeProfile::Stats getProfileStats() const { return profile.getStats(); }
 
     //=========================================================================
     /** Connect this node's output audio to another node's input audio */
@@ -203,6 +226,7 @@ public:
         jassert (isPositiveAndBelow (low, 128));
         jassert (isPositiveAndBelow (high, 128));
         keyRangeLow.set (low); keyRangeHigh.set (high);
+        publishMidiFilterSettings();
     }
 
     inline void setKeyRange (const Range<int>& range) { setKeyRange (range.getStart(), range.getEnd()); }
@@ -214,6 +238,7 @@ public:
     {
         jassert (value >= -24 && value <= 24);
         transposeOffset.set (value);
+        publishMidiFilterSettings();
     }
 
     inline int getTransposeOffset() const { return transposeOffset.get(); }
@@ -235,7 +260,11 @@ public:
     inline bool areMidiProgramsEnabled() const         { return midiProgramsEnabled.get() == 1; }
 
     /** Enable or disable changing midi programs */
-    inline void setMidiProgramsEnabled (bool enabled)  { midiProgramsEnabled.set (enabled ? 1 : 0); }
+    inline void setMidiProgramsEnabled (bool enabled)
+    {
+        midiProgramsEnabled.set (enabled ? 1 : 0);
+        publishMidiFilterSettings();
+    }
 
     /** Returns the active midi program */
     inline int getMidiProgram() const                  { return midiProgram.get(); }
@@ -271,12 +300,32 @@ public:
     //=========================================================================
     inline void setMidiChannels (const BigInteger& ch)
     {
-        ScopedLock sl (propertyLock);
-        midiChannels.setChannels (ch);
+        {
+            ScopedLock sl (propertyLock);
+            midiChannels.setChannels (ch);
+        }
+        publishMidiFilterSettings();
     }
 
     inline const MidiChannels& getMidiChannels() const { return midiChannels; }
 
+    //=========================================================================
+    /** The settings used to filter MIDI going into a node, as one value */
+    struct MidiFilterSettings
+    {
+        Range<int> keyRange { 0, 127 };
+        int transposeOffset = 0;
+        MidiChannels midiChannels;
+        bool midiProgramsEnabled = false;
+
+        /** True if the filter wouldn't change anything */
+        bool isDefault() const noexcept;
+    };
+
+    /** Returns the latest MIDI filter settings without locking. Only the
+        thread rendering this node may call this */
+    inline const MidiFilterSettings& getMidiFilterSettings() noexcept { return midiFilterSettings.read(); }
+
     //=========================================================================
     inline virtual int getNumPrograms() const
     { 
@@ -356,7 +405,9 @@ private:
     String name;
 
     Atomic<float> gain, lastGain, inputGain, lastInputGain;
-    OwnedArray<AtomicValue<float> > inRMS, outRMS;
+    OwnedArray<AtomicValue<float> > inRMS, outRMS, inPeak, outPeak;
+    Atomic<int> meterWatchers { 0 };
+    NodeProfile profile;
     
     Atomic<int> keyRangeLow { 0 };
     Atomic<int> keyRangeHigh { 127 };
@@ -369,6 +420,9 @@ private:
     Atomic<int> globalMidiPrograms { 0 };
 
     CriticalSection propertyLock;
+    TripleBuffer<MidiFilterSettings> midiFilterSettings;
+    void publishMidiFilterSettings();
+
     struct EnablementUpdater : public AsyncUpdater
     {
         EnablementUpdater (GraphNode& g) : graph (g) { }
@@ -84,10 +84,10 @@
             {
                 if (isOutput())
                 {
-                    for (int i = jmin (graph->currentAudioOutputBuffer.getNumChannels(),
+                    for (int i = jmin (graph->currentAudioOutput->getNumChannels(),
                                        buffer.getNumChannels()); --i >= 0;)
                     {
-                        graph->currentAudioOutputBuffer.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
+                        graph->currentAudioOutput->addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
                     }
                 }
                 else
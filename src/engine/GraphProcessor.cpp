@@ -18,8 +18,12 @@
 */
 
 #include "engine/nodes/AudioProcessorNode.h"
+#include "engine/AheadBuffer.h"
+#include "engine/AllocationCounter.h"
 #include "engine/AudioEngine.h"
+#include "engine/FixedMidiBuffer.h"
 #include "engine/GraphProcessor.h"
+#include "engine/LevelMeter.h"
 #include "engine/MidiPipe.h"
 #include "engine/MidiTranspose.h"
 #include "engine/nodes/SubGraphProcessor.h"
@@ -32,189 +36,730 @@ const int GraphProcessor::midiChannelIndex = 0x1000;
 namespace GraphRender
 {
 
-class Task
+/** Something a rendering op reads or writes. Used to find which ops can
+    safely run at the same time, and how long each buffer's contents live */
+struct Resource
 {
-public:
-    Task() { }
-    virtual ~Task()  { }
+    enum Kind
+    {
+        AudioBuffer = 0,
+        MidiBuffer,
+        GraphAudioInput,
+        GraphAudioOutput,
+        GraphMidiInput,
+        GraphMidiOutput
+    };
+
+    int kind;
+    int index;
+    bool writes;
+    bool overwrites = false;    // the op replaces the contents without reading them
+};
+
+/** Buffer renames for one op, from the index used while building the program
+    to the one it renders with. See RenderProgram::assignBuffers */
+struct BufferMap
+{
+    Array<int> audio, midi;
 
-    virtual void perform (AudioSampleBuffer& sharedBufferChans,
-                          const OwnedArray <MidiBuffer>& sharedMidiBuffers,
-                          const int numSamples) = 0;
+    int operator() (const int kind, const int index) const noexcept
+    {
+        return kind == Resource::AudioBuffer ? audio.getUnchecked (index)
+                                             : midi.getUnchecked (index);
+    }
+};
 
-    JUCE_LEAK_DETECTOR (Task);
+/** State shared by a graph and every rendering sequence compiled for it */
+struct RenderContext
+{
+    Atomic<int> skipSilentNodes { 0 };
+    Atomic<int64> numNodeBlocksProcessed { 0 };
+    Atomic<int64> numNodeBlocksSkipped { 0 };
+    Atomic<int64> numAheadBlocksMissed { 0 };
+    Atomic<int64> numAheadBlocksRendered { 0 };
+
+    /** Cleared by the audio thread for a block the nodes rendered ahead
+        weren't ready for. Their taps output silence instead of reading */
+    Atomic<int> aheadReady { 1 };
 };
 
-class ClearChannelOp : public Task
+/** A copy of the parts of a node needed to compile a rendering sequence. These
+    are taken on the message thread so compiling can happen on another one */
+class NodeInfo
 {
 public:
-    ClearChannelOp (const int channelNum_)
-        : channelNum (channelNum_)
-    { }
+    NodeInfo (GraphNode* const graphNode)
+        : node (graphNode),
+          nodeId (graphNode->nodeId),
+          latencySamples (graphNode->getLatencySamples()),
+          audioIONode (graphNode->isAudioIONode()),
+          renderAhead (! audioIONode && ! graphNode->isMidiIONode()
+                        && ! graphNode->isMidiDeviceNode() && ! graphNode->isGraph())
+    {
+        if (auto* const ioproc = dynamic_cast<GraphProcessor::AudioGraphIOProcessor*> (graphNode->getAudioProcessor()))
+            ioType = (int) ioproc->getType();
+
+        if (auto* const parent = graphNode->getParentGraph())
+            if (parent->getSampleRate() > 0.0)
+                sampleRate = parent->getSampleRate();
+
+        const auto stats = graphNode->getProfileStats();
+        if (stats.numBlocks > 0)
+            renderCost = stats.meanMicros;
+
+        if (auto* const proc = graphNode->getAudioProcessor())
+        {
+            if (proc->getSampleRate() > 0.0)
+                sampleRate = proc->getSampleRate();
+            const double tail = proc->silenceInProducesSilenceOut() ? 0.0 : proc->getTailLengthSeconds();
+            if (tail >= 0.0 && tail < 3600.0)
+                tailSamples = (int64) std::ceil (tail * sampleRate);
+        }
+
+        for (int i = 0; i < PortType::Unknown; ++i)
+            numInputs[i] = numOutputs[i] = 0;
+
+        for (uint32 port = 0; port < graphNode->getNumPorts(); ++port)
+        {
+            const Port info = { graphNode->getPortType (port),
+                                graphNode->isPortInput (port),
+                                graphNode->getChannelPort (port) };
+            ports.add (info);
+
+            const int type = info.type.id();
+            if (! isPositiveAndBelow (type, (int) PortType::Unknown))
+                continue;
+
+            if (info.isInput)
+                ++numInputs[type];
+            else
+                ++numOutputs[type];
+
+            auto& channelPorts = info.isInput ? inputPorts[type] : outputPorts[type];
+            while (channelPorts.size() <= info.channel)
+                channelPorts.add (KV_INVALID_PORT);
+            channelPorts.set (info.channel, port);
+        }
+    }
+
+    const GraphNodePtr node;
+    const uint32 nodeId;
+
+    /** The IOProcessor::IODeviceType of this node, or -1 if not an IO node */
+    int getIOType() const noexcept                      { return ioType; }
+    int getLatencySamples() const noexcept              { return latencySamples; }
+    bool isAudioIONode() const noexcept                 { return audioIONode; }
+
+    /** False for nodes which deal with devices or the graph's own IO, which
+        always render in the device callback */
+    bool canRenderAhead() const noexcept                { return renderAhead; }
+
+    /** Samples of output after the input goes silent, or -1 if unknown or infinite */
+    int64 getTailSamples() const noexcept               { return tailSamples; }
+
+    /** The rate the node is rendered at */
+    double getSampleRate() const noexcept               { return sampleRate; }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    /** Average microseconds per block while profiled, or -1 if never profiled */
+    double getRenderCost() const noexcept               { return renderCost; }
+
+    uint32 getNumPorts() const noexcept                 { return (uint32) ports.size(); }
+    PortType getPortType (const uint32 port) const      { return ports.getReference((int) port).type; }
+    bool isPortInput (const uint32 port) const          { return ports.getReference((int) port).isInput; }
+    bool isPortOutput (const uint32 port) const         { return ! isPortInput (port); }
+    int getChannelPort (const uint32 port) const        { return ports.getReference((int) port).channel; }
+
+    int getNumPorts (const PortType type, const bool isInput) const
     {
-        sharedBufferChans.clear (channelNum, 0, numSamples);
+        if (! isPositiveAndBelow (type.id(), (int) PortType::Unknown))
+            return 0;
+        return isInput ? numInputs[type.id()] : numOutputs[type.id()];
     }
 
-private:
-    const int channelNum;
+    uint32 getNthPort (const PortType type, const int channel, bool isInput, bool oneBased) const
+    {
+        jassert (! oneBased); ignoreUnused (oneBased);
+        if (! isPositiveAndBelow (type.id(), (int) PortType::Unknown))
+            return KV_INVALID_PORT;
+        const auto& channelPorts = isInput ? inputPorts[type.id()] : outputPorts[type.id()];
+        return isPositiveAndBelow (channel, channelPorts.size())
+            ? channelPorts.getUnchecked (channel) : KV_INVALID_PORT;
+    }
 
-    JUCE_DECLARE_NON_COPYABLE (ClearChannelOp)
+private:
+    struct Port
+    {
+        PortType type;
+        bool isInput;
+        int channel;
+    };
+
+    int ioType = -1;
+    int64 tailSamples = -1;
+    double sampleRate = 44100.0;
+    double renderCost = -1.0;
+    const int latencySamples;
+    const bool audioIONode;
+    const bool renderAhead;
+    Array<Port> ports;
+    int numInputs [PortType::Unknown];
+    int numOutputs [PortType::Unknown];
+    Array<uint32> inputPorts [PortType::Unknown];
+    Array<uint32> outputPorts [PortType::Unknown];
+
+    JUCE_DECLARE_NON_COPYABLE (NodeInfo)
 };
 
+/** Everything needed to compile a rendering sequence for a graph */
+struct GraphSnapshot
+{
+    struct Connection
+    {
+        uint32 sourceNode, sourcePort, destNode, destPort;
+    };
+
+    OwnedArray<NodeInfo> nodes;
+    Array<Connection> connections;
+    RenderContext* context = nullptr;
+
+    /** Counts the graph's snapshots, so a later one has a higher serial */
+    int serial = 0;
+
+    /** Nodes to render ahead of the device callback, if any. See splitForRenderingAhead */
+    std::unique_ptr<GraphSnapshot> ahead;
+
+    /** A buffer filled by a snapshot rendered ahead, and the node whose outputs it holds */
+    struct AheadTap
+    {
+        uint32 nodeId;
+        AheadBuffer::Ptr buffer;
+    };
+
+    /** The buffers this snapshot fills, if it is rendered ahead */
+    Array<AheadTap> aheadTaps;
+
+    /** Pipeline stages after the first, which is this snapshot. See splitIntoStages */
+    OwnedArray<GraphSnapshot> stages;
+};
 
-class CopyChannelOp : public Task
+/** Stands in for a node rendered ahead, reading its outputs from an AheadBuffer.
+    It has the same ID and ports as the node it replaces. If given a context,
+    it outputs silence for blocks where the context's aheadReady is cleared */
+class AheadTapNode : public GraphNode
 {
 public:
-    CopyChannelOp (const int srcChannelNum_, const int dstChannelNum_)
-        : srcChannelNum (srcChannelNum_),
-          dstChannelNum (dstChannelNum_)
-    { }
+    AheadTapNode (const NodeInfo& source, AheadBuffer* const aheadBuffer, const int latency,
+                  const RenderContext* const aheadContext = nullptr)
+        : GraphNode (source.nodeId),
+          buffer (aheadBuffer),
+          context (aheadContext)
+    {
+        for (uint32 port = 0; port < source.getNumPorts(); ++port)
+            ports.add (source.getPortType (port), (int) port, source.getChannelPort (port),
+                       "ahead_" + String (port), String(), source.isPortInput (port));
+
+        // the rendering op's buffers are in port order, with outputs sharing
+        // the buffers of inputs with the same channel
+        for (uint32 port = 0; port < source.getNumPorts(); ++port)
+        {
+            const PortType type (source.getPortType (port));
+            if (type != PortType::Audio && type != PortType::Midi)
+                continue;
+
+            const int channel = source.getChannelPort (port);
+            const int numIns  = source.getNumPorts (type, true);
+            const int numOuts = source.getNumPorts (type, false);
+            auto& outputs = type == PortType::Audio ? audioOutputs : midiOutputs;
+
+            if (source.isPortInput (port))
+                outputs.add (channel < numOuts ? channel : -1);
+            else if (channel >= numIns && channel < numOuts)
+                outputs.add (channel);
+        }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+        setLatencySamples (latency);
+    }
+
+    bool wantsMidiPipe() const override { return true; }
+
+    void render (AudioSampleBuffer& audio, MidiPipe& midi) override
     {
-        sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        const int numSamples = audio.getNumSamples();
+        if (context != nullptr && context->aheadReady.get() == 0)
+        {
+            audio.clear (0, numSamples);
+            for (int i = midi.getNumBuffers(); --i >= 0;)
+                midi.getWriteBuffer (i)->clear();
+            return;
+        }
+
+        for (int i = jmin (audioOutputs.size(), audio.getNumChannels()); --i >= 0;)
+            if (audioOutputs.getUnchecked (i) >= 0)
+                buffer->readAudio (audioOutputs.getUnchecked (i), audio.getWritePointer (i), numSamples);
+        for (int i = jmin (midiOutputs.size(), midi.getNumBuffers()); --i >= 0;)
+            if (midiOutputs.getUnchecked (i) >= 0)
+                buffer->readMidi (midiOutputs.getUnchecked (i), *midi.getWriteBuffer (i), numSamples);
+        buffer->finishRead (numSamples);
     }
 
-private:
-    const int srcChannelNum, dstChannelNum;
+    void renderBypassed (AudioSampleBuffer& audio, MidiPipe& midi) override { render (audio, midi); }
 
-    JUCE_DECLARE_NON_COPYABLE (CopyChannelOp)
-};
+    void prepareToRender (double, int) override { }
+    void releaseResources() override { }
+    void getState (MemoryBlock&) override { }
+    void setState (const void*, int) override { }
+
+protected:
+    void createPorts() override { }
 
+private:
+    const AheadBuffer::Ptr buffer;
+    const RenderContext* const context;
+    Array<int> audioOutputs, midiOutputs;   // output channel for each buffer, or -1
+};
 
-class AddChannelOp : public Task
+/** Writes the outputs of a node rendered ahead into an AheadBuffer. Its inputs
+    are the node's audio outputs and then its MIDI outputs */
+class AheadSinkNode : public GraphNode
 {
 public:
-    AddChannelOp (const int srcChannelNum_, const int dstChannelNum_)
-        : srcChannelNum (srcChannelNum_),
-          dstChannelNum (dstChannelNum_)
-    { }
+    AheadSinkNode (const uint32 nodeId, AheadBuffer* const aheadBuffer)
+        : GraphNode (nodeId),
+          buffer (aheadBuffer)
+    {
+        int index = 0;
+        for (int i = 0; i < buffer->getNumAudioChannels(); ++i)
+            ports.add (PortType::Audio, index++, i, "audio_in_" + String (i), String(), true);
+        for (int i = 0; i < buffer->getNumMidiStreams(); ++i)
+            ports.add (PortType::Midi, index++, i, "midi_in_" + String (i), String(), true);
+    }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    bool wantsMidiPipe() const override { return true; }
+
+    void render (AudioSampleBuffer& audio, MidiPipe& midi) override
     {
-        sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        const int numSamples = audio.getNumSamples();
+        for (int i = 0; i < buffer->getNumAudioChannels(); ++i)
+            buffer->writeAudio (i, audio.getReadPointer (i), numSamples);
+        for (int i = 0; i < buffer->getNumMidiStreams(); ++i)
+            buffer->writeMidi (i, *midi.getReadBuffer (i));
+        buffer->finishWrite (numSamples);
     }
 
-private:
-    const int srcChannelNum, dstChannelNum;
+    void renderBypassed (AudioSampleBuffer& audio, MidiPipe& midi) override { render (audio, midi); }
 
-    JUCE_DECLARE_NON_COPYABLE (AddChannelOp)
+    void prepareToRender (double, int) override { }
+    void releaseResources() override { }
+    void getState (MemoryBlock&) override { }
+    void setState (const void*, int) override { }
+
+protected:
+    void createPorts() override { }
+
+private:
+    const AheadBuffer::Ptr buffer;
 };
 
+/** Returns the latency at a node's output, including that of the nodes feeding
+    it. Results are cached in outputLatency. If given, connectionDelay returns
+    samples a connection adds on top of its source's latency */
+static int getOutputLatency (const GraphSnapshot& snapshot, const NodeInfo& info,
+                             HashMap<uint32, int>& outputLatency,
+                             const std::function<int(const GraphSnapshot::Connection&)>& connectionDelay = nullptr)
+{
+    if (outputLatency.contains (info.nodeId))
+        return outputLatency [info.nodeId];
+    outputLatency.set (info.nodeId, info.getLatencySamples()); // guards against loops
+
+    int inputLatency = 0;
+    for (const auto& c : snapshot.connections)
+    {
+        if (c.destNode != info.nodeId)
+            continue;
+        for (const auto* const source : snapshot.nodes)
+            if (source->nodeId == c.sourceNode)
+                inputLatency = jmax (inputLatency, getOutputLatency (snapshot, *source, outputLatency, connectionDelay)
+                                                     + (connectionDelay ? connectionDelay (c) : 0));
+    }
+
+    outputLatency.set (info.nodeId, inputLatency + info.getLatencySamples());
+    return outputLatency [info.nodeId];
+}
 
-class ClearMidiBufferOp : public Task
+/** Adds the connections from a node's outputs to an AheadSinkNode writing them */
+static void connectToSink (const NodeInfo& info, const uint32 sinkId, const AheadBuffer& buffer,
+                           Array<GraphSnapshot::Connection>& connections)
 {
-public:
-    ClearMidiBufferOp (const int bufferNum_)
-        : bufferNum (bufferNum_)
-    {}
+    for (uint32 port = 0; port < info.getNumPorts(); ++port)
+    {
+        if (info.isPortInput (port))
+            continue;
+        const PortType type (info.getPortType (port));
+        if (type == PortType::Audio)
+            connections.add ({ info.nodeId, port, sinkId, (uint32) info.getChannelPort (port) });
+        else if (type == PortType::Midi)
+            connections.add ({ info.nodeId, port, sinkId,
+                               (uint32) (buffer.getNumAudioChannels() + info.getChannelPort (port)) });
+    }
+}
+
+/** Moves the nodes which don't depend on live input, directly or through other
+    nodes, into snapshot.ahead. Each one which feeds a live node is replaced
+    by an AheadTapNode, and gets an AheadSinkNode in the ahead snapshot which
+    fills the buffer the tap reads. The buffers hold numSamplesAhead */
+static void splitForRenderingAhead (GraphSnapshot& snapshot, const int numSamplesAhead)
+{
+    // live nodes and everything downstream of them stay in the device callback
+    SortedSet<uint32> live;
+    for (const auto* const info : snapshot.nodes)
+        if (! info->canRenderAhead())
+            live.add (info->nodeId);
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    for (bool changed = true; changed;)
     {
-        sharedMidiBuffers.getUnchecked (bufferNum)->clear();
+        changed = false;
+        for (const auto& c : snapshot.connections)
+        {
+            if (live.contains (c.sourceNode) && ! live.contains (c.destNode))
+            {
+                live.add (c.destNode);
+                changed = true;
+            }
+        }
     }
 
-private:
-    const int bufferNum;
+    if (live.size() == snapshot.nodes.size())
+        return;
 
-    JUCE_DECLARE_NON_COPYABLE (ClearMidiBufferOp)
-};
+    std::unique_ptr<GraphSnapshot> ahead (new GraphSnapshot());
+    ahead->context = snapshot.context;
+
+    // the latency at each ahead node's output, which the taps report
+    HashMap<uint32, int> outputLatency;
+
+    for (int i = snapshot.nodes.size(); --i >= 0;)
+    {
+        auto* const info = snapshot.nodes.getUnchecked (i);
+        if (live.contains (info->nodeId))
+            continue;
 
+        bool feedsLiveNode = false;
+        for (const auto& c : snapshot.connections)
+            feedsLiveNode |= c.sourceNode == info->nodeId && live.contains (c.destNode);
 
-class CopyMidiBufferOp : public Task
+        if (feedsLiveNode)
+        {
+            AheadBuffer::Ptr buffer = new AheadBuffer (info->getNumPorts (PortType::Audio, false),
+                                                       info->getNumPorts (PortType::Midi, false),
+                                                       numSamplesAhead);
+            const uint32 sinkId = 0x80000000u + (uint32) ahead->nodes.size();
+            GraphNodePtr sink = new AheadSinkNode (sinkId, buffer.get());
+            GraphNodePtr tap  = new AheadTapNode (*info, buffer.get(),
+                                                   getOutputLatency (snapshot, *info, outputLatency),
+                                                   snapshot.context);
+
+            connectToSink (*info, sinkId, *buffer, ahead->connections);
+            ahead->aheadTaps.add ({ info->nodeId, buffer });
+            ahead->nodes.add (new NodeInfo (sink.get()));
+            snapshot.nodes.set (i, new NodeInfo (tap.get()), false);
+            ahead->nodes.add (info);
+        }
+        else
+        {
+            ahead->nodes.add (snapshot.nodes.removeAndReturn (i));
+        }
+    }
+
+    // connections into ahead nodes only ever come from other ahead nodes
+    for (int i = snapshot.connections.size(); --i >= 0;)
+    {
+        const auto c = snapshot.connections.getUnchecked (i);
+        if (! live.contains (c.destNode))
+        {
+            ahead->connections.add (c);
+            snapshot.connections.remove (i);
+        }
+    }
+
+    snapshot.ahead = std::move (ahead);
+}
+
+/** A single instruction of a compiled RenderProgram. Ops which keep state
+    between blocks refer to an entry in one of the program's side tables */
+struct Op
+{
+    enum Code
+    {
+        clearChannels = 0,  // clear 'count' channels starting at 'dst'
+        copyChannel,
+        addChannel,
+        sumChannels,        // dst = src + aux
+        clearMidi,
+        copyMidi,
+        mergeMidi,          // 'src' is the index of the MergeMidiOp
+        delayChannel,       // 'src' is the index of the DelayChannelOp
+        delayMidi,          // 'src' is the index of the DelayMidiOp
+        processBuffer       // 'src' is the index of the ProcessBufferOp
+    };
+
+    int32 code;
+    int32 src;
+    int32 dst;
+    int32 aux;      // channel count for clearChannels, second source for sumChannels
+};
+
+/** Delays an audio buffer to line it up with others coming from nodes with
+    more latency. Samples go in and out of a circular buffer a block at a
+    time, as at most two contiguous copies each way */
+class DelayChannelOp
 {
 public:
-    CopyMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
-        : srcBufferNum (srcBufferNum_),
-          dstBufferNum (dstBufferNum_)
-    { }
+    DelayChannelOp (const int channel_, const int numSamplesDelay_)
+        : channel (channel_),
+          delay (numSamplesDelay_)
+    {
+        jassert (delay > 0);
+    }
+
+    /** Allocates the delay line. Not realtime safe */
+    void prepare (const int maxBlockSize)
+    {
+        size = delay + jmax (1, maxBlockSize);
+        buffer.calloc ((size_t) size);
+        writeIndex = 0;
+        silentSamples = 0;
+    }
+
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&,
+                  bool* const silent, const int numSamples)
+    {
+        // once only silence has gone in for the whole delay length there's
+        // nothing left to do
+        if (silent[channel])
+        {
+            if (silentSamples >= delay)
+                return;
+            silentSamples += numSamples;
+        }
+        else
+        {
+            silentSamples = 0;
+        }
+
+        silent[channel] = false;
+        float* data = sharedBufferChans.getWritePointer (channel, 0);
+
+        // blocks longer than the line was prepared for go through in pieces
+        const int maxChunk = size - delay;
+        for (int done = 0; done < numSamples;)
+        {
+            const int num = jmin (maxChunk, numSamples - done);
+            write (data + done, num);
+            read (data + done, num);
+            writeIndex = wrap (writeIndex + num);
+            done += num;
+        }
+    }
+
+    void getResources (Array<Resource>& resources) const
+    {
+        resources.add ({ Resource::AudioBuffer, channel, true });
+    }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    void remapBuffers (const BufferMap& map)
     {
-        *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
+        channel = map (Resource::AudioBuffer, channel);
     }
 
 private:
-    const int srcBufferNum, dstBufferNum;
+    HeapBlock<float> buffer;
+    int channel;
+    const int delay;
+    int size = 0;
+    int writeIndex = 0;
+    int silentSamples = 0;
 
-    JUCE_DECLARE_NON_COPYABLE (CopyMidiBufferOp)
-};
+    int wrap (const int index) const noexcept { return index >= size ? index - size : index; }
+
+    void write (const float* const src, const int num) noexcept
+    {
+        const int first = jmin (num, size - writeIndex);
+        FloatVectorOperations::copy (buffer + writeIndex, src, first);
+        if (first < num)
+            FloatVectorOperations::copy (buffer, src + first, num - first);
+    }
+
+    void read (float* const dst, const int num) const noexcept
+    {
+        const int readIndex = wrap (writeIndex + size - delay);
+        const int first = jmin (num, size - readIndex);
+        FloatVectorOperations::copy (dst, buffer + readIndex, first);
+        if (first < num)
+            FloatVectorOperations::copy (dst + first, buffer, num - first);
+    }
 
+    JUCE_DECLARE_NON_COPYABLE (DelayChannelOp)
+};
 
-class AddMidiBufferOp : public Task
+/** Delays a MIDI buffer by the same amount as the audio next to it, so events
+    don't arrive early at nodes after latent ones */
+class DelayMidiOp
 {
 public:
-    AddMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
-        : srcBufferNum (srcBufferNum_),
-          dstBufferNum (dstBufferNum_)
-    { }
+    DelayMidiOp (const int midiBuffer_, const int numSamplesDelay_)
+        : midiBuffer (midiBuffer_),
+          delay (numSamplesDelay_)
+    {
+        jassert (delay > 0);
+    }
+
+    /** Allocates space for pending events. Not realtime safe */
+    void prepare()
+    {
+        FixedMidiBuffer::reserve (pending);
+        FixedMidiBuffer::reserve (scratch);
+        FixedMidiBuffer::reserve (output);
+    }
+
+    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                  bool*, const int numSamples)
+    {
+        auto& midi = *sharedMidiBuffers.getUnchecked (midiBuffer);
+        if (pending.isEmpty() && midi.isEmpty())
+            return;
+
+        // pending events are timed from the start of the current block
+        output.clear();
+        scratch.clear();
+        const uint8* data; int bytes, frame;
+
+        for (MidiBuffer::Iterator iter (pending); iter.getNextEvent (data, bytes, frame);)
+        {
+            if (frame < numSamples)
+                FixedMidiBuffer::addEvent (output, data, bytes, frame);
+            else
+                FixedMidiBuffer::addEvent (scratch, data, bytes, frame - numSamples);
+        }
+
+        for (MidiBuffer::Iterator iter (midi); iter.getNextEvent (data, bytes, frame);)
+        {
+            const int due = frame + delay;
+            if (due < numSamples)
+                FixedMidiBuffer::addEvent (output, data, bytes, due);
+            else
+                FixedMidiBuffer::addEvent (scratch, data, bytes, due - numSamples);
+        }
+
+        pending.swapWith (scratch);
+        midi.swapWith (output);
+    }
+
+    void getResources (Array<Resource>& resources) const
+    {
+        resources.add ({ Resource::MidiBuffer, midiBuffer, true });
+    }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    void remapBuffers (const BufferMap& map)
     {
-        sharedMidiBuffers.getUnchecked (dstBufferNum)
-            ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
+        midiBuffer = map (Resource::MidiBuffer, midiBuffer);
     }
 
 private:
-    const int srcBufferNum, dstBufferNum;
+    int midiBuffer;
+    const int delay;
+    MidiBuffer pending, scratch, output;
 
-    JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
+    JUCE_DECLARE_NON_COPYABLE (DelayMidiOp)
 };
 
-class DelayChannelOp : public Task
+/** Mixes the MIDI from several sources into one buffer, in a single pass
+    over all of them */
+class MergeMidiOp
 {
 public:
-    DelayChannelOp (const int channel_, const int numSamplesDelay_)
-        : channel (channel_),
-          bufferSize (numSamplesDelay_ + 1),
-          readIndex (0), writeIndex (numSamplesDelay_)
+    MergeMidiOp (const int midiBuffer_, const Array<int>& sources_)
+        : midiBuffer (midiBuffer_),
+          sources (sources_)
     {
-        buffer.calloc ((size_t) bufferSize);
+        jassert (! sources.contains (midiBuffer));
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    /** Allocates the merge space. Not realtime safe */
+    void prepare()
     {
-        float* data = sharedBufferChans.getWritePointer (channel, 0);
+        readers.calloc ((size_t) sources.size() + 1);
+        FixedMidiBuffer::reserve (merged);
+    }
 
-        for (int i = numSamples; --i >= 0;)
-        {
-            buffer [writeIndex] = *data;
-            *data++ = buffer [readIndex];
+    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                  bool*, const int)
+    {
+        auto& midi = *sharedMidiBuffers.getUnchecked (midiBuffer);
+
+        // what's already in the buffer goes first, like with addEvents
+        int numReaders = 0;
+        if (! midi.isEmpty())
+            readers [numReaders++].reset (midi);
+        for (const auto source : sources)
+            if (! sharedMidiBuffers.getUnchecked (source)->isEmpty())
+                readers [numReaders++].reset (*sharedMidiBuffers.getUnchecked (source));
+
+        // nothing to add
+        if (numReaders == 0 || (numReaders == 1 && ! midi.isEmpty()))
+            return;
 
-            if (++readIndex  >= bufferSize) readIndex = 0;
-            if (++writeIndex >= bufferSize) writeIndex = 0;
-        }
+        FixedMidiBuffer::merge (merged, readers, numReaders);
+        midi.swapWith (merged);
+    }
+
+    void getResources (Array<Resource>& resources) const
+    {
+        for (const auto source : sources)
+            resources.add ({ Resource::MidiBuffer, source, false });
+        resources.add ({ Resource::MidiBuffer, midiBuffer, true });
+    }
+
+    void remapBuffers (const BufferMap& map)
+    {
+        midiBuffer = map (Resource::MidiBuffer, midiBuffer);
+        for (auto& source : sources)
+            source = map (Resource::MidiBuffer, source);
     }
 
 private:
-    HeapBlock<float> buffer;
-    const int channel, bufferSize;
-    int readIndex, writeIndex;
+    int midiBuffer;
+    Array<int> sources;
+    HeapBlock<FixedMidiBuffer::Reader> readers;
+    MidiBuffer merged;
 
-    JUCE_DECLARE_NON_COPYABLE (DelayChannelOp)
+    JUCE_DECLARE_NON_COPYABLE (MergeMidiOp)
 };
 
 
-class ProcessBufferOp : public Task
+class ProcessBufferOp
 {
 public:
-    ProcessBufferOp (const GraphNodePtr& node_,
+    ProcessBufferOp (const NodeInfo& info,
+                     RenderContext& context_,
                      const Array <int>& audioChannelsToUse_,
                      const int totalChans_,
                      const int midiBufferToUse_,
                      const Array <int> chans [PortType::Unknown])
-        : node (node_),
-          processor (node_->getAudioPluginInstance()),
+        : context (context_),
+          tailSamples (info.getTailSamples()),
+          sampleRate (info.getSampleRate()),
+          node (info.node),
+          processor (info.node->getAudioPluginInstance()),
           audioChannelsToUse (audioChannelsToUse_),
           midiChannelsToUse (chans[PortType::Midi]),
           totalChans (jmax (1, totalChans_)),
-          numAudioIns (node_->getNumPorts (PortType::Audio, true)),
-          numAudioOuts (node_->getNumPorts (PortType::Audio, false)),
+          numAudioIns (info.getNumPorts (PortType::Audio, true)),
+          numAudioOuts (info.getNumPorts (PortType::Audio, false)),
+          numMidiIns (info.getNumPorts (PortType::Midi, true)),
           midiBufferToUse (midiBufferToUse_)
     {
         channels.calloc ((size_t) totalChans);
+        FixedMidiBuffer::reserve (tempMidi);
 
         while (audioChannelsToUse.size() < totalChans)
             audioChannelsToUse.add (0);
@@ -223,10 +768,36 @@ public:
             midiBufferToUse = chans[PortType::Midi].getFirst();
 
         lastMute = node->isMuted();
+        inputMeter.prepare (numAudioIns, sampleRate);
+        outputMeter.prepare (numAudioOuts, sampleRate);
+
+        typedef GraphProcessor::AudioGraphIOProcessor IOProc;
+        if (info.getIOType() >= 0)
+        {
+            switch (info.getIOType())
+            {
+                case IOProc::audioInputNode:  ioResource = Resource::GraphAudioInput; break;
+                case IOProc::audioOutputNode: ioResource = Resource::GraphAudioOutput; break;
+                case IOProc::midiInputNode:   ioResource = Resource::GraphMidiInput; break;
+                case IOProc::midiOutputNode:  ioResource = Resource::GraphMidiOutput; break;
+                default: break;
+            }
+        }
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                  bool* const silent, const int numSamples)
     {
+        // MIDI outputs start out empty, whatever the buffer held before
+        for (int i = numMidiIns; i < midiChannelsToUse.size(); ++i)
+            sharedMidiBuffers.getUnchecked (midiChannelsToUse.getUnchecked (i))->clear();
+
+        if (canSkip (sharedMidiBuffers, silent, numSamples))
+        {
+            skip (sharedBufferChans, silent, numSamples);
+            return;
+        }
+
         for (int i = totalChans; --i >= 0;) {
             channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
         }
@@ -236,90 +807,90 @@ public:
         if (! node->isEnabled())
         {
             for (int ch = numAudioIns; ch < numAudioOuts; ++ch)
+            {
                 buffer.clear (ch, 0, buffer.getNumSamples());
+                setSilent (silent, ch, true);
+            }
             return;
         }
 
+        // a disabled node isn't processed, so it isn't counted or timed
+        ++context.numNodeBlocksProcessed;
+        const int64 startTicks = NodeProfile::startTimer();
+
         const bool muted = node->isMuted();
         const bool muteInput = node->isMutingInputs();
+        const bool metering = node->isMetering();
 
-        if (muted && muteInput)
+        // input gain, mute and metering in one pass
         {
-            if (lastMute != muted)
+            float startGain = node->getLastInputGain(), endGain = node->getInputGain();
+            if (muted && muteInput)
             {
-                // just became muted
-                buffer.applyGainRamp (0, numSamples, node->getLastInputGain(), 0.0);
+                // ramp down if just muted
+                startGain = lastMute != muted ? startGain : 0.f;
+                endGain = 0.f;
             }
-            else
+            else if (!muted && muteInput && muted != lastMute)
             {
-                // normal mute processing
-                buffer.applyGain (0, numSamples, 0.0);
+                // just became unmuted
+                startGain = 0.f;
             }
-        }
-        else if (!muted && muteInput && muted != lastMute)
-        {
-            // just became unmuted
-            buffer.applyGainRamp (0, numSamples, 0.0, node->getInputGain());
-        }
-        else if (node->getInputGain() != node->getLastInputGain())
-        {
-            buffer.applyGainRamp (0, numSamples, node->getLastInputGain(), node->getInputGain());
-        } 
-        else 
-        {
-            buffer.applyGain (0, numSamples, node->getInputGain());
-        }
 
-        for (int i = numAudioIns; --i >= 0;)
-            node->setInputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+            for (int i = 0; i < totalChans; ++i)
+            {
+                if (audioChannelsToUse.getUnchecked (i) == 0)
+                    continue; // the shared empty buffer
+                if (metering && i < numAudioIns)
+                    inputMeter.addChannel (i, channels[i], numSamples, startGain, endGain);
+                else
+                    LevelMeter::applyGain (channels[i], numSamples, startGain, endGain);
+            }
+        }
 
        #ifndef EL_FREE
-        // Begin MIDI filters
+        // Begin MIDI filters. The settings are read without locking and
+        // the filter is skipped entirely when it wouldn't change anything
+        const auto& filter = node->getMidiFilterSettings();
+        auto& filterMidi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
+        if (! filter.isDefault() && filterMidi.getNumEvents() > 0)
         {
             jassert (tempMidi.getNumEvents() == 0);
-            ScopedLock spl (node->getPropertyLock());
-            transpose.setNoteOffset (node->getTransposeOffset());
-            const auto keyRange (node->getKeyRange());
-            const auto midiChans (node->getMidiChannels());
-            const auto midiProgram (node->getMidiProgram());
-            const auto useMidiProgram (node->areMidiProgramsEnabled());
-
-            if (keyRange.getLength() > 0 || !midiChans.isOmni() || useMidiProgram)
+            transpose.setNoteOffset (filter.transposeOffset);
+            const auto& keyRange (filter.keyRange);
+            const auto& midiChans (filter.midiChannels);
+            const bool useMidiProgram (filter.midiProgramsEnabled);
+
+            auto& midi = filterMidi;
+            MidiBuffer::Iterator iter (midi);
+            int frame = 0; MidiMessage msg;
+            while (iter.getNextEvent (msg, frame))
             {
-                auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
-                MidiBuffer::Iterator iter (midi);
-                int frame = 0; MidiMessage msg;
-                while (iter.getNextEvent (msg, frame))
+                if (msg.isNoteOnOrOff())
                 {
-                    if (msg.isNoteOnOrOff())
-                    {
-                        // out of range 
-                        if (keyRange.getLength() > 0 && (msg.getNoteNumber() < keyRange.getStart() || msg.getNoteNumber() > keyRange.getEnd()))
-                            continue;
-                    }
-
-                    if (msg.getChannel() > 0 && midiChans.isOff (msg.getChannel()))
+                    // out of range 
+                    if (keyRange.getLength() > 0 && (msg.getNoteNumber() < keyRange.getStart() || msg.getNoteNumber() > keyRange.getEnd()))
                         continue;
+                }
 
-                    if (useMidiProgram && msg.isProgramChange())
-                    {
-                        node->setMidiProgram (msg.getProgramChangeNumber());
-                        node->reloadMidiProgram();
-                        continue;
-                    }
+                if (msg.getChannel() > 0 && midiChans.isOff (msg.getChannel()))
+                    continue;
 
-                    transpose.process (msg);
-                    tempMidi.addEvent (msg, frame);
+                if (useMidiProgram && msg.isProgramChange())
+                {
+                    node->setMidiProgram (msg.getProgramChangeNumber());
+                    node->reloadMidiProgram();
+                    continue;
                 }
 
-                midi.swapWith (tempMidi);
-            }
-            else
-            {
-                transpose.process (*sharedMidiBuffers.getUnchecked (midiBufferToUse), numSamples);
+                transpose.process (msg);
+                FixedMidiBuffer::addEvent (tempMidi, msg, frame);
             }
+
+            // tempMidi has the same capacity as the shared buffers, so they can swap
+            midi.swapWith (tempMidi);
+            tempMidi.clear();
         }
-        tempMidi.clear();
         // End MIDI filters
        #endif
         
@@ -343,90 +914,1123 @@ public:
             }
         }
         
-        if (muted && !muteInput)
+        // output gain, mute, metering and silence detection in one pass.
+        // outputs are only measured when metered or to find silence for skipping
         {
-            if (lastMute != muted)
+            float startGain = node->getLastGain(), endGain = node->getGain();
+            if (muted && !muteInput)
             {
-                // just became muted
-                buffer.applyGainRamp (0, numSamples, node->getLastGain(), 0.0);
+                // ramp down if just muted
+                startGain = lastMute != muted ? startGain : 0.f;
+                endGain = 0.f;
             }
-            else
+            else if (!muted && !muteInput && muted != lastMute)
             {
-                // normal mute processing
-                buffer.applyGain (0, numSamples, 0.0);
+                // just became unmuted
+                startGain = 0.f;
             }
+
+            const bool trackSilence = context.skipSilentNodes.get() != 0;
+            for (int i = 0; i < totalChans; ++i)
+            {
+                if (audioChannelsToUse.getUnchecked (i) == 0)
+                    continue; // the shared empty buffer
+
+                if (i >= numAudioOuts || ! (metering || trackSilence))
+                {
+                    LevelMeter::applyGain (channels[i], numSamples, startGain, endGain);
+                    setSilent (silent, i, false);
+                    continue;
+                }
+
+                float peak = 0.f, sumOfSquares = 0.f;
+                if (metering)
+                    peak = outputMeter.addChannel (i, channels[i], numSamples, startGain, endGain);
+                else
+                    LevelMeter::applyGainAndMeasure (channels[i], numSamples, startGain, endGain,
+                                                     peak, sumOfSquares);
+                setSilent (silent, i, trackSilence && peak == 0.f);
+            }
+        }
+
+        node->updateGain();
+        lastMute = muted;
+
+        if (metering)
+            publishLevels (numSamples);
+
+        node->getProfile().stopTimer (startTicks, numSamples, sampleRate);
+    }
+
+    void getResources (Array<Resource>& resources) const
+    {
+        // buffer zero is the read-only empty buffer. Channels after the
+        // inputs are outputs only, so what was in them before doesn't matter
+        for (int i = 0; i < totalChans; ++i)
+        {
+            const int channel = audioChannelsToUse.getUnchecked (i);
+            resources.add ({ Resource::AudioBuffer, channel, channel != 0, channel != 0 && i >= numAudioIns });
+        }
+
+        // midiBufferToUse is the first of the MIDI channels when there are any
+        if (midiChannelsToUse.isEmpty())
+            resources.add ({ Resource::MidiBuffer, midiBufferToUse, midiBufferToUse != 0 });
+        for (int i = 0; i < midiChannelsToUse.size(); ++i)
+        {
+            const int channel = midiChannelsToUse.getUnchecked (i);
+            resources.add ({ Resource::MidiBuffer, channel, channel != 0, channel != 0 && i >= numMidiIns });
         }
-        else if (!muted && !muteInput && muted != lastMute)
+
+        if (ioResource >= 0)
+            resources.add ({ ioResource, 0, ioResource != Resource::GraphAudioInput });
+    }
+
+    void remapBuffers (const BufferMap& map)
+    {
+        for (auto& channel : audioChannelsToUse)
+            channel = map (Resource::AudioBuffer, channel);
+        for (auto& channel : midiChannelsToUse)
+            channel = map (Resource::MidiBuffer, channel);
+        midiBufferToUse = map (Resource::MidiBuffer, midiBufferToUse);
+    }
+
+    RenderContext& context;
+    const int64 tailSamples;
+    const double sampleRate;
+    int64 silentSamples = 0;
+
+    const GraphNodePtr node;
+    AudioProcessor* const processor;
+
+private:
+    int ioResource = -1;
+    Array <int> audioChannelsToUse;
+    Array <int> midiChannelsToUse;
+    HeapBlock <float*> channels;
+    int totalChans, numAudioIns, numAudioOuts, numMidiIns;
+    int midiBufferToUse;
+    bool lastMute = false;
+    MidiTranspose transpose;
+    MidiBuffer tempMidi;
+
+    LevelMeter inputMeter, outputMeter;
+
+    /** Hands the levels to the node at the meter's decimated rate */
+    void publishLevels (const int numSamples) noexcept
+    {
+        inputMeter.advance (numSamples);
+        if (! outputMeter.advance (numSamples))
+            return;
+
+        for (int i = inputMeter.getNumChannels(); --i >= 0;)
+        {
+            node->setInputRMS (i, inputMeter.getRMS (i));
+            node->setInputPeak (i, inputMeter.getPeak (i));
+        }
+
+        for (int i = outputMeter.getNumChannels(); --i >= 0;)
+        {
+            node->setOutputRMS (i, outputMeter.getRMS (i));
+            node->setOutputPeak (i, outputMeter.getPeak (i));
+        }
+
+        inputMeter.reset();
+        outputMeter.reset();
+    }
+
+    void setSilent (bool* const silent, const int index, const bool isSilent) const noexcept
+    {
+        const int channel = audioChannelsToUse.getUnchecked (index);
+        if (channel != 0) // the read-only empty buffer stays silent
+            silent[channel] = isSilent;
+    }
+
+    /** True if this node's audio inputs are silent, it has no MIDI to handle
+        and whatever tail it had has finished. Nodes without audio inputs
+        and graph IO nodes always render */
+    bool canSkip (const OwnedArray<MidiBuffer>& sharedMidiBuffers, const bool* const silent,
+                  const int numSamples)
+    {
+        if (numAudioIns <= 0 || ioResource >= 0 || context.skipSilentNodes.get() == 0)
+            return false;
+
+        bool quiet = sharedMidiBuffers.getUnchecked(midiBufferToUse)->getNumEvents() == 0;
+        for (int i = 0; quiet && i < midiChannelsToUse.size(); ++i)
+            quiet = sharedMidiBuffers.getUnchecked(midiChannelsToUse.getUnchecked (i))->getNumEvents() == 0;
+        for (int i = 0; quiet && i < numAudioIns; ++i)
+            quiet = silent [audioChannelsToUse.getUnchecked (i)];
+
+        if (! quiet)
+        {
+            silentSamples = 0;
+            return false;
+        }
+
+        if (tailSamples >= 0 && silentSamples >= tailSamples)
+            return true;
+
+        silentSamples += numSamples;
+        return false;
+    }
+
+    void skip (AudioSampleBuffer& sharedBufferChans, bool* const silent, const int numSamples)
+    {
+        ++context.numNodeBlocksSkipped;
+
+        for (int i = 0; i < numAudioOuts; ++i)
+        {
+            const int channel = audioChannelsToUse.getUnchecked (i);
+            if (! silent[channel])
+            {
+                sharedBufferChans.clear (channel, 0, numSamples);
+                silent[channel] = true;
+            }
+        }
+
+        if (node->isMetering())
+        {
+            for (int i = numAudioIns; --i >= 0;)
+            {
+                node->setInputRMS (i, 0.f);
+                node->setInputPeak (i, 0.f);
+            }
+
+            for (int i = numAudioOuts; --i >= 0;)
+            {
+                node->setOutputRMS (i, 0.f);
+                node->setOutputPeak (i, 0.f);
+            }
+
+            inputMeter.reset();
+            outputMeter.reset();
+        }
+
+        node->updateGain();
+        lastMute = node->isMuted();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
+};
+
+
+/** A compiled rendering sequence: one contiguous buffer of ops run by perform(),
+    plus side tables for the ops which keep state between blocks. Ops are
+    added one node (step) at a time, and each step is tidied up by a small
+    peephole pass when it ends. */
+class RenderProgram
+{
+public:
+    RenderProgram() { }
+
+    void clearChannel (const int channel)           { ops.add ({ Op::clearChannels, 0, channel, 1 }); }
+    void copyChannel (const int src, const int dst) { ops.add ({ Op::copyChannel, src, dst, 0 }); }
+    void addChannel (const int src, const int dst)  { ops.add ({ Op::addChannel, src, dst, 0 }); }
+    void clearMidi (const int buffer)               { ops.add ({ Op::clearMidi, 0, buffer, 0 }); }
+    void copyMidi (const int src, const int dst)    { ops.add ({ Op::copyMidi, src, dst, 0 }); }
+
+    void mergeMidi (const Array<int>& sources, const int dst)
+    {
+        ops.add ({ Op::mergeMidi, midiMergeOps.size(), dst, 0 });
+        midiMergeOps.add (new MergeMidiOp (dst, sources));
+    }
+
+    void delayChannel (const int channel, const int numSamplesDelay)
+    {
+        ops.add ({ Op::delayChannel, delayOps.size(), channel, 0 });
+        delayOps.add (new DelayChannelOp (channel, numSamplesDelay));
+    }
+
+    void delayMidi (const int buffer, const int numSamplesDelay)
+    {
+        ops.add ({ Op::delayMidi, midiDelayOps.size(), buffer, 0 });
+        midiDelayOps.add (new DelayMidiOp (buffer, numSamplesDelay));
+    }
+
+    /** Allocates what the stateful ops need to render blocks of up to
+        maxBlockSize samples. Call before performing and off the audio thread */
+    void prepare (const int maxBlockSize)
+    {
+        for (auto* const op : delayOps)
+            op->prepare (maxBlockSize);
+        for (auto* const op : midiDelayOps)
+            op->prepare();
+        for (auto* const op : midiMergeOps)
+            op->prepare();
+    }
+
+    void processBuffer (const NodeInfo& node, RenderContext& context,
+                        const Array<int>& audioChannelsToUse,
+                        const int totalChans, const int midiBufferToUse,
+                        const Array<int> chans [PortType::Unknown])
+    {
+        ops.add ({ Op::processBuffer, processOps.size(), 0, 0 });
+        processOps.add (new ProcessBufferOp (node, context, audioChannelsToUse, totalChans,
+                                             midiBufferToUse, chans));
+    }
+
+    /** Call before adding the ops for a node */
+    void beginStep() { stepStart = ops.size(); }
+
+    /** Call after adding the ops for a node */
+    void endStep()
+    {
+        if (ops.size() > stepStart)
+            steps.add (Range<int> (stepStart, ops.size()));
+    }
+
+    /** Call once every step has been added. Shares buffers between values
+        that are never alive at the same time, then tidies up each step */
+    void finish (const int numAudioBuffers, const int numMidiBuffers)
+    {
+        numBuffersBuilt[Resource::AudioBuffer] = numAudioBuffers;
+        numBuffersBuilt[Resource::MidiBuffer]  = numMidiBuffers;
+        assignBuffers();
+        optimise();
+    }
+
+    /** Buffers of a kind needed to perform the program */
+    int getNumBuffers (const int kind) const noexcept   { return numBuffers [kind]; }
+
+    /** Buffers of a kind that were handed out while building the program */
+    int getNumBuffersBuilt (const int kind) const noexcept { return numBuffersBuilt [kind]; }
+
+    int size() const noexcept { return ops.size(); }
+
+    /** The range of ops for each node, in rendering order */
+    const Array<Range<int>>& getSteps() const noexcept { return steps; }
+
+    /** Performs every op. 'silent' holds a flag per audio buffer which is
+        set while the buffer is known to hold nothing but zeros */
+    void perform (AudioSampleBuffer& audio, const OwnedArray<MidiBuffer>& midi,
+                  bool* const silent, const int numSamples) const
+    {
+        perform (0, ops.size(), audio, midi, silent, numSamples);
+    }
+
+    /** Performs the ops in the range [start, end) */
+    void perform (const int start, const int end, AudioSampleBuffer& audio,
+                  const OwnedArray<MidiBuffer>& midi, bool* const silent,
+                  const int numSamples) const
+    {
+        for (const Op* op = ops.begin() + start, * const last = ops.begin() + end; op < last; ++op)
+        {
+            switch (op->code)
+            {
+                case Op::clearChannels:
+                    for (int c = op->dst; c < op->dst + op->aux; ++c)
+                    {
+                        if (! silent[c])
+                            audio.clear (c, 0, numSamples);
+                        silent[c] = true;
+                    }
+                    break;
+
+                case Op::copyChannel:
+                    if (! (silent[op->src] && silent[op->dst]))
+                        audio.copyFrom (op->dst, 0, audio, op->src, 0, numSamples);
+                    silent[op->dst] = silent[op->src];
+                    break;
+
+                case Op::addChannel:
+                    if (! silent[op->src])
+                    {
+                        audio.addFrom (op->dst, 0, audio, op->src, 0, numSamples);
+                        silent[op->dst] = false;
+                    }
+                    break;
+
+                case Op::sumChannels:
+                    if (! (silent[op->src] && silent[op->aux] && silent[op->dst]))
+                        FloatVectorOperations::add (audio.getWritePointer (op->dst),
+                                                    audio.getReadPointer (op->src),
+                                                    audio.getReadPointer (op->aux),
+                                                    numSamples);
+                    silent[op->dst] = silent[op->src] && silent[op->aux];
+                    break;
+
+                case Op::clearMidi:
+                    midi.getUnchecked (op->dst)->clear();
+                    break;
+
+                case Op::copyMidi:
+                    FixedMidiBuffer::copy (*midi.getUnchecked (op->dst), *midi.getUnchecked (op->src));
+                    break;
+
+                case Op::mergeMidi:
+                    midiMergeOps.getUnchecked (op->src)->perform (audio, midi, silent, numSamples);
+                    break;
+
+                case Op::delayChannel:
+                    delayOps.getUnchecked (op->src)->perform (audio, midi, silent, numSamples);
+                    break;
+
+                case Op::delayMidi:
+                    midiDelayOps.getUnchecked (op->src)->perform (audio, midi, silent, numSamples);
+                    break;
+
+                case Op::processBuffer:
+                    processOps.getUnchecked (op->src)->perform (audio, midi, silent, numSamples);
+                    break;
+
+                default:
+                    jassertfalse;
+                    break;
+            }
+        }
+    }
+
+    /** Adds the buffers and graph IO an op touches */
+    void getResources (const int index, Array<Resource>& resources) const
+    {
+        const Op& op = ops.getReference (index);
+        switch (op.code)
+        {
+            case Op::clearChannels:
+                for (int c = op.dst; c < op.dst + op.aux; ++c)
+                    resources.add ({ Resource::AudioBuffer, c, true, true });
+                break;
+
+            case Op::sumChannels:
+                resources.add ({ Resource::AudioBuffer, op.aux, false });
+                resources.add ({ Resource::AudioBuffer, op.src, false });
+                resources.add ({ Resource::AudioBuffer, op.dst, true, op.dst != op.src && op.dst != op.aux });
+                break;
+
+            case Op::copyChannel:
+                resources.add ({ Resource::AudioBuffer, op.src, false });
+                resources.add ({ Resource::AudioBuffer, op.dst, true, op.dst != op.src });
+                break;
+
+            case Op::addChannel:
+                resources.add ({ Resource::AudioBuffer, op.src, false });
+                resources.add ({ Resource::AudioBuffer, op.dst, true });
+                break;
+
+            case Op::clearMidi:
+                resources.add ({ Resource::MidiBuffer, op.dst, true, true });
+                break;
+
+            case Op::copyMidi:
+                resources.add ({ Resource::MidiBuffer, op.src, false });
+                resources.add ({ Resource::MidiBuffer, op.dst, true, op.dst != op.src });
+                break;
+
+            case Op::mergeMidi:
+                midiMergeOps.getUnchecked(op.src)->getResources (resources);
+                break;
+
+            case Op::delayChannel:
+                delayOps.getUnchecked(op.src)->getResources (resources);
+                break;
+
+            case Op::delayMidi:
+                midiDelayOps.getUnchecked(op.src)->getResources (resources);
+                break;
+
+            case Op::processBuffer:
+                processOps.getUnchecked(op.src)->getResources (resources);
+                break;
+        }
+    }
+
+private:
+    Array<Op> ops;
+    OwnedArray<DelayChannelOp> delayOps;
+    OwnedArray<DelayMidiOp> midiDelayOps;
+    OwnedArray<MergeMidiOp> midiMergeOps;
+    OwnedArray<ProcessBufferOp> processOps;
+    Array<Range<int>> steps;
+    int stepStart = 0;
+    int numBuffers [2] = { 1, 1 };
+    int numBuffersBuilt [2] = { 1, 1 };
+
+    /** A buffer's contents from the op that puts them there to the last op
+        that uses them */
+    struct Value
+    {
+        int start, end;
+    };
+
+    /** Renames the buffers of every op so values whose lifetimes don't overlap
+        share storage.
+
+        While building, the indices a node's outputs get are only freed once
+        the node is done. Here each index is split into values, one for every
+        op which replaces its contents, and each value lives until its last
+        use. The values form an interval graph, and colouring them in order of
+        their start uses exactly as many buffers as are ever alive at once.
+        The buffer released most recently is reused first since its data is
+        the most likely to still be in cache. Buffer zero, the read-only
+        empty buffer, keeps its index.
+     */
+    void assignBuffers()
+    {
+        struct Use
+        {
+            int op, kind, index, value;
+        };
+
+        Array<Value> values [2];
+        Array<Use> uses;
+        Array<int> current [2];
+        for (int kind = 0; kind < 2; ++kind)
+            current[kind].insertMultiple (0, -1, numBuffersBuilt [kind]);
+
+        Array<Resource> resources;
+        for (int i = 0; i < ops.size(); ++i)
+        {
+            resources.clearQuick();
+            getResources (i, resources);
+
+            // reads first, so an op can't see a value it starts itself
+            for (const bool overwriting : { false, true })
+            {
+                for (const auto& resource : resources)
+                {
+                    if (resource.overwrites != overwriting || resource.index == 0
+                         || (resource.kind != Resource::AudioBuffer && resource.kind != Resource::MidiBuffer))
+                        continue;
+
+                    int& value = current[resource.kind].getReference (resource.index);
+                    if (overwriting || value < 0)
+                    {
+                        value = values[resource.kind].size();
+                        values[resource.kind].add ({ i, i });
+                    }
+
+                    values[resource.kind].getReference(value).end = i;
+                    uses.add ({ i, resource.kind, resource.index, value });
+                }
+            }
+        }
+
+        // colour each kind's values in the order they start
+        Array<int> colours [2];
+        for (int kind = 0; kind < 2; ++kind)
+        {
+            Array<int> live, released;
+            numBuffers [kind] = 1;
+
+            for (int v = 0; v < values[kind].size(); ++v)
+            {
+                const auto& value = values[kind].getReference (v);
+
+                for (;;)
+                {
+                    // release everything which ended before this starts, last to end on top
+                    int finished = -1;
+                    for (const auto l : live)
+                        if (values[kind].getReference(l).end < value.start
+                             && (finished < 0 || values[kind].getReference(l).end < values[kind].getReference(finished).end))
+                            finished = l;
+                    if (finished < 0)
+                        break;
+                    live.removeFirstMatchingValue (finished);
+                    released.add (colours[kind].getUnchecked (finished));
+                }
+
+                colours[kind].add (released.size() > 0 ? released.removeAndReturn (released.size() - 1)
+                                                       : numBuffers [kind]++);
+                live.add (v);
+            }
+        }
+
+        // rewrite the ops with the assigned buffers
+        BufferMap map;
+        map.audio.insertMultiple (0, 0, numBuffersBuilt [Resource::AudioBuffer]);
+        map.midi.insertMultiple (0, 0, numBuffersBuilt [Resource::MidiBuffer]);
+
+        for (int u = 0; u < uses.size();)
+        {
+            const int opIndex = uses.getReference(u).op;
+            for (; u < uses.size() && uses.getReference(u).op == opIndex; ++u)
+            {
+                const auto& use = uses.getReference (u);
+                auto& renames = use.kind == Resource::AudioBuffer ? map.audio : map.midi;
+                renames.set (use.index, colours[use.kind].getUnchecked (use.value));
+            }
+
+            remapBuffers (ops.getReference (opIndex), map);
+        }
+    }
+
+    void remapBuffers (Op& op, const BufferMap& map)
+    {
+        switch (op.code)
+        {
+            case Op::clearChannels:
+                jassert (op.aux == 1); // ranges are only made by optimise()
+                op.dst = map (Resource::AudioBuffer, op.dst);
+                break;
+
+            case Op::copyChannel:
+            case Op::addChannel:
+                op.src = map (Resource::AudioBuffer, op.src);
+                op.dst = map (Resource::AudioBuffer, op.dst);
+                break;
+
+            case Op::clearMidi:
+                op.dst = map (Resource::MidiBuffer, op.dst);
+                break;
+
+            case Op::copyMidi:
+                op.src = map (Resource::MidiBuffer, op.src);
+                op.dst = map (Resource::MidiBuffer, op.dst);
+                break;
+
+            case Op::mergeMidi:
+                midiMergeOps.getUnchecked(op.src)->remapBuffers (map);
+                op.dst = map (Resource::MidiBuffer, op.dst);
+                break;
+
+            case Op::delayChannel:
+                delayOps.getUnchecked(op.src)->remapBuffers (map);
+                op.dst = map (Resource::AudioBuffer, op.dst);
+                break;
+
+            case Op::delayMidi:
+                midiDelayOps.getUnchecked(op.src)->remapBuffers (map);
+                op.dst = map (Resource::MidiBuffer, op.dst);
+                break;
+
+            case Op::processBuffer:
+                processOps.getUnchecked(op.src)->remapBuffers (map);
+                break;
+
+            default:
+                jassertfalse; // sums are only made by optimise()
+                break;
+        }
+    }
+
+    /** Merges runs of clear/copy/add ops within each step. Each rewrite
+        produces exactly the same samples as the ops it replaces */
+    void optimise()
+    {
+        Array<Range<int>> optimised;
+        int out = 0;
+
+        for (const auto step : steps)
+        {
+            const int first = out;
+
+            for (int i = step.getStart(); i < step.getEnd(); ++i)
+            {
+                const Op op = ops.getUnchecked (i);
+
+                if (out > first)
+                {
+                    Op& last = ops.getReference (out - 1);
+
+                    // clear + copy/add into the same channel: copy
+                    if (last.code == Op::clearChannels && last.aux == 1 && last.dst == op.dst
+                         && (op.code == Op::copyChannel || op.code == Op::addChannel)
+                         && op.src != op.dst)
+                    {
+                        last = { Op::copyChannel, op.src, op.dst, 0 };
+                        continue;
+                    }
+
+                    // copy + add into the same channel: sum
+                    if (last.code == Op::copyChannel && op.code == Op::addChannel
+                         && last.dst == op.dst && op.src != op.dst && last.src != last.dst)
+                    {
+                        last = { Op::sumChannels, last.src, last.dst, op.src };
+                        continue;
+                    }
+
+                    // clears of adjacent channels: one ranged clear
+                    if (last.code == Op::clearChannels && op.code == Op::clearChannels
+                         && last.dst + last.aux == op.dst)
+                    {
+                        last.aux += op.aux;
+                        continue;
+                    }
+
+                    // clear + copy into the same MIDI buffer: copy
+                    if (last.code == Op::clearMidi && op.code == Op::copyMidi
+                         && last.dst == op.dst && op.src != op.dst)
+                    {
+                        last = op;
+                        continue;
+                    }
+                }
+
+                ops.setUnchecked (out++, op);
+            }
+
+            if (out > first)
+                optimised.add (Range<int> (first, out));
+        }
+
+        ops.removeRange (out, ops.size() - out);
+        steps.swapWith (optimised);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (RenderProgram)
+};
+
+/** The rendering ops grouped in steps, one step per node, with the dependencies
+    between steps worked out from the buffers each op reads and writes. Steps
+    which don't depend on each other are performed at the same time when
+    rendering on multiple cores. */
+class TaskGraph : public RenderPool::Job
+{
+public:
+    TaskGraph (const RenderProgram& program_, const int numAudioBuffers_, const int numMidiBuffers_)
+        : program (program_),
+          numAudioBuffers (numAudioBuffers_),
+          numMidiBuffers (numMidiBuffers_)
+    {
+        const auto& stepRanges = program.getSteps();
+        const int numResources = numAudioBuffers + numMidiBuffers + 4;
+        Array<int> lastWriter;
+        Array<Array<int>> readers;
+        for (int i = 0; i < numResources; ++i)
+        {
+            lastWriter.add (-1);
+            readers.add (Array<int>());
+        }
+
+        for (int stepIndex = 0; stepIndex < stepRanges.size(); ++stepIndex)
+        {
+            const auto range = stepRanges.getUnchecked (stepIndex);
+            Array<Resource> resources;
+            for (int i = range.getStart(); i < range.getEnd(); ++i)
+                program.getResources (i, resources);
+
+            SortedSet<int> dependencies;
+            for (const auto& resource : resources)
+            {
+                const int key = getResourceIndex (resource);
+                const int writer = lastWriter [key];
+                if (writer >= 0 && writer != stepIndex)
+                    dependencies.add (writer);
+
+                if (resource.writes)
+                    for (const auto reader : readers.getReference (key))
+                        if (reader != stepIndex)
+                            dependencies.add (reader);
+            }
+
+            for (const auto& resource : resources)
+            {
+                if (! resource.writes)
+                    continue;
+                const int key = getResourceIndex (resource);
+                lastWriter.set (key, stepIndex);
+                readers.getReference(key).clearQuick();
+            }
+
+            for (const auto& resource : resources)
+            {
+                const int key = getResourceIndex (resource);
+                if (! resource.writes && lastWriter [key] != stepIndex)
+                    readers.getReference(key).addIfNotAlreadyThere (stepIndex);
+            }
+
+            Step step;
+            step.firstOp = range.getStart();
+            step.numOps  = range.getLength();
+            step.numDependencies = dependencies.size();
+            steps.add (step);
+
+            for (const auto dependency : dependencies)
+                steps.getReference(dependency).successors.add (stepIndex);
+        }
+
+        pending.reset (new Atomic<int> [(size_t) jmax (1, steps.size())]);
+        queue.reset (new Atomic<int> [(size_t) jmax (1, steps.size())]);
+    }
+
+    int getNumSteps() const { return steps.size(); }
+
+    /** Resets the job for a new block. Call this before RenderPool::run */
+    void prepare (AudioSampleBuffer& sharedBufferChans,
+                  const OwnedArray<MidiBuffer>& sharedMidiBuffers,
+                  bool* const silentBuffers,
+                  const int numSamples)
+    {
+        // a worker from the last block can still try to pop, so the queue is
+        // closed while it's refilled and reopened under a new generation
+        const int64 generation = (readState.get() >> 32) + 1;
+        readState = (generation << 32) | closedIndex;
+
+        audio       = &sharedBufferChans;
+        midi        = &sharedMidiBuffers;
+        silent      = silentBuffers;
+        blockSize   = numSamples;
+        writeIndex  = 0;
+        remaining   = steps.size();
+
+        for (int i = 0; i < steps.size(); ++i)
+        {
+            queue[i] = -1;
+            pending[i] = steps.getReference(i).numDependencies;
+        }
+
+        for (int i = 0; i < steps.size(); ++i)
+            if (steps.getReference(i).numDependencies == 0)
+                push (i);
+
+        readState = (generation + 1) << 32;
+    }
+
+    bool performNextTask() override
+    {
+        const int stepIndex = pop();
+        if (stepIndex < 0)
+            return false;
+
+        const auto& step = steps.getReference (stepIndex);
+        program.perform (step.firstOp, step.firstOp + step.numOps, *audio, *midi, silent, blockSize);
+
+        for (const auto next : step.successors)
+            if (--pending[next] == 0)
+                push (next);
+
+        --remaining;
+        return true;
+    }
+
+    bool isFinished() const override { return remaining.get() <= 0; }
+
+private:
+    struct Step
+    {
+        int firstOp = 0;
+        int numOps  = 0;
+        int numDependencies = 0;
+        Array<int> successors;
+    };
+
+    const RenderProgram& program;
+    Array<Step> steps;
+    const int numAudioBuffers, numMidiBuffers;
+
+    std::unique_ptr<Atomic<int>[]> pending;
+    std::unique_ptr<Atomic<int>[]> queue;
+    Atomic<int> writeIndex, remaining;
+
+    // generation in the high 32 bits, next index to pop in the low
+    Atomic<int64> readState { closedIndex };
+    static const int64 closedIndex = 0x7fffffff;
+
+    AudioSampleBuffer* audio = nullptr;
+    const OwnedArray<MidiBuffer>* midi = nullptr;
+    bool* silent = nullptr;
+    int blockSize = 0;
+
+    int getResourceIndex (const Resource& resource) const noexcept
+    {
+        switch (resource.kind)
+        {
+            case Resource::AudioBuffer: return resource.index;
+            case Resource::MidiBuffer:  return numAudioBuffers + resource.index;
+            default: break;
+        }
+
+        return numAudioBuffers + numMidiBuffers + (resource.kind - Resource::GraphAudioInput);
+    }
+
+    /** Each step is pushed exactly once per block, so the queue never wraps */
+    void push (const int stepIndex) noexcept
+    {
+        const int index = ++writeIndex - 1;
+        queue[index] = stepIndex;
+    }
+
+    int pop() noexcept
+    {
+        for (;;)
+        {
+            const int64 current = readState.get();
+            const int index = (int) (current & 0xffffffff);
+            if (index >= writeIndex.get())
+                return -1;
+
+            const int stepIndex = queue[index].get();
+            if (stepIndex < 0)
+                return -1; // claimed but not published yet
+
+            // fails if the queue was refilled for another block meanwhile
+            if (readState.compareAndSetBool (current + 1, current))
+                return stepIndex;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (TaskGraph)
+};
+
+/** Orders nodes so that each one comes after every node feeding it, using
+    Kahn's algorithm. Nodes in, or fed by, a feedback loop are placed in the
+    order they were added once nothing else is ready. The result holds
+    indexes into nodeIds */
+static void sortNodesForRendering (const Array<uint32>& nodeIds,
+                                   const Array<GraphSnapshot::Connection>& connections,
+                                   Array<int>& order)
+{
+    const int numNodes = nodeIds.size();
+    HashMap<int, int> indexes;
+    for (int i = 0; i < numNodes; ++i)
+        indexes.set ((int) nodeIds.getUnchecked (i), i);
+
+    auto isEdge = [&indexes] (const GraphSnapshot::Connection& c) -> bool {
+        return c.sourceNode != c.destNode
+            && indexes.contains ((int) c.sourceNode)
+            && indexes.contains ((int) c.destNode);
+    };
+
+    // edges grouped by source node
+    Array<int> edgeStart, edgeTargets, inDegree;
+    edgeStart.insertMultiple (0, 0, numNodes + 1);
+    inDegree.insertMultiple (0, 0, numNodes);
+    for (const auto& c : connections)
+        if (isEdge (c))
+            edgeStart.getReference (indexes [(int) c.sourceNode] + 1)++;
+
+    for (int i = 0; i < numNodes; ++i)
+        edgeStart.getReference (i + 1) += edgeStart.getUnchecked (i);
+
+    Array<int> fill (edgeStart);
+    edgeTargets.insertMultiple (0, 0, edgeStart.getLast());
+    for (const auto& c : connections)
+    {
+        if (! isEdge (c))
+            continue;
+        const int dest = indexes [(int) c.destNode];
+        edgeTargets.set (fill.getReference (indexes [(int) c.sourceNode])++, dest);
+        inDegree.getReference (dest)++;
+    }
+
+    Array<bool> queued;
+    queued.insertMultiple (0, false, numNodes);
+    order.clearQuick();
+    order.ensureStorageAllocated (numNodes);
+    for (int i = 0; i < numNodes; ++i)
+    {
+        if (inDegree.getUnchecked (i) == 0)
+        {
+            order.add (i);
+            queued.set (i, true);
+        }
+    }
+
+    // 'order' doubles as the queue of ready nodes
+    int head = 0, nextForced = 0;
+    while (head < numNodes)
+    {
+        if (head == order.size())
+        {
+            while (queued.getUnchecked (nextForced))
+                ++nextForced;
+            order.add (nextForced);
+            queued.set (nextForced, true);
+        }
+
+        const int index = order.getUnchecked (head++);
+        for (int e = edgeStart.getUnchecked (index); e < edgeStart.getUnchecked (index + 1); ++e)
+        {
+            const int target = edgeTargets.getUnchecked (e);
+            if (--inDegree.getReference (target) <= 0 && ! queued.getUnchecked (target))
+            {
+                order.add (target);
+                queued.set (target, true);
+            }
+        }
+    }
+}
+
+/** Cuts a snapshot into numStages pipeline stages of about equal render cost,
+    following the rendering order, so that even a serial chain of nodes can
+    use several cores. Each connection between stages goes through an
+    AheadBuffer primed with a block of silence for every stage boundary it
+    crosses, so a stage only reads what earlier stages rendered in previous
+    blocks and all stages can render at the same time. Taps report the added
+    latency. Unprofiled nodes count as the average cost of the profiled ones.
+    The first stage stays in the snapshot, the rest go to snapshot.stages */
+static void splitIntoStages (GraphSnapshot& snapshot, const int numStages, const int blockSize)
+{
+    if (numStages <= 1 || snapshot.nodes.size() < 2)
+        return;
+
+    Array<uint32> nodeIds;
+    for (const auto* const info : snapshot.nodes)
+        nodeIds.add (info->nodeId);
+
+    Array<int> order;
+    sortNodesForRendering (nodeIds, snapshot.connections, order);
+
+    double profiledCost = 0.0;
+    int numProfiled = 0;
+    for (const auto* const info : snapshot.nodes)
+    {
+        if (info->getRenderCost() >= 0.0)
         {
-            // just became unmuted
-            buffer.applyGainRamp (0, numSamples, 0.0, node->getGain());
+            profiledCost += info->getRenderCost();
+            ++numProfiled;
         }
-        else if (node->getGain() != node->getLastGain())
+    }
+
+    const double defaultCost = numProfiled > 0 ? jmax (1.0e-3, profiledCost / (double) numProfiled) : 1.0;
+    auto getCost = [defaultCost] (const NodeInfo& info) -> double {
+        return info.getRenderCost() >= 0.0 ? info.getRenderCost() : defaultCost;
+    };
+
+    double totalCost = 0.0;
+    for (const auto* const info : snapshot.nodes)
+        totalCost += getCost (*info);
+
+    HashMap<uint32, int> stageForNode;
+    double cost = 0.0;
+    for (const int index : order)
+    {
+        const auto* const info = snapshot.nodes.getUnchecked (index);
+        const double nodeCost = getCost (*info);
+        int stage = totalCost > 0.0 ? (int) ((cost + 0.5 * nodeCost) * numStages / totalCost) : 0;
+        cost += nodeCost;
+
+        // the graph's inputs start the pipeline and its outputs end it
+        switch (info->getIOType())
         {
-            buffer.applyGainRamp (0, numSamples, node->getLastGain(), node->getGain());
+            case GraphProcessor::AudioGraphIOProcessor::audioInputNode:
+            case GraphProcessor::AudioGraphIOProcessor::midiInputNode:
+                stage = 0;
+                break;
+            case GraphProcessor::AudioGraphIOProcessor::audioOutputNode:
+            case GraphProcessor::AudioGraphIOProcessor::midiOutputNode:
+                stage = numStages - 1;
+                break;
+            default:
+                break;
         }
-        else 
+
+        stageForNode.set (info->nodeId, jlimit (0, numStages - 1, stage));
+    }
+
+    // connections must never lead to an earlier stage. This also puts every
+    // node of a feedback loop in the same stage
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (const auto& c : snapshot.connections)
         {
-            buffer.applyGain (0, numSamples, node->getGain());
+            if (stageForNode.contains (c.sourceNode) && stageForNode.contains (c.destNode)
+                 && stageForNode [c.destNode] < stageForNode [c.sourceNode])
+            {
+                stageForNode.set (c.destNode, stageForNode [c.sourceNode]);
+                changed = true;
+            }
         }
+    }
 
-        node->updateGain();
-        lastMute = muted;
-
-        for (int i = 0; i < numAudioOuts; ++i)
-            node->setOutputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+    // empty stages would only add latency
+    SortedSet<int> usedStages;
+    for (const auto* const info : snapshot.nodes)
+        usedStages.add (stageForNode [info->nodeId]);
+    if (usedStages.size() <= 1)
+        return;
+    for (const auto* const info : snapshot.nodes)
+        stageForNode.set (info->nodeId, usedStages.indexOf (stageForNode [info->nodeId]));
+
+    auto connectionDelay = [&stageForNode, blockSize] (const GraphSnapshot::Connection& c) -> int {
+        return (stageForNode [c.destNode] - stageForNode [c.sourceNode]) * blockSize;
+    };
+
+    HashMap<uint32, int> outputLatency;
+    for (const auto* const info : snapshot.nodes)
+        getOutputLatency (snapshot, *info, outputLatency, connectionDelay);
+
+    Array<GraphSnapshot*> stages;
+    stages.add (&snapshot);
+    for (int i = 1; i < usedStages.size(); ++i)
+    {
+        auto* const stage = snapshot.stages.add (new GraphSnapshot());
+        stage->context = snapshot.context;
+        stages.add (stage);
     }
 
-    const GraphNodePtr node;
-    AudioProcessor* const processor;
+    OwnedArray<NodeInfo> nodes;
+    Array<GraphSnapshot::Connection> connections;
+    nodes.swapWith (snapshot.nodes);
+    connections.swapWith (snapshot.connections);
 
-private:
-    Array <int> audioChannelsToUse;
-    Array <int> midiChannelsToUse;
-    HeapBlock <float*> channels;
-    int totalChans, numAudioIns, numAudioOuts;
-    int midiBufferToUse;
-    bool lastMute = false;
-    MidiTranspose transpose;
-    MidiBuffer tempMidi;
-    JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
-};
+    uint32 nextSinkId = 0x90000000u;
+    for (auto* const info : nodes)
+    {
+        const int stage = stageForNode [info->nodeId];
+
+        SortedSet<int> laterStages;
+        for (const auto& c : connections)
+            if (c.sourceNode == info->nodeId && stageForNode.contains (c.destNode)
+                 && stageForNode [c.destNode] > stage)
+                laterStages.add (stageForNode [c.destNode]);
 
+        for (int i = 0; i < laterStages.size(); ++i)
+        {
+            const int later = laterStages.getUnchecked (i);
+            const int delay = (later - stage) * blockSize;
+            AheadBuffer::Ptr buffer = new AheadBuffer (info->getNumPorts (PortType::Audio, false),
+                                                       info->getNumPorts (PortType::Midi, false),
+                                                       delay + blockSize);
+            // the buffer starts out silent, so this delays everything written after it
+            buffer->finishWrite (delay);
+
+            const uint32 sinkId = nextSinkId++;
+            GraphNodePtr sink = new AheadSinkNode (sinkId, buffer.get());
+            GraphNodePtr tap  = new AheadTapNode (*info, buffer.get(), outputLatency [info->nodeId] + delay);
+            connectToSink (*info, sinkId, *buffer, stages.getUnchecked (stage)->connections);
+            stages.getUnchecked (stage)->nodes.add (new NodeInfo (sink.get()));
+            stages.getUnchecked (later)->nodes.add (new NodeInfo (tap.get()));
+        }
+
+        stages.getUnchecked (stage)->nodes.add (info);
+    }
+    nodes.clear (false);
+
+    // a connection from an earlier stage reads the tap, which has the source's ID
+    for (const auto& c : connections)
+        stages.getUnchecked (stageForNode [c.destNode])->connections.add (c);
+}
 
 /** Used to calculate the correct sequence of rendering ops needed, based on
     the best re-use of shared buffers at each stage. */
 class ProcessorGraphBuilder
 {
 public:
-    ProcessorGraphBuilder (GraphProcessor& graph_, 
-                           const Array<void*>& orderedNodes_,
-                           Array<void*>& renderingOps)
+    ProcessorGraphBuilder (const GraphSnapshot& graph_,
+                           const Array<int>& order,
+                           RenderProgram& program)
         : graph (graph_),
-          orderedNodes (orderedNodes_),
           totalLatency (0)
     {
+        for (const auto index : order)
+            orderedNodes.add (graph.nodes.getUnchecked (index));
+
         for (int i = 0; i < PortType::Unknown; ++i)
         {
             allNodes[i].add ((uint32) zeroNodeID);  // first buffer is read-only zeros
             allPorts[i].add (KV_INVALID_PORT);
         }
 
+        buildIndexes();
+
         for (int i = 0; i < orderedNodes.size(); ++i)
         {
-            createRenderingOpsForNode ((GraphNode*) orderedNodes.getUnchecked (i),
-                                       renderingOps, i);
+            program.beginStep();
+            createRenderingOpsForNode (orderedNodes.getUnchecked (i), program, i);
+            program.endStep();
             markUnusedBuffersFree (i);
         }
-
-        graph.setLatencySamples (totalLatency);
     }
 
     int32 buffersNeeded (PortType type)     { return allNodes[type.id()].size(); }
+    int getLatencySamples() const noexcept  { return totalLatency; }
 
 private:
     //==============================================================================
-    GraphProcessor& graph;
-    const Array<void*>& orderedNodes;
+    const GraphSnapshot& graph;
+    Array<const NodeInfo*> orderedNodes;
     Array <uint32> allNodes [PortType::Unknown];
     Array <uint32> allPorts [PortType::Unknown];
 
@@ -434,60 +2038,95 @@ private:
 
     static bool isNodeBusy (uint32 nodeID) noexcept { return nodeID != freeNodeID && nodeID != zeroNodeID; }
 
-    Array <uint32> nodeDelayIDs;
-    Array <int> nodeDelays;
+    HashMap<int, int> nodeDelays;
     int totalLatency;
 
-    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
+    /** Where a node output is read for the last time in the rendering sequence */
+    struct LastUse
+    {
+        int step = -1;
+        uint32 port = KV_INVALID_PORT;  // the input port read at 'step'
+        bool manyPorts = false;         // true if more than one port is read at 'step'
+    };
+
+    HashMap<int, int> stepForNode;
+    HashMap<int64, LastUse> lastUses;
+    HashMap<int64, int> bufferForOutput [PortType::Unknown];
+    Array<Array<const GraphSnapshot::Connection*>> inputsForStep;
 
-    void setNodeDelay (const uint32 nodeID, const int latency)
+    static int64 outputKey (const uint32 nodeId, const uint32 port) noexcept
     {
-        const int index = nodeDelayIDs.indexOf (nodeID);
+        return (int64) (((uint64) nodeId << 32) | (uint64) port);
+    }
 
-        if (index >= 0)
+    /** Indexes each node's input connections and the last use of every output,
+        so lookups while compiling don't need to walk the whole graph */
+    void buildIndexes()
+    {
+        for (int i = 0; i < orderedNodes.size(); ++i)
         {
-            nodeDelays.set (index, latency);
+            stepForNode.set ((int) orderedNodes.getUnchecked(i)->nodeId, i);
+            inputsForStep.add (Array<const GraphSnapshot::Connection*>());
         }
-        else
+
+        // reverse order, so sources are mixed in the same order as before
+        for (int i = graph.connections.size(); --i >= 0;)
         {
-            nodeDelayIDs.add (nodeID);
-            nodeDelays.add (latency);
+            const auto* const c = &graph.connections.getReference (i);
+            if (! stepForNode.contains ((int) c->destNode))
+                continue;
+
+            const int step = stepForNode [(int) c->destNode];
+            inputsForStep.getReference(step).add (c);
+
+            if (c->destPort >= orderedNodes.getUnchecked(step)->getNumPorts())
+                continue;
+
+            const auto key = outputKey (c->sourceNode, c->sourcePort);
+            LastUse use = lastUses [key];
+            if (step > use.step)
+            {
+                use.step = step;
+                use.port = c->destPort;
+                use.manyPorts = false;
+            }
+            else if (step == use.step && use.port != c->destPort)
+            {
+                use.manyPorts = true;
+            }
+
+            lastUses.set (key, use);
         }
     }
 
-    int getInputLatency (const uint32 nodeID) const
+    int getNodeDelay (const uint32 nodeID) const                { return nodeDelays [(int) nodeID]; }
+    void setNodeDelay (const uint32 nodeID, const int latency)  { nodeDelays.set ((int) nodeID, latency); }
+
+    int getInputLatency (const int step) const
     {
         int maxLatency = 0;
-
-        for (int i = graph.getNumConnections(); --i >= 0;)
-        {
-            const auto* const c = graph.getConnection (i);
-            if (c->destNode == nodeID)
-                maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNode));
-        }
-
+        for (const auto* const c : inputsForStep.getReference (step))
+            maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNode));
         return maxLatency;
     }
 
-    void createRenderingOpsForNode (GraphNode* const node, Array<void*>& renderingOps,
+    void createRenderingOpsForNode (const NodeInfo* const node, RenderProgram& program,
                                     const int ourRenderingIndex)
     {
-        AudioProcessor* const proc (node->getAudioProcessor());
-
         // don't add IONodes that cannot process
         typedef GraphProcessor::AudioGraphIOProcessor IOProc;
-        if (IOProc* ioproc = dynamic_cast<IOProc*> (proc))
+        if (node->getIOType() >= 0)
         {
             const uint32 numOuts = node->getNumPorts (PortType::Audio, false);
-            if (IOProc::audioInputNode == ioproc->getType() && numOuts <= 0)
+            if (IOProc::audioInputNode == node->getIOType() && numOuts <= 0)
                 return;
             const uint32 numIns = node->getNumPorts (PortType::Audio, true);
-            if (IOProc::audioOutputNode == ioproc->getType() && numIns <= 0)
+            if (IOProc::audioOutputNode == node->getIOType() && numIns <= 0)
                 return;
         }
         
         Array <int> channelsToUse [PortType::Unknown];
-        int maxLatency = getInputLatency (node->nodeId);
+        int maxLatency = getInputLatency (ourRenderingIndex);
 
         const uint32 numPorts (node->getNumPorts());
         for (uint32 port = 0; port < numPorts; ++port)
@@ -526,11 +2165,9 @@ private:
             // get a list of all the inputs to this node
             Array <uint32> sourceNodes;
             Array <uint32> sourcePorts;
-            for (int i = graph.getNumConnections(); --i >= 0;)
+            for (const auto* const c : inputsForStep.getReference (ourRenderingIndex))
             {
-                const GraphProcessor::Connection* const c = graph.getConnection (i);
-
-                if (c->destNode == node->nodeId && c->destPort == port)
+                if (c->destPort == port)
                 {
                     sourceNodes.add (c->sourceNode);
                     sourcePorts.add (c->sourcePort);
@@ -552,10 +2189,10 @@ private:
                     switch (portType.id())
                     {
                         case PortType::Audio:
-                            renderingOps.add (new ClearChannelOp (bufIndex));
+                            program.clearChannel (bufIndex);
                             break;
                         case PortType::Midi:
-                            renderingOps.add (new ClearMidiBufferOp (bufIndex));
+                            program.clearMidi (bufIndex);
                             break;
                         default:
                             break;
@@ -578,7 +2215,8 @@ private:
                 }
                 
                 const bool bufNeededLater = isBufferNeededLater (ourRenderingIndex, port, srcNode, srcPort);
-                if (bufNeededLater && (inputChan < (int) numOuts || portType == PortType::Midi))
+                const bool needsDelay = getNodeDelay (srcNode) < maxLatency;
+                if (bufNeededLater && (inputChan < (int) numOuts || portType == PortType::Midi || needsDelay))
                 {
                     // can't mess up this channel because it's needed later by another node, so we
                     // need to use a copy of it..
@@ -587,10 +2225,10 @@ private:
                     switch (portType.id())
                     {
                         case PortType::Audio:
-                            renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
+                            program.copyChannel (bufIndex, newFreeBuffer);
                             break;
                         case PortType::Midi:
-                            renderingOps.add (new CopyMidiBufferOp (bufIndex, newFreeBuffer));
+                            program.copyMidi (bufIndex, newFreeBuffer);
                             break;
                         default:
                             break;
@@ -599,10 +2237,7 @@ private:
                     bufIndex = newFreeBuffer;
                 }
 
-                const int nodeDelay = getNodeDelay (srcNode);
-
-                if (nodeDelay < maxLatency)
-                    renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                delayBuffer (program, portType, bufIndex, srcNode, maxLatency);
             }
             else
             {
@@ -624,14 +2259,7 @@ private:
                         // we've found one of our input chans that can be re-used..
                         reusableInputIndex = i;
                         bufIndex = sourceBufIndex;
-
-                        if (portType == PortType::Audio)
-                        {
-                            const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (i));
-                            if (nodeDelay < maxLatency)
-                                renderingOps.add (new DelayChannelOp (sourceBufIndex, maxLatency - nodeDelay));
-                        }
-
+                        delayBuffer (program, portType, bufIndex, sourceNodes.getUnchecked (i), maxLatency);
                         break;
                     }
                 }
@@ -650,28 +2278,25 @@ private:
                     {
                         // if not found, this is probably a feedback loop
                         if (portType == PortType::Audio)
-                            renderingOps.add (new ClearChannelOp (bufIndex));
+                            program.clearChannel (bufIndex);
                         else if (portType == PortType::Midi)
-                            renderingOps.add (new ClearMidiBufferOp (bufIndex));
+                            program.clearMidi (bufIndex);
                     }
                     else
                     {
                         if (portType == PortType::Audio)
-                            renderingOps.add (new CopyChannelOp (srcIndex, bufIndex));
+                            program.copyChannel (srcIndex, bufIndex);
                         else if (portType == PortType::Midi)
-                            renderingOps.add (new CopyMidiBufferOp (srcIndex, bufIndex));
+                            program.copyMidi (srcIndex, bufIndex);
                     }
 
                     reusableInputIndex = 0;
-
-                    if (portType == PortType::Audio)
-                    {
-                        const int nodeDelay = getNodeDelay (sourceNodes.getFirst());
-                        if (nodeDelay < maxLatency)
-                            renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
-                    }
+                    delayBuffer (program, portType, bufIndex, sourceNodes.getFirst(), maxLatency);
                 }
 
+                // MIDI from all the other inputs is merged in one go at the end
+                Array<int> midiSources;
+
                 for (int j = 0; j < sourceNodes.size(); ++j)
                 {
                     if (j != reusableInputIndex)
@@ -680,36 +2305,39 @@ private:
                                                                       sourcePorts.getUnchecked(j));
                         if (srcIndex >= 0)
                         {
-                            if (portType == PortType::Audio)
+                            if (getNodeDelay (sourceNodes.getUnchecked (j)) < maxLatency
+                                 && isBufferNeededLater (ourRenderingIndex, port,
+                                                         sourceNodes.getUnchecked(j),
+                                                         sourcePorts.getUnchecked(j)))
                             {
-                                const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (j));
-
-                                if (nodeDelay < maxLatency)
+                                // buffer is reused elsewhere, delay a copy of it
+                                const int bufferToDelay = getFreeBuffer (portType);
+                                if (portType == PortType::Audio)
                                 {
-                                    if (! isBufferNeededLater (ourRenderingIndex, port,
-                                                               sourceNodes.getUnchecked(j),
-                                                               sourcePorts.getUnchecked(j)))
-                                    {
-                                        renderingOps.add (new DelayChannelOp (srcIndex, maxLatency - nodeDelay));
-                                    }
-                                    else // buffer is reused elsewhere, can't be delayed
-                                    {
-                                        const int bufferToDelay = getFreeBuffer (PortType::Audio);
-                                        renderingOps.add (new CopyChannelOp (srcIndex, bufferToDelay));
-                                        renderingOps.add (new DelayChannelOp (bufferToDelay, maxLatency - nodeDelay));
-                                        srcIndex = bufferToDelay;
-                                    }
+                                    program.copyChannel (srcIndex, bufferToDelay);
                                 }
-
-                                renderingOps.add (new AddChannelOp (srcIndex, bufIndex));
+                                else
+                                {
+                                    // held until the merge, after which it's free again
+                                    markBufferAsContaining (bufferToDelay, portType, anonymousNodeID, 0);
+                                    program.copyMidi (srcIndex, bufferToDelay);
+                                }
+                                srcIndex = bufferToDelay;
                             }
+
+                            delayBuffer (program, portType, srcIndex, sourceNodes.getUnchecked (j), maxLatency);
+
+                            if (portType == PortType::Audio)
+                                program.addChannel (srcIndex, bufIndex);
                             else if (portType == PortType::Midi)
-                            {
-                                renderingOps.add (new AddMidiBufferOp (srcIndex, bufIndex));
-                            }
+                                midiSources.add (srcIndex);
                         }
                     }
                 }
+
+                midiSources.removeFirstMatchingValue (bufIndex);
+                if (midiSources.size() > 0)
+                    program.mergeMidi (midiSources, bufIndex);
             }
 
             jassert (bufIndex >= 0);
@@ -729,8 +2357,23 @@ private:
 
         int totalChans = jmax (node->getNumPorts (PortType::Audio, true),
                                node->getNumPorts (PortType::Audio, false));
-        renderingOps.add (new ProcessBufferOp (node, channelsToUse [PortType::Audio],
-                                               totalChans, 0, channelsToUse));
+        program.processBuffer (*node, *graph.context, channelsToUse [PortType::Audio],
+                               totalChans, 0, channelsToUse);
+    }
+
+    /** Delays a buffer coming from sourceNode so it lines up with the
+        input of the node with the most latency */
+    void delayBuffer (RenderProgram& program, const PortType type, const int bufIndex,
+                      const uint32 sourceNode, const int maxLatency)
+    {
+        const int nodeDelay = getNodeDelay (sourceNode);
+        if (nodeDelay >= maxLatency || bufIndex == getReadOnlyEmptyBuffer())
+            return;
+
+        if (type == PortType::Audio)
+            program.delayChannel (bufIndex, maxLatency - nodeDelay);
+        else if (type == PortType::Midi)
+            program.delayMidi (bufIndex, maxLatency - nodeDelay);
     }
 
     int getFreeBuffer (PortType type)
@@ -752,78 +2395,509 @@ private:
     }
 
     int32 getBufferContaining (const PortType type, const uint32 nodeId, const uint32 outputPort) noexcept
+    {
+        const auto& buffers = bufferForOutput [type.id()];
+        const auto key = outputKey (nodeId, outputPort);
+        return buffers.contains (key) ? buffers [key] : -1;
+    }
+
+    void forgetBufferContents (const uint32 type, const int bufferNum)
+    {
+        const uint32 nodeId = allNodes[type].getUnchecked (bufferNum);
+        if (! isNodeBusy (nodeId))
+            return;
+
+        auto& buffers = bufferForOutput [type];
+        const auto key = outputKey (nodeId, allPorts[type].getUnchecked (bufferNum));
+        if (buffers.contains (key) && buffers [key] == bufferNum)
+            buffers.remove (key);
+    }
+
+    void markUnusedBuffersFree (const int stepIndex)
+    {
+        for (uint32 type = 0; type < PortType::Unknown; ++type)
+        {
+            Array<uint32>& nodes = allNodes [type];
+            Array<uint32>& ports = allPorts [type];
+
+            for (int i = 0; i < nodes.size(); ++i)
+            {
+                if (isNodeBusy (nodes.getUnchecked (i))
+                     && ! isBufferNeededLater (stepIndex, KV_INVALID_PORT,
+                                                          nodes.getUnchecked(i),
+                                                          ports.getUnchecked(i)))
+                {
+                    forgetBufferContents (type, i);
+                    nodes.set (i, (uint32) freeNodeID);
+                }
+            }
+        }
+    }
+
+    bool isBufferNeededLater (int stepIndexToSearchFrom, uint32 inputChannelOfIndexToIgnore,
+                              const uint32 sourceNode, const uint32 outputPortIndex) const
+    {
+        const LastUse use = lastUses [outputKey (sourceNode, outputPortIndex)];
+
+        if (use.step != stepIndexToSearchFrom)
+            return use.step > stepIndexToSearchFrom;
+
+        return use.manyPorts || use.port != inputChannelOfIndexToIgnore;
+    }
+
+    void markBufferAsContaining (int bufferNum, PortType type, uint32 nodeId, uint32 portIndex)
     {
         Array<uint32>& nodes = allNodes [type.id()];
         Array<uint32>& ports = allPorts [type.id()];
 
-        for (int i = nodes.size(); --i >= 0;)
-            if (nodes.getUnchecked(i) == nodeId
-                 && ports.getUnchecked(i) == outputPort)
-                return i;
+        jassert (bufferNum >= 0 && bufferNum < nodes.size());
+        forgetBufferContents ((uint32) type.id(), bufferNum);
+        nodes.set (bufferNum, nodeId);
+        ports.set (bufferNum, portIndex);
+
+        if (nodeId != (uint32) anonymousNodeID)
+            bufferForOutput[type.id()].set (outputKey (nodeId, portIndex), bufferNum);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessorGraphBuilder)
+};
+
+class RenderSequence;
+
+/** The nodes of a graph which don't depend on live input, rendered up to a
+    few blocks before the device callback needs them. The graph's ahead thread
+    keeps it topped up. When that thread falls behind, the audio thread renders
+    the missing block itself, so the output is the same either way. If the
+    ahead thread is in the middle of that block, the audio thread doesn't wait:
+    the taps output silence and the nodes rendered ahead fall a block behind */
+class AheadSequence
+{
+public:
+    AheadSequence (const GraphSnapshot& snapshot, int blockSize);
+    ~AheadSequence();
+
+    /** Blocks rendered ahead of the device callback, at most */
+    static const int numBlocksAhead = 4;
+
+    /** Renders the next block if there is room for it and no other thread is
+        rendering one. Returns false if nothing was rendered */
+    bool renderNextBlock();
+
+    /** Audio thread: renders the block before the live nodes run if the ahead
+        thread hasn't, without waiting for it. Sets the context's aheadReady */
+    void prepareToRead (int numSamples) noexcept;
+
+    /** Audio thread: called once the live nodes have read numSamples */
+    void finishedRead (const int numSamples) noexcept
+    {
+        if (context.aheadReady.get() != 0)
+            numReady -= numSamples;
+    }
+
+    /** Audio thread: takes what the sequence this one replaces rendered
+        ahead, so a recompile doesn't skip it. Neither sequence may be in use
+        by the ahead thread */
+    void carryOver (AheadSequence& previous) noexcept;
+
+private:
+    std::unique_ptr<RenderSequence> sequence;
+    RenderContext& context;
+    Array<GraphSnapshot::AheadTap> taps;
+    const int blockSize;
+    Atomic<int> numReady { 0 };
+    Atomic<int> rendering { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (AheadSequence)
+};
+
+/** A compiled rendering sequence with its own preallocated buffers. It is
+    built off the audio thread, handed over with an atomic pointer swap and
+    never modified while the audio thread is using it */
+class RenderSequence
+{
+public:
+    RenderSequence (const GraphSnapshot& snapshot, const int maxBlockSize)
+    {
+        Array<uint32> nodeIds;
+        for (const auto* const info : snapshot.nodes)
+            nodeIds.add (info->nodeId);
+
+        Array<int> order;
+        sortNodesForRendering (nodeIds, snapshot.connections, order);
+
+        ProcessorGraphBuilder builder (snapshot, order, program);
+        program.finish (builder.buffersNeeded (PortType::Audio),
+                        builder.buffersNeeded (PortType::Midi));
+        latencySamples = builder.getLatencySamples();
+        serial = snapshot.serial;
+
+        const int numAudioBuffers = program.getNumBuffers (Resource::AudioBuffer);
+        const int numMidiBuffers  = program.getNumBuffers (Resource::MidiBuffer);
+        blockSize = jmax (1, maxBlockSize);
+
+        program.prepare (blockSize);
+        taskGraph.reset (new TaskGraph (program, numAudioBuffers, numMidiBuffers));
+
+        // planar, with every channel starting on a cache line
+        const int stride = (blockSize + floatsPerCacheLine - 1) & ~(floatsPerCacheLine - 1);
+        audioData.calloc ((size_t) (numAudioBuffers * stride + floatsPerCacheLine));
+        auto* const base = reinterpret_cast<float*> ((reinterpret_cast<pointer_sized_int> (audioData.get()) + cacheLineBytes - 1)
+                                                        & ~(pointer_sized_int) (cacheLineBytes - 1));
+        audioChannels.malloc ((size_t) numAudioBuffers);
+        for (int i = 0; i < numAudioBuffers; ++i)
+            audioChannels[i] = base + i * stride;
+        audio.setDataToReferTo (audioChannels, numAudioBuffers, blockSize);
+
+        silent.malloc ((size_t) numAudioBuffers);
+        for (int i = 0; i < numAudioBuffers; ++i)
+            silent[i] = true;
+        silenceValidFor = blockSize;
+        for (int i = 0; i < numMidiBuffers; ++i)
+            FixedMidiBuffer::reserve (*midi.add (new MidiBuffer()));
+
+        footprint.numAudioBuffers       = numAudioBuffers;
+        footprint.numMidiBuffers        = numMidiBuffers;
+        footprint.numAudioBuffersBuilt  = program.getNumBuffersBuilt (Resource::AudioBuffer);
+        footprint.numMidiBuffersBuilt   = program.getNumBuffersBuilt (Resource::MidiBuffer);
+        footprint.blockSize             = blockSize;
+        footprint.audioBytes            = (int64) numAudioBuffers * stride * (int64) sizeof (float);
+        footprint.midiBytes             = (int64) numMidiBuffers * FixedMidiBuffer::capacity;
+
+        if (snapshot.ahead != nullptr)
+            ahead.reset (new AheadSequence (*snapshot.ahead, blockSize));
+
+        for (const auto* const stageSnapshot : snapshot.stages)
+        {
+            const auto* const stage = stages.add (new RenderSequence (*stageSnapshot, maxBlockSize));
+            latencySamples = jmax (latencySamples, stage->latencySamples);
+            footprint.numAudioBuffers       += stage->footprint.numAudioBuffers;
+            footprint.numMidiBuffers        += stage->footprint.numMidiBuffers;
+            footprint.numAudioBuffersBuilt  += stage->footprint.numAudioBuffersBuilt;
+            footprint.numMidiBuffersBuilt   += stage->footprint.numMidiBuffersBuilt;
+            footprint.audioBytes            += stage->footprint.audioBytes;
+            footprint.midiBytes             += stage->footprint.midiBytes;
+        }
+    }
+
+    /** A silence flag only holds for as many samples as the block that set
+        it, and anything after that may still be audio. Call before rendering
+        each block: the flags are dropped when a block is longer than the last */
+    void prepareSilence (const int numSamples) noexcept
+    {
+        // buffer zero is the read-only empty buffer, always silent
+        if (numSamples > silenceValidFor)
+            for (int i = 1; i < audio.getNumChannels(); ++i)
+                silent[i] = false;
+        silenceValidFor = numSamples;
+
+        for (auto* const stage : stages)
+            stage->prepareSilence (numSamples);
+    }
+
+    /** Renders this sequence and its pipeline stages at the same time, one
+        stage per task */
+    class StageJob : public RenderPool::Job
+    {
+    public:
+        StageJob (RenderSequence& s) : sequence (s) { }
+
+        void prepare (const int numSamples) noexcept
+        {
+            numSamplesToRender = numSamples;
+            remaining = 1 + sequence.stages.size();
+            tasks.reset (1 + sequence.stages.size());
+        }
+
+        bool performNextTask() override
+        {
+            const int index = tasks.claim();
+            if (index < 0)
+                return false;
+
+            auto& stage = index == 0 ? sequence : *sequence.stages.getUnchecked (index - 1);
+            stage.program.perform (stage.audio, stage.midi, stage.silent, numSamplesToRender);
+            --remaining;
+            return true;
+        }
+
+        bool isFinished() const override { return remaining.get() <= 0; }
+
+    private:
+        RenderSequence& sequence;
+        int numSamplesToRender = 0;
+        RenderPool::TaskCounter tasks;
+        Atomic<int> remaining { 0 };
+    };
+
+    RenderProgram program;
+    std::unique_ptr<TaskGraph> taskGraph;
+    AudioSampleBuffer audio;
+    OwnedArray<MidiBuffer> midi;
+    HeapBlock<bool> silent;
+    int silenceValidFor = 0;    // samples the silence flags hold for, see prepareSilence
+    int latencySamples = 0;
+    int blockSize = 0;
+    int serial = 0;
+    GraphProcessor::BufferFootprint footprint;
+
+    /** The part rendered ahead of the device callback, if any */
+    std::unique_ptr<AheadSequence> ahead;
+
+    /** Pipeline stages after this one, if any. See splitIntoStages */
+    OwnedArray<RenderSequence> stages;
+    StageJob stageJob { *this };
+
+    /** Link used while waiting to be deleted after the audio thread let go */
+    RenderSequence* nextRetired = nullptr;
+
+    /** The render pool's epoch when the audio thread let go. See RenderPool::isReleased */
+    int64 retiredEpoch = 0;
+
+private:
+    static const int cacheLineBytes = 64;
+    static const int floatsPerCacheLine = cacheLineBytes / (int) sizeof (float);
+    HeapBlock<float> audioData;
+    HeapBlock<float*> audioChannels;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderSequence)
+};
+
+AheadSequence::AheadSequence (const GraphSnapshot& snapshot, const int blockSize_)
+    : sequence (new RenderSequence (snapshot, blockSize_)),
+      context (*snapshot.context),
+      taps (snapshot.aheadTaps),
+      blockSize (blockSize_) { }
+
+AheadSequence::~AheadSequence() { }
+
+bool AheadSequence::renderNextBlock()
+{
+    if (! rendering.compareAndSetBool (1, 0))
+        return false;
+
+    const bool hasRoom = numReady.get() + blockSize <= numBlocksAhead * blockSize;
+    if (hasRoom)
+    {
+        sequence->program.perform (sequence->audio, sequence->midi, sequence->silent, blockSize);
+        numReady += blockSize;
+    }
+
+    rendering = 0;
+    return hasRoom;
+}
+
+void AheadSequence::prepareToRead (const int numSamples) noexcept
+{
+    jassert (numSamples <= blockSize);
+    bool ready = numReady.get() >= numSamples;
+    if (! ready)
+    {
+        // fails if the ahead thread is rendering the block right now
+        ++context.numAheadBlocksMissed;
+        ready = renderNextBlock();
+    }
+
+    context.aheadReady = ready ? 1 : 0;
+}
+
+void AheadSequence::carryOver (AheadSequence& previous) noexcept
+{
+    jassert (numReady.get() == 0);
+    const int numSamples = jmin (previous.numReady.get(), numBlocksAhead * blockSize);
+    if (numSamples <= 0)
+        return;
+
+    for (const auto& tap : taps)
+    {
+        AheadBuffer* source = nullptr;
+        for (const auto& old : previous.taps)
+            if (old.nodeId == tap.nodeId)
+                source = old.buffer.get();
+
+        // a node rendered ahead for the first time starts after what was carried
+        if (source != nullptr)
+            tap.buffer->moveFrom (*source, numSamples);
+        else
+            tap.buffer->writeSilence (numSamples);
+    }
+
+    numReady = numSamples;
+}
+
+}
+
+/** Compiles rendering sequences on a background thread shared by all graphs */
+class GraphProcessor::Compiler : public ThreadPoolJob,
+                                 private AsyncUpdater
+{
+public:
+    Compiler (GraphProcessor& g)
+        : ThreadPoolJob ("GraphCompiler"),
+          graph (g) { }
+
+    ~Compiler()
+    {
+        cancel();
+    }
+
+    /** True while a compile is running or its result hasn't been delivered */
+    bool isBusy() const
+    {
+        const ScopedLock sl (lock);
+        return busy;
+    }
+
+    /** Starts compiling a snapshot for a build. Takes ownership of the snapshot */
+    void start (GraphRender::GraphSnapshot* snapshotToCompile, const int blockSize, const int build)
+    {
+        const ScopedLock sl (lock);
+        jassert (! busy);
+        snapshot.reset (snapshotToCompile);
+        maxBlockSize = blockSize;
+        buildNumber = build;
+        busy = true;
+        pool->addJob (this, false);
+    }
+
+    /** Stops a pending compile and throws away its result. Can be called from
+        any thread, e.g. by prepareToPlay on the device thread */
+    void cancel()
+    {
+        {
+            const ScopedLock sl (lock);
+            if (! busy)
+                return;
+        }
+
+        // a running job needs the lock to finish, so wait for it unlocked
+        pool->removeJob (this, false, -1);
+        const ScopedLock sl (lock);
+        cancelPendingUpdate();
+        result.reset();
+        snapshot.reset();
+        busy = false;
+    }
+
+    JobStatus runJob() override
+    {
+        auto* const sequence = new GraphRender::RenderSequence (*snapshot, maxBlockSize);
+        const ScopedLock sl (lock);
+        result.reset (sequence);
+        triggerAsyncUpdate();
+        return jobHasFinished;
+    }
+
+private:
+    struct Pool : public ThreadPool
+    {
+        Pool() : ThreadPool (1) { }
+    };
+
+    GraphProcessor& graph;
+    SharedResourcePointer<Pool> pool;
+    CriticalSection lock;
+    std::unique_ptr<GraphRender::GraphSnapshot> snapshot;
+    std::unique_ptr<GraphRender::RenderSequence> result;
+    int maxBlockSize = 0;
+    int buildNumber = 0;
+    bool busy = false;
+
+    void handleAsyncUpdate() override
+    {
+        // the job can still be in the pool for a moment after runJob returns
+        pool->waitForJobToFinish (this, -1);
+
+        std::unique_ptr<GraphRender::RenderSequence> sequence;
+        int build = 0;
+        {
+            const ScopedLock sl (lock);
+            sequence.reset (result.release());
+            snapshot.reset();
+            build = buildNumber;
+            busy = false;
+        }
+
+        graph.compilerFinished (sequence.release(), build);
+    }
+};
+
+/** Delivers a sequence published off the message thread to the message thread */
+class GraphProcessor::Notifier : public AsyncUpdater
+{
+public:
+    Notifier (GraphProcessor& g) : graph (g) { }
+    ~Notifier() { cancelPendingUpdate(); }
+
+    void handleAsyncUpdate() override { graph.renderingSequencePublished(); }
+
+private:
+    GraphProcessor& graph;
+};
+
+/** Keeps the ahead part of the active rendering sequence topped up. The audio
+    thread publishes the sequence in aheadTarget and wakes this thread after
+    each block. While rendering, aheadInUse holds the sequence, and the audio
+    thread keeps it active until we let go */
+class GraphProcessor::AheadRenderer : public Thread
+{
+public:
+    AheadRenderer (GraphProcessor& g)
+        : Thread ("ElementRenderAhead"),
+          graph (g) { }
 
-        return -1;
+    ~AheadRenderer()
+    {
+        signalThreadShouldExit();
+        wakeup.signal();
+        stopThread (1000);
     }
 
-    void markUnusedBuffersFree (const int stepIndex)
+    void run() override
     {
-        for (uint32 type = 0; type < PortType::Unknown; ++type)
+        while (! threadShouldExit())
         {
-            Array<uint32>& nodes = allNodes [type];
-            Array<uint32>& ports = allPorts [type];
+            wakeup.wait();
 
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                if (isNodeBusy (nodes.getUnchecked (i))
-                     && ! isBufferNeededLater (stepIndex, KV_INVALID_PORT,
-                                                          nodes.getUnchecked(i),
-                                                          ports.getUnchecked(i)))
-                {
-                    nodes.set (i, (uint32) freeNodeID);
-                }
-            }
+            auto* const sequence = graph.aheadTarget.get();
+            if (sequence == nullptr)
+                continue;
+
+            // the audio thread clears the target before checking aheadInUse, so
+            // once it has been checked the sequence is never rendered here again
+            graph.aheadInUse = sequence;
+            while (! threadShouldExit() && graph.aheadTarget.get() == sequence
+                    && sequence->ahead->renderNextBlock())
+                ++graph.renderContext->numAheadBlocksRendered;
+            graph.aheadInUse = nullptr;
         }
     }
 
-    bool isBufferNeededLater (int stepIndexToSearchFrom, uint32 inputChannelOfIndexToIgnore,
-                              const uint32 sourceNode, const uint32 outputPortIndex) const
-    {
-        while (stepIndexToSearchFrom < orderedNodes.size())
-        {
-            const GraphNode* const node = (const GraphNode*) orderedNodes.getUnchecked (stepIndexToSearchFrom);
-
-            {
-                for (uint32 port = 0; port < node->getNumPorts(); ++port)
-                {
-                    if (port != inputChannelOfIndexToIgnore &&
-                          graph.getConnectionBetween (sourceNode, outputPortIndex, node->nodeId, port) != nullptr)
-                    {
-                        return true;
-                    }
-                }
-            }
+    /** Signalled by the audio thread without locking */
+    Semaphore wakeup { 1 };
 
-            inputChannelOfIndexToIgnore = KV_INVALID_PORT;
-            ++stepIndexToSearchFrom;
-        }
+private:
+    GraphProcessor& graph;
+};
 
-        return false;
-    }
+/** Deletes the sequences the audio thread has let go of, and detaches the
+    removed nodes they were rendering, while there are any */
+class GraphProcessor::Reclaimer : public Timer
+{
+public:
+    Reclaimer (GraphProcessor& g) : graph (g) { }
 
-    void markBufferAsContaining (int bufferNum, PortType type, uint32 nodeId, uint32 portIndex)
+    void timerCallback() override
     {
-        Array<uint32>& nodes = allNodes [type.id()];
-        Array<uint32>& ports = allPorts [type.id()];
-
-        jassert (bufferNum >= 0 && bufferNum < nodes.size());
-        nodes.set (bufferNum, nodeId);
-        ports.set (bufferNum, portIndex);
+        graph.reclaimRenderingSequences();
+        if (graph.retiredSequences.get() == nullptr && graph.pendingSequence.get() == nullptr
+             && graph.removedNodes.isEmpty())
+            stopTimer();
     }
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessorGraphBuilder)
+private:
+    GraphProcessor& graph;
 };
 
-}
-
 GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 sourcePort_,
                                         const uint32 destNode_, const uint32 destPort_) noexcept
     : Arc (sourceNode_, sourcePort_, destNode_, destPort_)
@@ -837,20 +2911,31 @@ GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 s
     
 GraphProcessor::GraphProcessor()
     : lastNodeId (0),
-      renderingBuffers (1, 1),
       currentAudioInputBuffer (nullptr),
       currentAudioOutputBuffer (1, 1),
       currentMidiInputBuffer (nullptr)
 {
+    compiler.reset (new Compiler (*this));
+    notifier.reset (new Notifier (*this));
+    aheadRenderer.reset (new AheadRenderer (*this));
+    reclaimer.reset (new Reclaimer (*this));
+    renderContext.reset (new GraphRender::RenderContext());
     for (int i = 0; i < AudioGraphIOProcessor::numDeviceTypes; ++i)
         ioNodes[i] = KV_INVALID_PORT;
+    publishMidiChannels();
 }
 
 GraphProcessor::~GraphProcessor()
 {
     renderingSequenceChanged.disconnect_all_slots();
+    cancelPendingUpdate();
+    reclaimer->stopTimer();
+    compiler->cancel();
+    notifier.reset();
+    aheadRenderer.reset();
+    nodes.clear();
+    connections.clear();
     clearRenderingSequence();
-    clear();
 }
 
 const String GraphProcessor::getName() const
@@ -860,10 +2945,13 @@ const String GraphProcessor::getName() const
 
 void GraphProcessor::clear()
 {
-    nodes.clear();
-    connections.clear();
-    //triggerAsyncUpdate();
-    handleAsyncUpdate();
+    {
+        const ScopedLock sl (topologyLock);
+        nodes.clear();
+        connections.clear();
+    }
+
+    buildRenderingSequence();
 }
 
 GraphNode* GraphProcessor::getNodeForId (const uint32 nodeId) const
@@ -920,6 +3008,7 @@ GraphNode* GraphProcessor::addNode (AudioProcessor* const newProcessor, uint32 n
         node->setParentGraph (this);
         node->resetPorts();
         node->prepare (getSampleRate(), getBlockSize(), this);
+        const ScopedLock sl (topologyLock);
         nodes.add (node);
         triggerAsyncUpdate();
         return node;
@@ -971,6 +3060,7 @@ GraphNode* GraphProcessor::addNode (GraphNode* newNode, uint32 nodeId)
     newNode->setParentGraph (this);
     newNode->resetPorts();
     newNode->prepare (getSampleRate(), getBlockSize(), this);
+    const ScopedLock sl (topologyLock);
     triggerAsyncUpdate();
     return nodes.add (newNode);
 }
@@ -979,17 +3069,19 @@ bool GraphProcessor::removeNode (const uint32 nodeId)
 {
     disconnectNode (nodeId);
 
+    const ScopedLock sl (topologyLock);
     for (int i = nodes.size(); --i >= 0;)
     {
         GraphNodePtr n = nodes.getUnchecked (i);
         if (nodes.getUnchecked(i)->nodeId == nodeId)
         {
             nodes.remove (i);
-         
-            // triggerAsyncUpdate();
-            // do this syncronoously so it wont try processing with a null graph
-            handleAsyncUpdate();
-            n->setParentGraph (nullptr);
+
+            // the node keeps its graph until the sequences rendering it are
+            // gone, so it never processes without one. See detachRemovedNodes
+            removedNodes.add ({ n, numSnapshots.get() + 1 });
+            triggerAsyncUpdate();
+            reclaimer->startTimer (reclaimInterval);
 
             if (auto* sub = dynamic_cast<SubGraphProcessor*> (n->getAudioProcessor()))
             {
@@ -1084,6 +3176,7 @@ bool GraphProcessor::addConnection (const uint32 sourceNode, const uint32 source
 
     ArcSorter sorter;
     Connection* c = new Connection (sourceNode, sourcePort, destNode, destPort);
+    const ScopedLock sl (topologyLock);
     connections.addSorted (sorter, c);
     triggerAsyncUpdate();
     return true;
@@ -1102,6 +3195,7 @@ bool GraphProcessor::connectChannels (PortType type, uint32 sourceNode, int32 so
 
 void GraphProcessor::removeConnection (const int index)
 {
+    const ScopedLock sl (topologyLock);
     connections.remove (index);
     triggerAsyncUpdate();
 }
@@ -1183,49 +3277,150 @@ void GraphProcessor::setMidiChannel (const int channel) noexcept
         midiChannels.setOmni (true);
     else
         midiChannels.setChannel (channel);
+    publishMidiChannels();
 }
 
 void GraphProcessor::setMidiChannels (const BigInteger channels) noexcept
 {
-    ScopedLock sl (getCallbackLock());
     midiChannels.setChannels (channels);
+    publishMidiChannels();
 }
 
 void GraphProcessor::setMidiChannels (const kv::MidiChannels channels) noexcept
 {
-    ScopedLock sl (getCallbackLock());
     midiChannels = channels;
+    publishMidiChannels();
 }
 
 bool GraphProcessor::acceptsMidiChannel (const int channel) const noexcept
 {
-    ScopedLock sl (getCallbackLock());
-    return midiChannels.isOn (channel);
+    return isPositiveAndBelow (channel, 17)
+        && (midiChannelMask.get() & (1 << channel)) != 0;
+}
+
+void GraphProcessor::publishMidiChannels() noexcept
+{
+    // the audio thread reads the channels as one bit each, channel zero is omni
+    int mask = midiChannels.isOmni() ? allMidiChannels : 0;
+    for (int channel = 1; channel <= 16; ++channel)
+        if (midiChannels.isOn (channel))
+            mask |= (1 << channel);
+    midiChannelMask = mask;
+}
+
+void GraphProcessor::setMultiCoreRendering (const bool shouldUseMultipleCores)
+{
+    if (shouldUseMultipleCores)
+        renderPool->start();
+    multiCore.set (shouldUseMultipleCores ? 1 : 0);
+}
+
+void GraphProcessor::setAnticipativeRendering (const bool shouldRenderAhead)
+{
+    if (shouldRenderAhead && ! aheadRenderer->isThreadRunning())
+        aheadRenderer->startThread (8);
+
+    if (isAnticipativeRendering() == shouldRenderAhead)
+        return;
+    anticipative = shouldRenderAhead ? 1 : 0;
+    triggerAsyncUpdate();
+}
+
+void GraphProcessor::setPipelineStages (const int numStages)
+{
+    const int stages = jlimit (1, maxPipelineStages, numStages);
+    if (stages > 1)
+        renderPool->start();
+
+    if (pipelineStages.get() == stages)
+        return;
+    pipelineStages = stages;
+    triggerAsyncUpdate();
+}
+
+void GraphProcessor::setRenderQuantum (const int numSamples)
+{
+    const int quantum = jmax (0, numSamples);
+    if (renderQuantum.get() == quantum)
+        return;
+    renderQuantum = quantum;
+    triggerAsyncUpdate();
+}
+
+void GraphProcessor::setSilentNodeSkipping (const bool shouldSkip)
+{
+    renderContext->skipSilentNodes.set (shouldSkip ? 1 : 0);
+}
+
+bool GraphProcessor::isSkippingSilentNodes() const noexcept
+{
+    return renderContext->skipSilentNodes.get() != 0;
+}
+
+int64 GraphProcessor::getNumNodeBlocksProcessed() const noexcept
+{
+    return renderContext->numNodeBlocksProcessed.get();
+}
+
+int64 GraphProcessor::getNumNodeBlocksSkipped() const noexcept
+{
+    return renderContext->numNodeBlocksSkipped.get();
+}
+
+void GraphProcessor::resetNodeBlockCounts()
+{
+    renderContext->numNodeBlocksProcessed = 0;
+    renderContext->numNodeBlocksSkipped = 0;
+    renderContext->numAheadBlocksMissed = 0;
+    renderContext->numAheadBlocksRendered = 0;
+}
+
+int64 GraphProcessor::getNumAheadBlocksMissed() const noexcept
+{
+    return renderContext->numAheadBlocksMissed.get();
+}
+
+int64 GraphProcessor::getNumAheadBlocksRendered() const noexcept
+{
+    return renderContext->numAheadBlocksRendered.get();
 }
 
 void GraphProcessor::setVelocityCurveMode (const VelocityCurve::Mode mode) noexcept
 {
-    ScopedLock sl (getCallbackLock());
-    velocityCurve.setMode (mode);
+    velocityCurveMode = static_cast<int> (mode);
 }
 
-static void deleteRenderOpArray (Array<void*>& ops)
+bool GraphProcessor::isRenderingSequencePending() const
 {
-    for (int i = ops.size(); --i >= 0;)
-        delete static_cast<GraphRender::Task*> (ops.getUnchecked (i));
-    ops.clearQuick();
+    if (isUpdatePending() || compiler->isBusy())
+        return true;
+
+    for (const auto* const node : nodes)
+        if (auto* const graph = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+            if (graph->isRenderingSequencePending())
+                return true;
+
+    return false;
 }
 
 void GraphProcessor::clearRenderingSequence()
 {
-    Array<void*> oldOps;
-
+    // only safe when the audio thread isn't rendering this graph. The active
+    // sequence is retired like a swapped out one, since a render worker may
+    // still hold one of its jobs
+    compiler->cancel();
+    stopRenderingAhead();
+    delete pendingSequence.exchange (nullptr);
+    if (auto* const active = activeSequence)
     {
-        const ScopedLock sl (getCallbackLock());
-        renderingOps.swapWith (oldOps);
+        activeSequence = nullptr;
+        retireRenderingSequence (active);
     }
 
-    deleteRenderOpArray (oldOps);
+    renderPool->waitForRelease (renderPool->getEpoch());
+    reclaimRenderingSequences();
+    jassert (retiredSequences.get() == nullptr);
+    detachRemovedNodes (std::numeric_limits<int>::max());
 }
 
 bool GraphProcessor::isAnInputTo (const uint32 possibleInputId,
@@ -1248,82 +3443,218 @@ bool GraphProcessor::isAnInputTo (const uint32 possibleInputId,
     return false;
 }
 
-void GraphProcessor::buildRenderingSequence()
+GraphRender::GraphSnapshot* GraphProcessor::createSnapshot()
 {
-    Array<void*> newRenderingOps;
-    int numRenderingBuffersNeeded = 2;
-    int numMidiBuffersNeeded = 1;
-
+    // prepareToPlay can call this from the device thread, so hold off graph
+    // edits while nodes are prepared and the topology is read
+    const ScopedLock sl (topologyLock);
+    auto* const snapshot = new GraphRender::GraphSnapshot();
+    snapshot->serial = ++numSnapshots;
+    for (auto* const node : nodes)
     {
-        //XXX:
-        MessageManagerLock mml;
+        node->prepare (getSampleRate(), getBlockSize(), this);
+        snapshot->nodes.add (new GraphRender::NodeInfo (node));
+    }
 
-        Array<void*> orderedNodes;
+    for (const auto* const c : connections)
+        snapshot->connections.add ({ c->sourceNode, c->sourcePort, c->destNode, c->destPort });
 
-        {
-            const LookupTable table (connections);
+    snapshot->context = renderContext.get();
+    if (isAnticipativeRendering())
+        GraphRender::splitForRenderingAhead (*snapshot, GraphRender::AheadSequence::numBlocksAhead
+                                                            * getRenderBlockSize());
+    GraphRender::splitIntoStages (*snapshot, getPipelineStages(), getRenderBlockSize());
+    return snapshot;
+}
 
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                GraphNode* const node = nodes.getUnchecked(i);
-                node->prepare (getSampleRate(), getBlockSize(), this);
+void GraphProcessor::buildRenderingSequence()
+{
+    // compiles on the calling thread, replacing anything in progress. Compiles
+    // delivered after this started belong to an older build and are dropped
+    int build = 0;
+    {
+        const ScopedLock sl (publishLock);
+        build = ++numBuilds;
+    }
 
-                int j = 0;
-                for (; j < orderedNodes.size(); ++j)
-                    if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                      break;
+    cancelPendingUpdate();
+    compiler->cancel();
 
-                orderedNodes.insert (j, node);
-            }
-        }
+    std::unique_ptr<GraphRender::GraphSnapshot> snapshot (createSnapshot());
+    publishRenderingSequence (new GraphRender::RenderSequence (*snapshot, getRenderBlockSize()), build);
+}
 
-        GraphRender::ProcessorGraphBuilder calculator (*this, orderedNodes, newRenderingOps);
+int GraphProcessor::getRenderBlockSize() const noexcept
+{
+    // nodes are never handed more than the block size they were prepared with
+    const int prepared = getBlockSize() > 0 ? getBlockSize() : 512;
+    const int quantum = renderQuantum.get();
+    return quantum > 0 ? jmin (quantum, prepared) : prepared;
+}
+
+void GraphProcessor::compilerFinished (GraphRender::RenderSequence* sequence, const int build)
+{
+    if (sequence != nullptr)
+        publishRenderingSequence (sequence, build);
 
-        numRenderingBuffersNeeded = calculator.buffersNeeded (PortType::Audio);
-        numMidiBuffersNeeded      = calculator.buffersNeeded (PortType::Midi);
+    if (rebuildRequested)
+    {
+        rebuildRequested = false;
+        handleAsyncUpdate();
     }
+}
+
+void GraphProcessor::publishRenderingSequence (GraphRender::RenderSequence* sequence, const int build)
+{
+    jassert (sequence != nullptr);
+    std::unique_ptr<GraphRender::RenderSequence> replaced (sequence);
 
     {
-        // swap over to the new rendering sequence..
-        const ScopedLock sl (getCallbackLock());
+        const ScopedLock sl (publishLock);
+        if (build != numBuilds)
+            return;
 
-        renderingBuffers.setSize (numRenderingBuffersNeeded, 4096);
-        renderingBuffers.clear();
+        publishedLatency = sequence->latencySamples;
+        publishedFootprint = sequence->footprint;
 
-        for (int i = midiBuffers.size(); --i >= 0;)
-            midiBuffers.getUnchecked(i)->clear();
+        // a sequence the audio thread never picked up can be deleted right away
+        replaced.reset (pendingSequence.exchange (replaced.release()));
+    }
 
-        while (midiBuffers.size() < numMidiBuffersNeeded)
-            midiBuffers.add (new MidiBuffer());
+    replaced.reset();
+    reclaimRenderingSequences();
 
-        renderingOps.swapWith (newRenderingOps);
+    // latency changes and listeners belong to the message thread
+    if (MessageManager::existsAndIsCurrentThread())
+    {
+        notifier->cancelPendingUpdate();
+        renderingSequencePublished();
+    }
+    else
+    {
+        notifier->triggerAsyncUpdate();
     }
+}
 
-    // delete the old ones..
-    deleteRenderOpArray (newRenderingOps);
+void GraphProcessor::renderingSequencePublished()
+{
+    int latency = 0;
+    {
+        const ScopedLock sl (publishLock);
+        latency = publishedLatency;
+        bufferFootprint = publishedFootprint;
+    }
 
+    setLatencySamples (latency);
+    reclaimer->startTimer (reclaimInterval);
     renderingSequenceChanged();
 }
 
-void GraphProcessor::getOrderedNodes (ReferenceCountedArray<GraphNode>& orderedNodes)
+void GraphProcessor::retireRenderingSequence (GraphRender::RenderSequence* sequence)
+{
+    // called by the audio thread at a block boundary, after which nothing
+    // uses the sequence anymore. The message thread deletes it later
+    sequence->retiredEpoch = renderPool->getEpoch();
+    pushRetiredSequence (sequence);
+}
+
+void GraphProcessor::pushRetiredSequence (GraphRender::RenderSequence* sequence)
 {
-    const LookupTable table (connections);
-    for (int i = 0; i < nodes.size(); ++i)
+    for (;;)
     {
-        GraphNode* const node = nodes.getUnchecked(i);
-        
-        int j = 0;
-        for (; j < orderedNodes.size(); ++j)
-            if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                break;
-        
-        orderedNodes.insert (j, node);
+        auto* const head = retiredSequences.get();
+        sequence->nextRetired = head;
+        if (retiredSequences.compareAndSetBool (sequence, head))
+            break;
+    }
+}
+
+void GraphProcessor::reclaimRenderingSequences()
+{
+    // read first: sequences retired after this was set are no older than it
+    int oldestSerialInUse = activeSerial.get();
+
+    auto* sequence = retiredSequences.exchange (nullptr);
+    while (sequence != nullptr)
+    {
+        // a render worker which woke late may still hold one of its jobs
+        auto* const next = sequence->nextRetired;
+        if (renderPool->isReleased (sequence->retiredEpoch))
+        {
+            delete sequence;
+        }
+        else
+        {
+            oldestSerialInUse = jmin (oldestSerialInUse, sequence->serial);
+            pushRetiredSequence (sequence);
+        }
+        sequence = next;
+    }
+
+    detachRemovedNodes (oldestSerialInUse);
+}
+
+void GraphProcessor::detachRemovedNodes (const int oldestSerialInUse)
+{
+    const ScopedLock sl (topologyLock);
+    for (int i = removedNodes.size(); --i >= 0;)
+    {
+        const auto& removed = removedNodes.getReference (i);
+        if (removed.serial > oldestSerialInUse)
+            continue;
+
+        // it may have been added back, here or to another graph
+        auto* const node = removed.node.get();
+        if (node->getParentGraph() == this && ! nodes.contains (node))
+            node->setParentGraph (nullptr);
+        removedNodes.remove (i);
     }
 }
 
+void GraphProcessor::stopRenderingAhead()
+{
+    // the audio thread sets the target again when it renders the next block
+    aheadTarget = nullptr;
+    while (aheadInUse.get() != nullptr)
+        Thread::sleep (1);
+}
+
+void GraphProcessor::getOrderedNodes (ReferenceCountedArray<GraphNode>& orderedNodes)
+{
+    Array<uint32> nodeIds;
+    for (const auto* const node : nodes)
+        nodeIds.add (node->nodeId);
+
+    Array<GraphRender::GraphSnapshot::Connection> arcs;
+    for (const auto* const c : connections)
+        arcs.add ({ c->sourceNode, c->sourcePort, c->destNode, c->destPort });
+
+    Array<int> order;
+    GraphRender::sortNodesForRendering (nodeIds, arcs, order);
+    for (const auto index : order)
+        orderedNodes.add (nodes.getUnchecked (index));
+}
+
 void GraphProcessor::handleAsyncUpdate()
 {
-    buildRenderingSequence();
+    if (compiler->isBusy())
+    {
+        // compile again once the current one is delivered
+        rebuildRequested = true;
+        return;
+    }
+
+    reclaimRenderingSequences();
+
+    // read the build first, a prepareToPlay after it makes this compile stale
+    int build = 0;
+    {
+        const ScopedLock sl (publishLock);
+        build = numBuilds;
+    }
+
+    auto* const snapshot = createSnapshot();
+    compiler->start (snapshot, getRenderBlockSize(), build);
 }
 
 void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
@@ -1332,7 +3663,14 @@ void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBl
     currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), estimatedSamplesPerBlock);
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
-    clearRenderingSequence();
+    FixedMidiBuffer::reserve (currentMidiOutputBuffer);
+    FixedMidiBuffer::reserve (filteredMidi);
+    FixedMidiBuffer::reserve (subBlockMidi);
+    hostClock.reset (sampleRate);
+    blockClock = hostClock;
+    numSubBlockChannels = jmax (getTotalNumInputChannels(), getTotalNumOutputChannels());
+    subBlockChannels.calloc ((size_t) jmax (1, numSubBlockChannels));
+    subBlockInputChannels.calloc ((size_t) jmax (1, numSubBlockChannels));
     
     if (getSampleRate() != sampleRate || getBlockSize() != estimatedSamplesPerBlock)
     {
@@ -1340,29 +3678,36 @@ void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBl
             sampleRate, estimatedSamplesPerBlock);
     }
 
-    for (int i = 0; i < nodes.size(); ++i)
-        nodes.getUnchecked(i)->prepare (sampleRate, estimatedSamplesPerBlock, this);
+    {
+        const ScopedLock sl (topologyLock);
+        for (int i = 0; i < nodes.size(); ++i)
+            nodes.getUnchecked(i)->prepare (sampleRate, estimatedSamplesPerBlock, this);
+    }
 
     buildRenderingSequence();
 }
 
 void GraphProcessor::releaseResources()
 {
-    for (int i = 0; i < nodes.size(); ++i)
-        nodes.getUnchecked(i)->unprepare();
+    stopRenderingAhead();
+    {
+        const ScopedLock sl (topologyLock);
+        for (int i = 0; i < nodes.size(); ++i)
+            nodes.getUnchecked(i)->unprepare();
+    }
 
-    renderingBuffers.setSize (1, 1);
-    midiBuffers.clear();
+    reclaimRenderingSequences();
 
     currentAudioInputBuffer = nullptr;
     currentAudioOutputBuffer.setSize (1, 1);
+    currentAudioOutput = nullptr;
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
 }
 
 void GraphProcessor::reset()
 {
-    const ScopedLock sl (getCallbackLock());
+    const ScopedLock sl (topologyLock);
     for (auto node : nodes)
         if (auto* const proc = node->getAudioProcessor())
             proc->reset();
@@ -1372,17 +3717,85 @@ void GraphProcessor::reset()
 
 void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    processGraph (buffer, buffer, midiMessages);
+}
+
+void GraphProcessor::processBlock (const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                                   MidiBuffer& midiMessages)
+{
+    jassert (&input != &output);
+    jassert (input.getNumSamples() >= output.getNumSamples());
+    processGraph (input, output, midiMessages);
+}
+
+void GraphProcessor::processGraph (const AudioSampleBuffer& input, AudioSampleBuffer& buffer,
+                                   MidiBuffer& midiMessages)
+{
+    const AllocationCounter::ScopedRender rendering;
     const int32 numSamples = buffer.getNumSamples();
 
-    currentAudioInputBuffer = &buffer;
-    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples);
-    currentAudioOutputBuffer.clear();
-    
-    if (midiChannels.isOmni() && velocityCurve.getMode() == VelocityCurve::Linear)
+    bool swapPending = pendingSequence.get() != nullptr;
+    if (swapPending)
     {
-        currentMidiInputBuffer = &midiMessages;
+        // nodes the ahead thread is rendering may be live in the new sequence.
+        // Rather than wait for it, keep the current sequence until a block
+        // where it has let go. Clearing the target first means it can't
+        // pick the sequence up again once we've seen it isn't using it
+        aheadTarget = nullptr;
+        auto* const previous = activeSequence;
+
+        if (previous == nullptr || aheadInUse.get() != previous)
+        {
+            if (auto* const next = pendingSequence.exchange (nullptr))
+            {
+                activeSequence = next;
+                ++numSequenceSwaps;
+
+                if (previous != nullptr)
+                {
+                    if (previous->ahead != nullptr && next->ahead != nullptr)
+                        next->ahead->carryOver (*previous->ahead);
+                    retireRenderingSequence (previous);
+                }
+
+                // after retiring, see reclaimRenderingSequences
+                activeSerial = next->serial;
+            }
+
+            swapPending = false;
+        }
     }
+
+    // MIDI device nodes place their input with this clock. The time is taken
+    // once per host block, nested graphs follow the graph rendering them
+    if (auto* const parent = parentGraph.get())
+        hostClock = parent->getMidiInputClock();
     else
+        hostClock.update (Time::getMillisecondCounterHiRes(), numSamples);
+    blockClock = hostClock;
+
+    auto* const sequence = activeSequence;
+    ++numBlocksRendered;
+
+    auto* const aheadSequence = sequence != nullptr && sequence->ahead != nullptr && ! swapPending
+                              ? sequence : nullptr;
+    if (aheadTarget.get() != aheadSequence)
+        aheadTarget = aheadSequence;
+
+    if (sequence == nullptr)
+    {
+        // nothing compiled yet
+        buffer.clear();
+        midiMessages.clear();
+        return;
+    }
+
+    MidiBuffer* midiInput = &midiMessages;
+
+    // the MIDI settings are published by the message thread without locking
+    const int channelMask = midiChannelMask.get();
+    velocityCurve.setMode (static_cast<VelocityCurve::Mode> (velocityCurveMode.get()));
+    if (channelMask != allMidiChannels || velocityCurve.getMode() != VelocityCurve::Linear)
     {
         filteredMidi.clear();
         MidiBuffer::Iterator iter (midiMessages);
@@ -1391,7 +3804,7 @@ void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMe
         while (iter.getNextEvent (msg, frame))
         {
             chan = msg.getChannel();
-            if (chan > 0 && midiChannels.isOff (chan))
+            if (chan > 0 && (channelMask & (1 << chan)) == 0)
                 continue;
 
             if (msg.isNoteOn())
@@ -1401,25 +3814,115 @@ void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMe
                #endif
             }
 
-            filteredMidi.addEvent (msg, frame);
+            FixedMidiBuffer::addEvent (filteredMidi, msg, frame);
         }
         
-        currentMidiInputBuffer = &filteredMidi;
+        midiInput = &filteredMidi;
     }
-    
-    currentMidiOutputBuffer.clear();
 
-    for (int i = 0; i < renderingOps.size(); ++i)
+    const int quantum = sequence->blockSize;
+    if (numSamples <= quantum)
     {
-        GraphRender::Task* const op = static_cast<GraphRender::Task*> (renderingOps.getUnchecked (i));
-        op->perform (renderingBuffers, midiBuffers, numSamples);
+        renderSequence (*sequence, input, buffer, *midiInput, numSamples);
+        FixedMidiBuffer::copy (midiMessages, currentMidiOutputBuffer);
+        if (aheadSequence != nullptr)
+            aheadRenderer->wakeup.signal();
+        return;
+    }
+
+    // split the host block into pieces which fit the compiled buffers. The
+    // host's MIDI buffer collects the output, so its input is read from a copy
+    if (midiInput == &midiMessages)
+    {
+        FixedMidiBuffer::copy (filteredMidi, midiMessages);
+        midiInput = &filteredMidi;
     }
 
-    for (int i = 0; i < buffer.getNumChannels(); ++i)
-        buffer.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
-    
     midiMessages.clear();
-    midiMessages.addEvents (currentMidiOutputBuffer, 0, numSamples, 0);
+    FixedMidiBuffer::Reader events (*midiInput);
+    const int numChannels = jmin (buffer.getNumChannels(), numSubBlockChannels);
+    const int numInputChannels = jmin (input.getNumChannels(), numSubBlockChannels);
+    const bool inPlace = &input == &buffer;
+    jassert (numChannels == buffer.getNumChannels());
+
+    for (int start = 0; start < numSamples; start += quantum)
+    {
+        const int numThisTime = jmin (quantum, numSamples - start);
+        const bool isLast = start + numThisTime >= numSamples;
+
+        for (int i = 0; i < numChannels; ++i)
+            subBlockChannels[i] = buffer.getWritePointer (i, start);
+        subBlockAudio.setDataToReferTo (subBlockChannels, numChannels, numThisTime);
+
+        if (! inPlace)
+        {
+            for (int i = 0; i < numInputChannels; ++i)
+                subBlockInputChannels[i] = const_cast<float*> (input.getReadPointer (i, start));
+            subBlockInput.setDataToReferTo (subBlockInputChannels, numInputChannels, numThisTime);
+        }
+
+        subBlockMidi.clear();
+        FixedMidiBuffer::append (subBlockMidi, events,
+                                 isLast ? std::numeric_limits<int>::max() : start + numThisTime,
+                                 -start);
+
+        blockClock = hostClock.getPart (start, numThisTime, numSamples);
+        renderSequence (*sequence, inPlace ? subBlockAudio : subBlockInput,
+                        subBlockAudio, subBlockMidi, numThisTime);
+
+        FixedMidiBuffer::Reader output (currentMidiOutputBuffer);
+        FixedMidiBuffer::append (midiMessages, output, std::numeric_limits<int>::max(), start);
+    }
+
+    if (aheadSequence != nullptr)
+        aheadRenderer->wakeup.signal();
+}
+
+void GraphProcessor::renderSequence (GraphRender::RenderSequence& sequence, const AudioSampleBuffer& input,
+                                     AudioSampleBuffer& audio, MidiBuffer& midi, const int numSamples)
+{
+    jassert (numSamples <= sequence.blockSize);
+    currentAudioInputBuffer = &input;
+    if (&input == &audio)
+    {
+        // the output nodes can't write over the input before every input node has read it
+        currentAudioOutputBuffer.setSize (jmax (1, audio.getNumChannels()), numSamples, false, false, true);
+        currentAudioOutputBuffer.clear();
+        currentAudioOutput = &currentAudioOutputBuffer;
+    }
+    else
+    {
+        audio.clear (0, numSamples);
+        currentAudioOutput = &audio;
+    }
+    currentMidiInputBuffer = &midi;
+    currentMidiOutputBuffer.clear();
+    sequence.prepareSilence (numSamples);
+
+    if (sequence.ahead != nullptr)
+        sequence.ahead->prepareToRead (numSamples);
+
+    if (sequence.stages.size() > 0)
+    {
+        sequence.stageJob.prepare (numSamples);
+        renderPool->run (sequence.stageJob);
+    }
+    else if (multiCore.get() != 0 && sequence.taskGraph->getNumSteps() > 1)
+    {
+        sequence.taskGraph->prepare (sequence.audio, sequence.midi, sequence.silent, numSamples);
+        renderPool->run (*sequence.taskGraph);
+    }
+    else
+    {
+        sequence.program.perform (sequence.audio, sequence.midi, sequence.silent, numSamples);
+    }
+
+    if (sequence.ahead != nullptr)
+        sequence.ahead->finishedRead (numSamples);
+
+    if (currentAudioOutput == &currentAudioOutputBuffer)
+        for (int i = 0; i < audio.getNumChannels(); ++i)
+            audio.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
 }
 
 const String GraphProcessor::getInputChannelName (int channelIndex) const
@@ -1531,16 +4034,23 @@ void GraphProcessor::AudioGraphIOProcessor::releaseResources()
 void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buffer,
                                                           MidiBuffer& midiMessages)
 {
-    jassert (graph != nullptr);
+    // a removed node keeps its graph until no rendering sequence uses it
+    if (graph == nullptr)
+    {
+        jassertfalse;
+        buffer.clear();
+        midiMessages.clear();
+        return;
+    }
 
     switch (type)
     {
         case audioOutputNode:
         {
-            for (int i = jmin (graph->currentAudioOutputBuffer.getNumChannels(),
+            for (int i = jmin (graph->currentAudioOutput->getNumChannels(),
                                buffer.getNumChannels()); --i >= 0;)
             {
-                graph->currentAudioOutputBuffer.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
+                graph->currentAudioOutput->addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
             }
 
             break;
@@ -1548,24 +4058,23 @@ void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buf
 
         case audioInputNode:
         {
-            for (int i = jmin (graph->currentAudioInputBuffer->getNumChannels(),
-                               buffer.getNumChannels()); --i >= 0;)
-            {
+            const int numInputs = jmin (graph->currentAudioInputBuffer->getNumChannels(),
+                                        buffer.getNumChannels());
+            for (int i = numInputs; --i >= 0;)
                 buffer.copyFrom (i, 0, *graph->currentAudioInputBuffer, i, 0, buffer.getNumSamples());
-            }
+            for (int i = numInputs; i < buffer.getNumChannels(); ++i)
+                buffer.clear (i, 0, buffer.getNumSamples());
 
             break;
         }
 
         case midiOutputNode:
-            graph->currentMidiOutputBuffer.clear();
-            graph->currentMidiOutputBuffer.addEvents (midiMessages, 0, buffer.getNumSamples(), 0);
+            FixedMidiBuffer::copy (graph->currentMidiOutputBuffer, midiMessages);
             midiMessages.clear();
             break;
 
         case midiInputNode:
-            midiMessages.clear();
-            midiMessages.addEvents (*graph->currentMidiInputBuffer, 0, buffer.getNumSamples(), 0);
+            FixedMidiBuffer::copy (midiMessages, *graph->currentMidiInputBuffer);
             graph->currentMidiInputBuffer->clear();
             break;
 
@@ -21,11 +21,19 @@
 
 #include "ElementApp.h"
 #include "engine/GraphNode.h"
+#include "engine/MidiInputQueue.h"
+#include "engine/RenderPool.h"
 #include "engine/VelocityCurve.h"
 #include "Signals.h"
 
 namespace Element {
 
+namespace GraphRender {
+    class RenderSequence;
+    struct GraphSnapshot;
+    struct RenderContext;
+}
+
 /**
     A type of AudioProcessor which plays back a graph of other AudioProcessors.
 
@@ -107,6 +115,8 @@ public:
     /** Deletes a node within the graph which has the specified ID.
 
         This will also delete any connections that are attached to this node.
+        It returns without waiting for the audio thread. The node keeps this
+        as its parent graph until no rendering sequence uses it anymore.
     */
     bool removeNode (uint32 nodeId);
 
@@ -181,12 +191,113 @@ public:
     /** Set the allowed MIDI channels of this Graph */
     void setMidiChannels (const kv::MidiChannels channels) noexcept;
 
-    /** returns true if this graph is processing the given channel */
+    /** returns true if this graph is processing the given channel. Doesn't
+        lock, so the audio thread can call it */
     bool acceptsMidiChannel (const int channel) const noexcept;
 
-    /** Set the MIDI curve of this graph */
+    /** Set the MIDI curve of this graph. The audio thread picks it up on its
+        next block */
     void setVelocityCurveMode (const VelocityCurve::Mode) noexcept;
 
+    /** The clock MIDI device inputs place their events with. The time is taken
+        once per host block, or followed from the graph this one is nested in,
+        and narrowed to the part being rendered when a block is split. Audio
+        thread only */
+    const MidiInputClock& getMidiInputClock() const noexcept { return blockClock; }
+
+    /** Set by the node holding this graph when it's nested in another one */
+    void setParentGraph (GraphProcessor* graph) noexcept { parentGraph = graph; }
+
+    /** Render independent branches of this graph on multiple cores. Results are
+        identical to single-core rendering. Call from the message thread */
+    void setMultiCoreRendering (const bool shouldUseMultipleCores);
+
+    /** Returns true if multi-core rendering is enabled */
+    bool isMultiCoreRendering() const noexcept { return multiCore.get() != 0; }
+
+    /** Skip nodes whose audio inputs are silent and have no MIDI to handle,
+        once their tail (see AudioProcessor::getTailLengthSeconds) has ended.
+        Nodes without audio inputs are always rendered */
+    void setSilentNodeSkipping (const bool shouldSkip);
+
+    /** Returns true if silent nodes are being skipped */
+    bool isSkippingSilentNodes() const noexcept;
+
+    /** Number of times a node was rendered for a block since the last reset */
+    int64 getNumNodeBlocksProcessed() const noexcept;
+
+    /** Number of times a node was skipped for a block since the last reset */
+    int64 getNumNodeBlocksSkipped() const noexcept;
+
+    /** Resets the processed and skipped counters */
+    void resetNodeBlockCounts();
+
+    /** Number of times the audio thread has switched to a newly compiled
+        rendering sequence. Never reset */
+    int getNumSequenceSwaps() const noexcept { return numSequenceSwaps.get(); }
+
+    /** Render nodes which don't depend on the graph's inputs or devices, directly
+        or through other nodes, a few blocks ahead on a background thread. This
+        absorbs spikes in their processing time without raising the device
+        block size. They see changes to their parameters a little later, and the
+        transport position they are given is the live one. Call from the
+        message thread */
+    void setAnticipativeRendering (const bool shouldRenderAhead);
+
+    /** Returns true if nodes are rendered ahead when possible */
+    bool isAnticipativeRendering() const noexcept { return anticipative.get() != 0; }
+
+    /** Number of blocks the ahead thread fell behind on, since the last reset.
+        The audio thread renders these itself, or outputs silence in place of
+        the nodes rendered ahead if the ahead thread is busy with the block */
+    int64 getNumAheadBlocksMissed() const noexcept;
+
+    /** Number of blocks the ahead thread rendered, since the last reset */
+    int64 getNumAheadBlocksRendered() const noexcept;
+
+    /** Render in pieces of at most this many samples, splitting larger host
+        blocks. Pass 0 to render whole host blocks. Host blocks larger than
+        the prepared block size are always split. Call from the message thread */
+    void setRenderQuantum (const int numSamples);
+
+    /** Returns the render quantum, or 0 if whole host blocks are rendered */
+    int getRenderQuantum() const noexcept { return renderQuantum.get(); }
+
+    /** Most pipeline stages a graph can be cut into */
+    static const int maxPipelineStages = 8;
+
+    /** Cut the rendering sequence into this many stages of about equal cost,
+        rendered at the same time on separate cores. Every stage boundary adds
+        one block of latency, which is included in getLatencySamples(). This
+        lets a long serial chain of nodes use more than one core. Pass 1 to
+        turn it off. Call from the message thread */
+    void setPipelineStages (const int numStages);
+
+    /** Returns the number of pipeline stages, 1 if pipelining is off */
+    int getPipelineStages() const noexcept { return pipelineStages.get(); }
+
+    /** Memory used by the buffers of a compiled rendering sequence */
+    struct BufferFootprint
+    {
+        int numAudioBuffers = 0;        // including the shared empty buffer
+        int numMidiBuffers = 0;
+        int numAudioBuffersBuilt = 0;   // before buffers were shared by liveness
+        int numMidiBuffersBuilt = 0;
+        int blockSize = 0;              // samples in each audio buffer
+        int64 audioBytes = 0;
+        int64 midiBytes = 0;
+
+        int64 getTotalBytes() const noexcept { return audioBytes + midiBytes; }
+    };
+
+    /** Returns the footprint of the most recently compiled rendering sequence.
+        Call from the message thread */
+    BufferFootprint getBufferFootprint() const { return bufferFootprint; }
+
+    /** True while an edit to this graph, or a graph nested in it, hasn't been
+        compiled and published yet. Call from the message thread */
+    bool isRenderingSequencePending() const;
+
     /** A special number that represents the midi channel of a node.
 
         This is used as a channel index value if you want to refer to the midi input
@@ -296,6 +407,11 @@ public:
     virtual void prepareToPlay (double sampleRate, int estimatedBlockSize) override;
     virtual void releaseResources() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+
+    /** Renders reading audio from one buffer and writing it to another, which
+        avoids the copies the in-place version has to make. The input is only
+        read, so several graphs can share it. The buffers must not overlap */
+    void processBlock (const AudioSampleBuffer& input, AudioSampleBuffer& output, MidiBuffer&);
     
     void reset() override;
     
@@ -336,30 +452,91 @@ protected:
 
 private:
     typedef ArcTable<Connection> LookupTable;
+    CriticalSection topologyLock;   // taken by edits, and by readers off the message thread
     ReferenceCountedArray<GraphNode> nodes;
     OwnedArray<Connection> connections;
     uint32 ioNodes [AudioGraphIOProcessor::numDeviceTypes];
     
     uint32 lastNodeId;
-    AudioSampleBuffer renderingBuffers;
-    OwnedArray <MidiBuffer> midiBuffers;
-    Array<void*> renderingOps;
+
+    class Compiler;
+    std::unique_ptr<Compiler> compiler;
+    class Notifier;
+    std::unique_ptr<Notifier> notifier;
+    class AheadRenderer;
+    std::unique_ptr<AheadRenderer> aheadRenderer;
+    class Reclaimer;
+    std::unique_ptr<Reclaimer> reclaimer;
+    static const int reclaimInterval = 100;                         // ms
+    Atomic<int> anticipative { 0 };
+    Atomic<GraphRender::RenderSequence*> aheadTarget { nullptr };   // set by the audio thread
+    Atomic<GraphRender::RenderSequence*> aheadInUse { nullptr };    // set by the ahead thread
+    std::unique_ptr<GraphRender::RenderContext> renderContext;
+    bool rebuildRequested = false;  // message thread only
+    CriticalSection publishLock;    // guards the build number and published values
+    int numBuilds = 0;              // bumped by each synchronous build
+    int publishedLatency = 0;
+    BufferFootprint publishedFootprint;
+    GraphRender::RenderSequence* activeSequence = nullptr; // audio thread only
+    Atomic<GraphRender::RenderSequence*> pendingSequence { nullptr };
+    Atomic<GraphRender::RenderSequence*> retiredSequences { nullptr };
+    Atomic<int> numSnapshots { 0 };
+    Atomic<int> activeSerial { 0 };     // the active sequence's snapshot serial, set by the audio thread
+
+    /** A node removed while a rendering sequence may still use it */
+    struct RemovedNode
+    {
+        GraphNodePtr node;
+        int serial;     // the first snapshot without it
+    };
+    Array<RemovedNode> removedNodes;
+    Atomic<int> numBlocksRendered { 0 };
+    Atomic<int> numSequenceSwaps { 0 };
+    SharedResourcePointer<RenderPool> renderPool;
+    Atomic<int> multiCore { 0 };
+    Atomic<int> renderQuantum { 0 };
+    Atomic<int> pipelineStages { 1 };
+    BufferFootprint bufferFootprint;
 
     friend class AudioGraphIOProcessor;
     friend class GraphPort;
 
-    AudioSampleBuffer* currentAudioInputBuffer;
+    const AudioSampleBuffer* currentAudioInputBuffer;
     AudioSampleBuffer currentAudioOutputBuffer;
+    AudioSampleBuffer* currentAudioOutput = nullptr;    // the above or the caller's output
     MidiBuffer* currentMidiInputBuffer;
     MidiBuffer currentMidiOutputBuffer;
     
-    kv::MidiChannels midiChannels;
-    VelocityCurve velocityCurve;
+    enum { allMidiChannels = (1 << 17) - 1 };
+    kv::MidiChannels midiChannels;                      // message thread only
+    Atomic<int> midiChannelMask { allMidiChannels };    // see publishMidiChannels
+    Atomic<int> velocityCurveMode { VelocityCurve::Linear };
+    VelocityCurve velocityCurve;                        // audio thread only
+    Atomic<GraphProcessor*> parentGraph { nullptr };
+    MidiInputClock hostClock, blockClock;               // audio thread only
     MidiBuffer filteredMidi;
+    AudioSampleBuffer subBlockAudio, subBlockInput;
+    HeapBlock<float*> subBlockChannels, subBlockInputChannels;
+    int numSubBlockChannels = 0;
+    MidiBuffer subBlockMidi;
     
+    void publishMidiChannels() noexcept;
     void handleAsyncUpdate() override;
     void clearRenderingSequence();
     void buildRenderingSequence();
+    int getRenderBlockSize() const noexcept;
+    GraphRender::GraphSnapshot* createSnapshot();
+    void compilerFinished (GraphRender::RenderSequence*, int build);
+    void publishRenderingSequence (GraphRender::RenderSequence*, int build);
+    void renderingSequencePublished();
+    void retireRenderingSequence (GraphRender::RenderSequence*);
+    void pushRetiredSequence (GraphRender::RenderSequence*);
+    void reclaimRenderingSequences();
+    void detachRemovedNodes (int oldestSerialInUse);
+    void stopRenderingAhead();
+    void processGraph (const AudioSampleBuffer& input, AudioSampleBuffer& output, MidiBuffer&);
+    void renderSequence (GraphRender::RenderSequence&, const AudioSampleBuffer& input,
+                         AudioSampleBuffer& output, MidiBuffer&, int numSamples);
     bool isAnInputTo (uint32 possibleInputId, uint32 possibleDestinationId, int recursionCheck) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphProcessor)
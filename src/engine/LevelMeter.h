@@ -0,0 +1,246 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "JuceHeader.h"
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
+namespace Element {
+
+/** Measures the peak and sum of squares of a block of samples in a single
+    pass, optionally while applying a gain ramp, and accumulates them for a
+    number of channels until there are enough samples to publish a reading.
+    Used on the render thread. */
+class LevelMeter
+{
+public:
+    LevelMeter() = default;
+
+    /** Finds the absolute peak and the sum of squares of 'data' */
+    static void measure (const float* data, const int numSamples,
+                         float& peak, float& sumOfSquares) noexcept
+    {
+        int i = 0;
+       #if JUCE_INTEL
+        const __m128 signMask = _mm_set1_ps (-0.f);
+        __m128 vpeak = _mm_setzero_ps();
+        __m128 vsum  = _mm_setzero_ps();
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 v = _mm_loadu_ps (data + i);
+            vpeak = _mm_max_ps (vpeak, _mm_andnot_ps (signMask, v));
+            vsum  = _mm_add_ps (vsum, _mm_mul_ps (v, v));
+        }
+
+        float peaks[4], sums[4];
+        _mm_storeu_ps (peaks, vpeak);
+        _mm_storeu_ps (sums, vsum);
+       #else
+        float peaks[4] = { 0.f, 0.f, 0.f, 0.f };
+        float sums[4]  = { 0.f, 0.f, 0.f, 0.f };
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const float s = data [i + lane];
+                peaks[lane] = jmax (peaks[lane], std::abs (s));
+                sums[lane] += s * s;
+            }
+        }
+       #endif
+
+        peak = jmax (jmax (peaks[0], peaks[1]), jmax (peaks[2], peaks[3]));
+        sumOfSquares = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+        for (; i < numSamples; ++i)
+        {
+            peak = jmax (peak, std::abs (data[i]));
+            sumOfSquares += data[i] * data[i];
+        }
+    }
+
+    /** Multiplies 'data' by a gain which ramps linearly from startGain to
+        endGain. Unity gain leaves the samples untouched */
+    static void applyGain (float* data, const int numSamples,
+                           const float startGain, const float endGain) noexcept
+    {
+        if (startGain == endGain)
+        {
+            if (startGain == 0.f)
+                FloatVectorOperations::clear (data, numSamples);
+            else if (startGain != 1.f)
+                FloatVectorOperations::multiply (data, startGain, numSamples);
+            return;
+        }
+
+        const float increment = (endGain - startGain) / (float) numSamples;
+        int i = 0;
+       #if JUCE_INTEL
+        __m128 vgain = _mm_setr_ps (startGain, startGain + increment,
+                                    startGain + increment * 2.f, startGain + increment * 3.f);
+        const __m128 vstep = _mm_set1_ps (increment * 4.f);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), vgain));
+            vgain = _mm_add_ps (vgain, vstep);
+        }
+       #endif
+        for (; i < numSamples; ++i)
+            data[i] *= startGain + increment * (float) i;
+    }
+
+    /** Applies a gain ramp as applyGain() does, and measures the result in the
+        same pass */
+    static void applyGainAndMeasure (float* data, const int numSamples,
+                                     const float startGain, const float endGain,
+                                     float& peak, float& sumOfSquares) noexcept
+    {
+        if (startGain == endGain && (startGain == 0.f || startGain == 1.f))
+        {
+            if (startGain == 0.f)
+            {
+                FloatVectorOperations::clear (data, numSamples);
+                peak = sumOfSquares = 0.f;
+            }
+            else
+            {
+                measure (data, numSamples, peak, sumOfSquares);
+            }
+            return;
+        }
+
+        const float increment = (endGain - startGain) / (float) numSamples;
+        int i = 0;
+       #if JUCE_INTEL
+        const __m128 signMask = _mm_set1_ps (-0.f);
+        __m128 vgain = _mm_setr_ps (startGain, startGain + increment,
+                                    startGain + increment * 2.f, startGain + increment * 3.f);
+        const __m128 vstep = _mm_set1_ps (increment * 4.f);
+        __m128 vpeak = _mm_setzero_ps();
+        __m128 vsum  = _mm_setzero_ps();
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 v = _mm_mul_ps (_mm_loadu_ps (data + i), vgain);
+            _mm_storeu_ps (data + i, v);
+            vpeak = _mm_max_ps (vpeak, _mm_andnot_ps (signMask, v));
+            vsum  = _mm_add_ps (vsum, _mm_mul_ps (v, v));
+            vgain = _mm_add_ps (vgain, vstep);
+        }
+
+        float peaks[4], sums[4];
+        _mm_storeu_ps (peaks, vpeak);
+        _mm_storeu_ps (sums, vsum);
+       #else
+        float peaks[4] = { 0.f, 0.f, 0.f, 0.f };
+        float sums[4]  = { 0.f, 0.f, 0.f, 0.f };
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const float s = data [i + lane] * (startGain + increment * (float) (i + lane));
+                data [i + lane] = s;
+                peaks[lane] = jmax (peaks[lane], std::abs (s));
+                sums[lane] += s * s;
+            }
+        }
+       #endif
+
+        peak = jmax (jmax (peaks[0], peaks[1]), jmax (peaks[2], peaks[3]));
+        sumOfSquares = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+        for (; i < numSamples; ++i)
+        {
+            const float s = data[i] * (startGain + increment * (float) i);
+            data[i] = s;
+            peak = jmax (peak, std::abs (s));
+            sumOfSquares += s * s;
+        }
+    }
+
+    /** Sets the number of channels and how many samples each reading covers.
+        Not realtime safe */
+    void prepare (const int newNumChannels, const double sampleRate, const double readingsPerSecond = 30.0)
+    {
+        numChannels = jmax (0, newNumChannels);
+        samplesPerReading = jmax (1, roundToInt (sampleRate / readingsPerSecond));
+        peaks.calloc ((size_t) jmax (1, numChannels));
+        sums.calloc ((size_t) jmax (1, numChannels));
+        reset();
+    }
+
+    /** Clears anything accumulated so far */
+    void reset() noexcept
+    {
+        numSamples = 0;
+        for (int c = 0; c < numChannels; ++c)
+            peaks[c] = sums[c] = 0.f;
+    }
+
+    /** Measures a channel and adds it to the current reading. Returns the
+        peak of this block */
+    float addChannel (const int channel, const float* data, const int blockSize) noexcept
+    {
+        jassert (isPositiveAndBelow (channel, numChannels));
+        float peak, sumOfSquares;
+        measure (data, blockSize, peak, sumOfSquares);
+        peaks[channel] = jmax (peaks[channel], peak);
+        sums[channel] += sumOfSquares;
+        return peak;
+    }
+
+    /** Applies a gain ramp to a channel and adds the result to the current
+        reading. Returns the peak of this block after the gain */
+    float addChannel (const int channel, float* data, const int blockSize,
+                      const float startGain, const float endGain) noexcept
+    {
+        jassert (isPositiveAndBelow (channel, numChannels));
+        float peak, sumOfSquares;
+        applyGainAndMeasure (data, blockSize, startGain, endGain, peak, sumOfSquares);
+        peaks[channel] = jmax (peaks[channel], peak);
+        sums[channel] += sumOfSquares;
+        return peak;
+    }
+
+    /** Moves the reading on by a block.  Returns true when a reading is
+        complete, after which the caller should publish the levels and
+        call reset() */
+    bool advance (const int blockSize) noexcept
+    {
+        numSamples += blockSize;
+        return numSamples >= samplesPerReading;
+    }
+
+    int getNumChannels() const noexcept             { return numChannels; }
+    float getPeak (const int channel) const noexcept { return peaks[channel]; }
+    float getRMS (const int channel) const noexcept
+    {
+        return numSamples > 0 ? std::sqrt (sums[channel] / (float) numSamples) : 0.f;
+    }
+
+private:
+    int numChannels = 0;
+    int samplesPerReading = 1;
+    int numSamples = 0;
+    HeapBlock<float> peaks, sums;
+
+    JUCE_DECLARE_NON_COPYABLE (LevelMeter)
+};
+
+}
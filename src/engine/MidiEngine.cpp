@@ -264,7 +264,8 @@ void MidiEngine::handleIncomingMidiMessageInt (MidiInput* source, const MidiMess
     }
 }
 
-void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate)
+void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate,
+                                    MidiInputCallback* const callbackToSkip)
 {
     MidiBuffer::Iterator iter (buffer);
     MidiMessage message; int frame = 0;
@@ -279,7 +280,8 @@ void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, doubl
         
         message.setTimeStamp (timeNow + (1000.0 * (static_cast<double> (frame) / sampleRate)));
         for (auto& mc : midiCallbacks)
-            mc.callback->handleIncomingMidiMessage (nullptr, message);
+            if (mc.callback != callbackToSkip)
+                mc.callback->handleIncomingMidiMessage (nullptr, message);
     }
 }
 
@@ -111,7 +111,10 @@ public:
     */
     MidiOutput* getDefaultMidiOutput() const noexcept               { return defaultMidiOutput.get(); }
 
-    void processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate);
+    /** Sends MIDI from a plugin host to the input callbacks, except
+        callbackToSkip which is handed the buffer some other way */
+    void processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate,
+                            MidiInputCallback* callbackToSkip = nullptr);
 
     CriticalSection& getMidiOutputLock() { return midiOutputLock; }
 
@@ -0,0 +1,282 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/FixedMidiBuffer.h"
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+//==============================================================================
+void MidiInputClock::reset (const double newSampleRate) noexcept
+{
+    sampleRate   = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    samplePeriod = 1000.0 / sampleRate;
+    windowStart  = windowEnd = nextStart = 0.0;
+    running      = false;
+}
+
+void MidiInputClock::update (const double timeNow, const int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    // loop bandwidth in Hz, and the smallest error which restarts the loop in ms
+    const double bandwidth = 1.0;
+    const double maxError  = 20.0;
+
+    const double nominal     = 1000.0 / sampleRate;
+    const double blockLength = samplePeriod * numSamples;
+    const double error       = timeNow - nextStart;
+
+    if (! running || std::abs (error) > jmax (maxError, 4.0 * blockLength))
+    {
+        samplePeriod = nominal;
+        windowStart  = timeNow - nominal * numSamples;
+        windowEnd    = timeNow;
+        nextStart    = timeNow + nominal * numSamples;
+        running      = true;
+        return;
+    }
+
+    // second order DLL as described by Fons Adriaensen in "Using a DLL to filter time"
+    const double omega = 2.0 * double_Pi * bandwidth * blockLength * 0.001;
+    windowStart  = windowEnd;
+    windowEnd    = nextStart;
+    nextStart   += std::sqrt (2.0) * omega * error + blockLength;
+    samplePeriod = jlimit (nominal * 0.9, nominal * 1.1,
+                           samplePeriod + omega * omega * error / numSamples);
+}
+
+int MidiInputClock::getSampleOffset (const double time, const int numSamples) const noexcept
+{
+    const double length = windowEnd - windowStart;
+    if (numSamples <= 1 || length <= 0.0)
+        return 0;
+    const double offset = (time - windowStart) * numSamples / length;
+    return (int) jlimit (0.0, (double) (numSamples - 1), offset);
+}
+
+MidiInputClock MidiInputClock::getPart (const int start, const int numSamples, const int blockSize) const noexcept
+{
+    MidiInputClock part (*this);
+    if (blockSize <= 0)
+        return part;
+    const double length = windowEnd - windowStart;
+    part.windowStart = windowStart + length * start / blockSize;
+    part.windowEnd   = windowStart + length * (start + numSamples) / blockSize;
+    return part;
+}
+
+//==============================================================================
+MidiInputQueue::MidiInputQueue (const int maxEvents, const int maxSysexBytes)
+    : events (jmax (2, maxEvents + 1)),
+      sysex (jmax (2, maxSysexBytes + 1))
+{
+    eventData.calloc ((size_t) events.getTotalSize());
+    sysexData.calloc ((size_t) sysex.getTotalSize());
+    sysexScratch.calloc ((size_t) sysex.getTotalSize());
+}
+
+bool MidiInputQueue::push (const MidiMessage& message)
+{
+    const double now = Time::getMillisecondCounterHiRes();
+    double time = message.getTimeStamp() * 1000.0;
+
+    // some senders leave the timestamp at zero or put milliseconds in it
+    if (std::abs (time - now) > 1000.0)
+        time = now;
+
+    return push (message.getRawData(), message.getRawDataSize(), time);
+}
+
+bool MidiInputQueue::push (const uint8* data, const int numBytes, const double time)
+{
+    if (numBytes <= 0)
+        return false;
+
+    const bool isLong = numBytes > maxInlineBytes;
+    if (events.getFreeSpace() < 1 || (isLong && sysex.getFreeSpace() < numBytes))
+    {
+        FixedMidiBuffer::countDroppedEvent();
+        return false;
+    }
+
+    int start1, size1, start2, size2;
+
+    // the bytes must be in place before the event which refers to them
+    if (isLong)
+    {
+        sysex.prepareToWrite (numBytes, start1, size1, start2, size2);
+        memcpy (sysexData + start1, data, (size_t) size1);
+        if (size2 > 0)
+            memcpy (sysexData + start2, data + size1, (size_t) size2);
+        sysex.finishedWrite (size1 + size2);
+    }
+
+    events.prepareToWrite (1, start1, size1, start2, size2);
+    auto& event = eventData [size1 > 0 ? start1 : start2];
+    event.time = time;
+    event.numBytes = numBytes;
+    if (! isLong)
+        memcpy (event.data, data, (size_t) numBytes);
+    events.finishedWrite (1);
+    return true;
+}
+
+void MidiInputQueue::readSysex (uint8* dest, const int numBytes) noexcept
+{
+    int start1, size1, start2, size2;
+    sysex.prepareToRead (numBytes, start1, size1, start2, size2);
+    if (dest != nullptr)
+    {
+        memcpy (dest, sysexData + start1, (size_t) size1);
+        if (size2 > 0)
+            memcpy (dest + size1, sysexData + start2, (size_t) size2);
+    }
+    sysex.finishedRead (size1 + size2);
+}
+
+void MidiInputQueue::pull (MidiBuffer& midi, const MidiInputClock& clock, const int numSamples) noexcept
+{
+    const double windowEnd = clock.getWindowEnd();
+
+    for (;;)
+    {
+        int start1, size1, start2, size2;
+        events.prepareToRead (1, start1, size1, start2, size2);
+        if (size1 + size2 <= 0)
+            break;
+
+        const auto& event = eventData [size1 > 0 ? start1 : start2];
+
+        // arrived during this block, so it belongs to the next one
+        if (event.time >= windowEnd)
+            break;
+
+        const int frame = clock.getSampleOffset (event.time, numSamples);
+        if (event.numBytes > maxInlineBytes)
+        {
+            readSysex (sysexScratch, event.numBytes);
+            FixedMidiBuffer::addEvent (midi, sysexScratch, event.numBytes, frame);
+        }
+        else
+        {
+            FixedMidiBuffer::addEvent (midi, event.data, event.numBytes, frame);
+        }
+
+        events.finishedRead (1);
+    }
+}
+
+void MidiInputQueue::clear() noexcept
+{
+    for (;;)
+    {
+        int start1, size1, start2, size2;
+        events.prepareToRead (1, start1, size1, start2, size2);
+        if (size1 + size2 <= 0)
+            break;
+
+        const auto& event = eventData [size1 > 0 ? start1 : start2];
+        if (event.numBytes > maxInlineBytes)
+            readSysex (nullptr, event.numBytes);
+        events.finishedRead (1);
+    }
+}
+
+//==============================================================================
+MidiInputQueueSet::MidiInputQueueSet (const int maxDevices)
+{
+    for (int i = 0; i < maxDevices; ++i)
+        devices.add (new Device());
+}
+
+MidiInputQueue* MidiInputQueueSet::getQueueFor (MidiInput* const source, const String& deviceName) noexcept
+{
+    if (source == nullptr)
+        return nullptr;
+
+    for (auto* const device : devices)
+        if (device->source.get() == source)
+            return &device->queue;
+
+    // a device opened again, which can't be delivering through its old input.
+    // Slots being claimed hold this set as their source until they are named
+    auto* const claiming = reinterpret_cast<MidiInput*> (this);
+    for (auto* const device : devices)
+    {
+        auto* const previous = device->source.get();
+        if (previous != nullptr && previous != claiming && device->name == deviceName
+             && device->source.compareAndSetBool (source, previous))
+            return &device->queue;
+    }
+
+    // claims a free slot, naming it before anyone else can compare the name
+    for (auto* const device : devices)
+    {
+        if (device->source.get() == nullptr && device->source.compareAndSetBool (claiming, nullptr))
+        {
+            device->name = deviceName;
+            device->source = source;
+            return &device->queue;
+        }
+    }
+
+    return nullptr;
+}
+
+bool MidiInputQueueSet::push (MidiInput* const source, const MidiMessage& message)
+{
+    return push (source, source != nullptr ? source->getName() : String(), message);
+}
+
+bool MidiInputQueueSet::push (MidiInput* const source, const String& deviceName, const MidiMessage& message)
+{
+    if (auto* const queue = getQueueFor (source, deviceName))
+        return queue->push (message);
+
+    const SpinLock::ScopedLockType sl (sharedLock);
+    return shared.push (message);
+}
+
+void MidiInputQueueSet::pull (MidiBuffer& midi, const MidiInputClock& clock, const int numSamples) noexcept
+{
+    for (auto* const device : devices)
+        if (device->source.get() != nullptr)
+            device->queue.pull (midi, clock, numSamples);
+    shared.pull (midi, clock, numSamples);
+}
+
+int MidiInputQueueSet::getNumDevices() const noexcept
+{
+    int numDevices = 0;
+    for (const auto* const device : devices)
+        if (device->source.get() != nullptr)
+            ++numDevices;
+    return numDevices;
+}
+
+void MidiInputQueueSet::clear() noexcept
+{
+    for (auto* const device : devices)
+        device->queue.clear();
+    shared.clear();
+}
+
+}
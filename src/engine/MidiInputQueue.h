@@ -0,0 +1,173 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Estimates when each audio callback started from the sample clock.
+
+    The wall clock time of a callback jitters with the device and the
+    scheduler, so it's smoothed with a delay locked loop which follows the
+    rate samples are actually consumed at. MIDI which arrived between the
+    previous callback and this one is placed in this block in proportion to
+    when it arrived, which delays every event by one block instead of moving
+    all of them to the first sample.
+
+    Times are in milliseconds as given by Time::getMillisecondCounterHiRes().
+ */
+class MidiInputClock
+{
+public:
+    MidiInputClock() { }
+
+    /** Starts over at a new sample rate. Call while the audio isn't running */
+    void reset (double newSampleRate) noexcept;
+
+    /** Call on the audio thread at the start of each block, before taking
+        MIDI out of a queue. If a block takes much longer than expected,
+        e.g. after an xrun, the estimate starts over from timeNow */
+    void update (double timeNow, int numSamples) noexcept;
+
+    /** Smoothed time the previous block started */
+    double getWindowStart() const noexcept  { return windowStart; }
+
+    /** Smoothed time the current block started */
+    double getWindowEnd() const noexcept    { return windowEnd; }
+
+    /** Returns the sample in a block of numSamples for something which happened
+        at time. Anything before the window goes at the start of the block and
+        anything after it at the end */
+    int getSampleOffset (double time, int numSamples) const noexcept;
+
+    /** Returns a copy whose window covers numSamples from start in a block of
+        blockSize, for a block which is rendered in pieces */
+    MidiInputClock getPart (int start, int numSamples, int blockSize) const noexcept;
+
+private:
+    double sampleRate = 44100.0;
+    double samplePeriod = 0.0;      // smoothed, ms per sample
+    double windowStart = 0.0;
+    double windowEnd = 0.0;
+    double nextStart = 0.0;         // predicted start of the next block
+    bool running = false;
+};
+
+/** A lock-free queue of timestamped MIDI from one producer to the audio thread.
+
+    One thread may push() while the audio thread pulls events out as they
+    come due. Short messages are stored inline and longer ones like sysex go
+    into a separate byte ring, so neither side allocates or locks. Messages
+    which don't fit are dropped and counted with FixedMidiBuffer.
+ */
+class MidiInputQueue
+{
+public:
+    explicit MidiInputQueue (int maxEvents = 1024, int maxSysexBytes = 4096);
+
+    /** Queues a message with the time it arrived. MidiMessage timestamps are in
+        seconds and messages without a plausible one are stamped with the
+        current time. Producer thread only */
+    bool push (const MidiMessage& message);
+
+    /** Queues raw MIDI with a time in milliseconds. Producer thread only */
+    bool push (const uint8* data, int numBytes, double time);
+
+    /** Adds every event which arrived before the clock's window ended to midi
+        at its sample offset. Events after the window stay in the queue for
+        the next block. Audio thread only */
+    void pull (MidiBuffer& midi, const MidiInputClock& clock, int numSamples) noexcept;
+
+    /** Throws away everything queued. Consumer thread only */
+    void clear() noexcept;
+
+    /** Number of events waiting */
+    int getNumReady() const noexcept { return events.getNumReady(); }
+
+private:
+    enum { maxInlineBytes = 4 };
+    struct Event
+    {
+        double time;
+        int numBytes;
+        uint8 data [maxInlineBytes];
+    };
+
+    AbstractFifo events, sysex;
+    HeapBlock<Event> eventData;
+    HeapBlock<uint8> sysexData, sysexScratch;
+
+    void readSysex (uint8* dest, int numBytes) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiInputQueue)
+};
+
+/** Keeps a MidiInputQueue for each MIDI input device.
+
+    Devices are given a queue of their own the first time they deliver a
+    message, so each queue keeps a single producer. Queues are kept by device
+    name, so a device which is closed and opened again gets its old queue
+    back. MidiEngine never has two inputs with the same name open.
+
+    MIDI without a device, such as from the on screen keyboard or scripts,
+    and devices beyond maxDevices share one more queue whose producers take
+    a spin lock. The audio thread never locks.
+ */
+class MidiInputQueueSet
+{
+public:
+    explicit MidiInputQueueSet (int maxDevices = 16);
+
+    /** Queues a message from a device, or from nothing in particular if
+        source is nullptr */
+    bool push (MidiInput* source, const MidiMessage& message);
+
+    /** Queues a message from a device with the given name. The source is
+        only compared, never used */
+    bool push (MidiInput* source, const String& deviceName, const MidiMessage& message);
+
+    /** Number of devices with a queue of their own */
+    int getNumDevices() const noexcept;
+
+    /** Pulls from every queue into midi. Audio thread only */
+    void pull (MidiBuffer& midi, const MidiInputClock& clock, int numSamples) noexcept;
+
+    /** Throws away everything queued. Consumer thread only */
+    void clear() noexcept;
+
+private:
+    struct Device
+    {
+        Atomic<MidiInput*> source { nullptr };
+        String name;    // set before source is, and never changed after
+        MidiInputQueue queue;
+    };
+
+    OwnedArray<Device> devices;
+    MidiInputQueue shared;
+    SpinLock sharedLock;
+
+    MidiInputQueue* getQueueFor (MidiInput* source, const String& deviceName) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiInputQueueSet)
+};
+
+}
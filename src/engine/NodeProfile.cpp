@@ -0,0 +1,125 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "engine/NodeProfile.h"
+
+namespace Element {
+
+Atomic<int> NodeProfile::enabled { 0 };
+
+void NodeProfile::setEnabled (const bool shouldBeEnabled)
+{
+    enabled.set (shouldBeEnabled ? 1 : 0);
+}
+
+int NodeProfile::getBucket (int64 nanos) noexcept
+{
+    // below 4ns each nanosecond has a bucket, above that each octave has four
+    if (nanos < 4)
+        return (int) jmax ((int64) 0, nanos);
+
+    nanos = jmin (nanos, (int64) 0xffffffff);
+    int octave = 0;
+    for (int64 n = nanos; n > 1; n >>= 1)
+        ++octave;
+
+    const int sub = (int) ((nanos >> (octave - 2)) & 3);
+    return jmin ((int) numBuckets - 1, (octave - 1) * 4 + sub);
+}
+
+int64 NodeProfile::getBucketStart (const int bucket) noexcept
+{
+    if (bucket < 4)
+        return bucket;
+    return (int64) (4 + (bucket & 3)) << (bucket / 4 - 1);
+}
+
+void NodeProfile::clear() noexcept
+{
+    for (auto& bucket : buckets)
+        bucket = 0;
+    numBlocks = totalNanos = budgetNanos = maxNanos = 0;
+}
+
+void NodeProfile::reset() noexcept
+{
+    resetPending = 1;
+}
+
+void NodeProfile::stopTimer (const int64 startTicks, const int numSamples, const double sampleRate) noexcept
+{
+    if (startTicks == 0)
+        return;
+
+    static const double nanosPerTick = 1000000000.0 / (double) Time::getHighResolutionTicksPerSecond();
+    const int64 nanos = (int64) ((double) (Time::getHighResolutionTicks() - startTicks) * nanosPerTick);
+
+    if (resetPending.compareAndSetBool (0, 1))
+        clear();
+
+    ++buckets [getBucket (nanos)];
+    ++numBlocks;
+    totalNanos += nanos;
+    if (sampleRate > 0.0)
+        budgetNanos += (int64) (1000000000.0 * numSamples / sampleRate);
+
+    for (int64 slowest = maxNanos.get(); nanos > slowest; slowest = maxNanos.get())
+        if (maxNanos.compareAndSetBool (nanos, slowest))
+            break;
+}
+
+NodeProfile::Stats NodeProfile::getStats() const
+{
+    Stats stats;
+    if (resetPending.get() != 0)
+        return stats;
+
+    int counts [numBuckets];
+    int64 total = 0;
+    for (int i = 0; i < numBuckets; ++i)
+        total += (counts[i] = buckets[i].get());
+
+    stats.numBlocks = numBlocks.get();
+    if (stats.numBlocks <= 0 || total <= 0)
+        return stats;
+
+    stats.meanMicros = 0.001 * (double) totalNanos.get() / (double) stats.numBlocks;
+    stats.maxMicros  = 0.001 * (double) maxNanos.get();
+
+    // report the end of the bucket holding the 99th percentile
+    const int64 target = total - total / 100;
+    int64 seen = 0;
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        seen += counts[i];
+        if (seen >= target)
+        {
+            const double end = i + 1 < numBuckets ? (double) getBucketStart (i + 1) : (double) maxNanos.get();
+            stats.p99Micros = jmin (stats.maxMicros, 0.001 * end);
+            break;
+        }
+    }
+
+    const int64 budget = budgetNanos.get();
+    if (budget > 0)
+        stats.load = 100.0 * (double) totalNanos.get() / (double) budget;
+
+    return stats;
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Collects how long a node takes to render each block.
+
+    Timings are kept in a lock-free log2 histogram (four buckets per octave of
+    nanoseconds). Every update is atomic, so a node may be rendered by
+    different worker threads from block to block while any other thread
+    reads it. Profiling is switched on and off for the whole application;
+    when it's off the render path only reads one atomic flag.
+ */
+class NodeProfile
+{
+public:
+    struct Stats
+    {
+        int64 numBlocks = 0;
+        double meanMicros = 0.0;    ///< average time per block
+        double p99Micros = 0.0;     ///< 99th percentile, to the histogram's resolution
+        double maxMicros = 0.0;     ///< slowest block
+        double load = 0.0;          ///< percentage of the block budget used on average
+    };
+
+    NodeProfile() { }
+
+    /** Enable or disable profiling of every node */
+    static void setEnabled (const bool shouldBeEnabled);
+
+    /** Returns true if nodes should be profiled */
+    static bool isEnabled() noexcept { return enabled.get() != 0; }
+
+    /** Returns the current high resolution tick count if profiling, else zero */
+    static int64 startTimer() noexcept
+    {
+        return isEnabled() ? Time::getHighResolutionTicks() : 0;
+    }
+
+    /** Records a block which started at 'startTicks' (from startTimer) and has
+        just finished. Does nothing if startTicks is zero. Realtime safe */
+    void stopTimer (const int64 startTicks, const int numSamples, const double sampleRate) noexcept;
+
+    /** Clears the collected timings. The render thread does the actual
+        clearing the next time it records a block */
+    void reset() noexcept;
+
+    /** Summarises the timings collected so far */
+    Stats getStats() const;
+
+private:
+    enum { numBuckets = 128 };
+    static Atomic<int> enabled;
+
+    Atomic<int> buckets [numBuckets];
+    Atomic<int64> numBlocks, totalNanos, budgetNanos, maxNanos;
+    Atomic<int> resetPending { 0 };
+
+    static int getBucket (int64 nanos) noexcept;
+    static int64 getBucketStart (int bucket) noexcept;
+    void clear() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (NodeProfile)
+};
+
+}
@@ -0,0 +1,249 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AudioEngine.h"
+#include "engine/OfflineRenderer.h"
+
+namespace Element {
+
+static Result loadMidiFile (const File& file, MidiMessageSequence& sequence)
+{
+    FileInputStream stream (file);
+    MidiFile midiFile;
+    if (! stream.openedOk() || ! midiFile.readFrom (stream))
+        return Result::fail ("Could not read MIDI file " + file.getFullPathName());
+
+    midiFile.convertTimestampTicksToSeconds();
+    for (int i = 0; i < midiFile.getNumTracks(); ++i)
+        sequence.addSequence (*midiFile.getTrack (i), 0.0);
+
+    // tempo changes, track names and the like aren't meant for the graphs
+    for (int i = sequence.getNumEvents(); --i >= 0;)
+        if (sequence.getEventPointer (i)->message.isMetaEvent())
+            sequence.deleteEvent (i, false);
+
+    return Result::ok();
+}
+
+static AudioFormat* createFormatFor (const File& file)
+{
+    if (file.hasFileExtension ("wav"))
+        return new WavAudioFormat();
+   #if JUCE_USE_FLAC
+    if (file.hasFileExtension ("flac"))
+        return new FlacAudioFormat();
+   #endif
+    return nullptr;
+}
+
+OfflineRenderer::OfflineRenderer (AudioEngine& e)
+    : engine (e) { }
+
+OfflineRenderer::~OfflineRenderer() { }
+
+Result OfflineRenderer::render (const Options& options)
+{
+    stats = Stats();
+    stats.sampleRate = options.sampleRate;
+
+    if (options.sampleRate <= 0.0 || options.blockSize <= 0 || options.numChannels <= 0)
+        return Result::fail ("Invalid sample rate, block size or channel count");
+    if (options.outputFile == File())
+        return Result::fail ("No output file given");
+
+    MidiMessageSequence midi;
+    if (options.midiFile != File())
+    {
+        const auto result = loadMidiFile (options.midiFile, midi);
+        if (result.failed())
+            return result;
+    }
+
+    double lengthSeconds = options.lengthSeconds;
+    if (lengthSeconds <= 0.0)
+    {
+        if (options.midiFile == File())
+            return Result::fail ("A render length is needed without a MIDI file");
+        lengthSeconds = midi.getEndTime() + jmax (0.0, options.tailSeconds);
+    }
+
+    const int64 numSamples = (int64) std::ceil (lengthSeconds * options.sampleRate);
+    const int previousGraph = engine.getActiveGraph();
+
+    engine.prepareExternalPlayback (options.sampleRate, options.blockSize,
+                                    options.numChannels, options.numChannels);
+
+    Result result = Result::ok();
+    if (options.allGraphs)
+    {
+        for (int i = 0; result.wasOk(); ++i)
+        {
+            auto* const graph = engine.getGraph (i);
+            if (graph == nullptr)
+                break;
+            result = renderGraph (i, getFileForGraph (options.outputFile, i, graph->getName()),
+                                  options, midi, numSamples);
+        }
+    }
+    else
+    {
+        result = renderGraph (options.graphIndex, options.outputFile, options, midi, numSamples);
+    }
+
+    engine.releaseExternalResources();
+    if (previousGraph >= 0)
+        engine.setActiveGraph (previousGraph);
+    return result;
+}
+
+Result OfflineRenderer::renderGraph (const int graphIndex, const File& file, const Options& options,
+                                     const MidiMessageSequence& midi, const int64 numSamples)
+{
+    if (graphIndex >= 0)
+    {
+        if (engine.getGraph (graphIndex) == nullptr)
+            return Result::fail ("There is no graph " + String (graphIndex));
+        engine.setActiveGraph (graphIndex);
+    }
+
+    std::unique_ptr<AudioFormat> format (createFormatFor (file));
+    if (format == nullptr)
+        return Result::fail ("Unsupported output format " + file.getFileExtension());
+
+    file.deleteFile();
+    std::unique_ptr<FileOutputStream> stream (file.createOutputStream());
+    if (stream == nullptr || stream->failedToOpen())
+        return Result::fail ("Could not write to " + file.getFullPathName());
+
+    std::unique_ptr<AudioFormatWriter> writer (format->createWriterFor (stream.get(), options.sampleRate,
+                                                                        (unsigned int) options.numChannels,
+                                                                        options.bitDepth, {}, 0));
+    if (writer == nullptr)
+        return Result::fail ("Can't write " + String (options.bitDepth) + " bit "
+                             + format->getFormatName() + " files");
+    stream.release(); // owned by the writer now
+
+    // the writer thread is stopped after the threaded writer has flushed
+    TimeSliceThread writerThread ("ElementRenderWriter");
+    writerThread.startThread();
+    AudioFormatWriter::ThreadedWriter threaded (writer.release(), writerThread,
+                                                jmax (options.blockSize * 4, roundToInt (options.sampleRate * 4.0)));
+
+    engine.seekToAudioFrame (0);
+    engine.setPlaying (true);
+
+    AudioSampleBuffer buffer (options.numChannels, options.blockSize);
+    MidiBuffer events;
+    int nextEvent = 0;
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    for (int64 position = 0; position < numSamples;)
+    {
+        const int numThisTime = (int) jmin ((int64) options.blockSize, numSamples - position);
+        buffer.setSize (options.numChannels, numThisTime, false, false, true);
+        buffer.clear();
+
+        events.clear();
+        for (; nextEvent < midi.getNumEvents(); ++nextEvent)
+        {
+            const auto& message = midi.getEventPointer (nextEvent)->message;
+            const int64 frame = (int64) std::floor (message.getTimeStamp() * options.sampleRate);
+            if (frame >= position + numThisTime)
+                break;
+            events.addEvent (message, (int) jmax ((int64) 0, frame - position));
+        }
+
+        engine.processExternalBuffers (buffer, events);
+
+        // the render is faster than the disk, let the writer catch up
+        while (! threaded.write (buffer.getArrayOfReadPointers(), numThisTime))
+            Thread::sleep (1);
+
+        position += numThisTime;
+    }
+
+    stats.renderSeconds += (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    stats.numSamples += numSamples;
+    engine.setPlaying (false);
+    return Result::ok();
+}
+
+File OfflineRenderer::getFileForGraph (const File& outputFile, const int graphIndex, const String& graphName)
+{
+    String name = outputFile.getFileNameWithoutExtension();
+    name << " - " << (graphIndex + 1);
+    if (graphName.isNotEmpty())
+        name << " " << graphName;
+    return outputFile.getSiblingFile (File::createLegalFileName (name) + outputFile.getFileExtension());
+}
+
+Result OfflineRenderer::parseCommandLine (const String& commandLine, File& sourceFile, Options& options)
+{
+    StringArray args;
+    args.addTokens (commandLine, true);
+    args.trim();
+    args.removeEmptyStrings();
+
+    const File cwd (File::getCurrentWorkingDirectory());
+    sourceFile = File();
+
+    for (const auto& arg : args)
+    {
+        const String name  = arg.upToFirstOccurrenceOf ("=", false, false);
+        const String value = arg.fromFirstOccurrenceOf ("=", false, false).unquoted();
+
+        if (name == "--render")
+            continue;
+        else if (name == "--output")
+            options.outputFile = cwd.getChildFile (value);
+        else if (name == "--midi")
+            options.midiFile = cwd.getChildFile (value);
+        else if (name == "--length")
+            options.lengthSeconds = value.getDoubleValue();
+        else if (name == "--tail")
+            options.tailSeconds = value.getDoubleValue();
+        else if (name == "--rate")
+            options.sampleRate = value.getDoubleValue();
+        else if (name == "--block")
+            options.blockSize = value.getIntValue();
+        else if (name == "--channels")
+            options.numChannels = value.getIntValue();
+        else if (name == "--bits")
+            options.bitDepth = value.getIntValue();
+        else if (name == "--graph")
+            options.graphIndex = value.getIntValue();
+        else if (name == "--all-graphs")
+            options.allGraphs = true;
+        else if (! arg.startsWith ("-") && sourceFile == File())
+            sourceFile = cwd.getChildFile (arg.unquoted());
+        else
+            return Result::fail ("Unknown render option " + arg);
+    }
+
+    if (! sourceFile.existsAsFile())
+        return Result::fail ("Nothing to render, pass a session (.els) or graph (.elg) file");
+    if (options.outputFile == File())
+        return Result::fail ("No output file, use --output=<file>");
+    if (options.midiFile != File() && ! options.midiFile.existsAsFile())
+        return Result::fail ("MIDI file not found: " + options.midiFile.getFullPathName());
+
+    return Result::ok();
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class AudioEngine;
+
+/** Renders an AudioEngine to an audio file as fast as the CPU allows.
+
+    The transport rolls from the start, MIDI can be played in from a standard
+    MIDI file, and the output is streamed to WAV or FLAC by a background writer
+    thread. Nothing depends on the wall clock, so the same input always gives
+    the same file. The engine must not be running on an audio device while
+    rendering.
+ */
+class OfflineRenderer
+{
+public:
+    struct Options
+    {
+        File outputFile;            ///< .wav or .flac
+        File midiFile;              ///< optional, fed to the engine's MIDI input
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        int bitDepth = 24;
+        double lengthSeconds = 0.0; ///< 0 renders the MIDI file plus the tail
+        double tailSeconds = 2.0;
+        int graphIndex = -1;        ///< root graph to render, -1 for the active one
+        bool allGraphs = false;     ///< render each root graph to its own file
+    };
+
+    struct Stats
+    {
+        int64 numSamples = 0;       ///< samples rendered per channel, all graphs
+        double renderSeconds = 0.0; ///< time spent rendering
+        double sampleRate = 0.0;
+
+        /** How many times faster than realtime the render ran */
+        double getRealtimeFactor() const noexcept
+        {
+            return renderSeconds > 0.0 ? (double) numSamples / sampleRate / renderSeconds : 0.0;
+        }
+    };
+
+    explicit OfflineRenderer (AudioEngine& engine);
+    ~OfflineRenderer();
+
+    /** Renders with the given options. Call from the message thread */
+    Result render (const Options& options);
+
+    /** Timings of the last render */
+    const Stats& getStats() const noexcept { return stats; }
+
+    /** Reads the options of `element --render <file> [options]`, returning the
+        session or graph file to load in sourceFile.
+
+        --output=<file>     .wav or .flac to write (required)
+        --midi=<file>       MIDI file to play in
+        --length=<seconds>  defaults to the MIDI file's length plus the tail
+        --tail=<seconds>    added after the MIDI file, default 2
+        --rate=<hz>         sample rate, default 44100
+        --block=<samples>   block size, default 512
+        --channels=<count>  output channels, default 2
+        --bits=<depth>      bit depth, default 24
+        --graph=<index>     root graph to render, default the active graph
+        --all-graphs        render every root graph to its own file
+     */
+    static Result parseCommandLine (const String& commandLine, File& sourceFile, Options& options);
+
+    /** The file a graph is written to when rendering all graphs */
+    static File getFileForGraph (const File& outputFile, int graphIndex, const String& graphName);
+
+private:
+    AudioEngine& engine;
+    Stats stats;
+
+    Result renderGraph (int graphIndex, const File& file, const Options& options,
+                        const MidiMessageSequence& midi, int64 numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
+
+}
@@ -0,0 +1,196 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AllocationCounter.h"
+#include "engine/RenderPool.h"
+
+#if JUCE_LINUX
+ #include <pthread.h>
+ #include <sched.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+ #include <mach/mach_time.h>
+ #include <mach/thread_policy.h>
+ #include <pthread.h>
+#endif
+
+namespace Element {
+
+/** Gives the calling thread realtime scheduling, which JUCE's thread
+    priorities don't on every platform. Returns false if not permitted */
+static bool setRealtimePriority()
+{
+   #if JUCE_LINUX
+    // just below where audio servers and drivers usually put their threads
+    sched_param param;
+    param.sched_priority = jmax (sched_get_priority_min (SCHED_FIFO),
+                                 sched_get_priority_max (SCHED_FIFO) - 10);
+    return pthread_setschedparam (pthread_self(), SCHED_FIFO, &param) == 0;
+   #elif JUCE_MAC
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info (&timebase);
+    const double ticksPerMillisecond = 1.0e6 * timebase.denom / timebase.numer;
+
+    thread_time_constraint_policy_data_t policy;
+    policy.period       = 0;
+    policy.computation  = (uint32_t) (1.0 * ticksPerMillisecond);
+    policy.constraint   = (uint32_t) (5.0 * ticksPerMillisecond);
+    policy.preemptible  = true;
+    return thread_policy_set (pthread_mach_thread_np (pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+                              (thread_policy_t) &policy, THREAD_TIME_CONSTRAINT_POLICY_COUNT) == KERN_SUCCESS;
+   #elif JUCE_WINDOWS
+    // priority 10 is already THREAD_PRIORITY_TIME_CRITICAL
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+class RenderPool::Worker : public Thread
+{
+public:
+    Worker (RenderPool& p, const int index)
+        : Thread ("ElementRender" + String (index + 1)),
+          pool (p)
+    {
+        const int numCpus = jmax (1, SystemStats::getNumCpus());
+        setAffinityMask ((uint32) 1 << ((index + 1) % jmin (32, numCpus)));
+    }
+
+    ~Worker()
+    {
+        stopThread (1000);
+    }
+
+    void run() override
+    {
+        if (setRealtimePriority())
+            ++pool.numRealtime;
+        else
+            DBG("[EL] render worker couldn't get realtime scheduling");
+
+        while (! threadShouldExit())
+        {
+            pool.wakeup.wait();
+            if (threadShouldExit())
+                break;
+            const AllocationCounter::ScopedRender rendering;
+            pool.performJobIfAvailable (*this);
+        }
+    }
+
+    /** The epoch this worker entered performJobIfAvailable in, zero when outside */
+    Atomic<int64> entered { 0 };
+
+private:
+    RenderPool& pool;
+};
+
+RenderPool::RenderPool()
+    : wakeup (jmax (1, SystemStats::getNumCpus())) { }
+
+RenderPool::~RenderPool()
+{
+    stop();
+}
+
+void RenderPool::start()
+{
+    if (workers.size() > 0)
+        return;
+
+    const int numWorkers = jmax (0, SystemStats::getNumCpus() - 1);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* const worker = workers.add (new Worker (*this, i));
+        worker->startThread (10);
+    }
+}
+
+void RenderPool::stop()
+{
+    jassert (currentJob.get() == nullptr);
+    for (auto* const worker : workers)
+        worker->signalThreadShouldExit();
+    if (workers.size() > 0)
+        wakeup.signal (workers.size());
+    workers.clear (true);
+    numRealtime = 0;
+}
+
+bool RenderPool::isRealtime() const noexcept
+{
+    return workers.size() > 0 && numRealtime.get() >= workers.size();
+}
+
+void RenderPool::performJobIfAvailable (Worker& worker)
+{
+    // the epoch must be published before the job is read, see isReleased()
+    worker.entered = epoch.get();
+
+    if (auto* const job = currentJob.get())
+        while (! job->isFinished())
+            if (! job->performNextTask())
+                Thread::yield();
+
+    worker.entered = 0;
+}
+
+void RenderPool::run (Job& job)
+{
+    ++epoch;
+
+    if (workers.size() <= 0 || ! currentJob.compareAndSetBool (&job, nullptr))
+    {
+        while (! job.isFinished())
+            job.performNextTask();
+        return;
+    }
+
+    wakeup.signal (workers.size());
+
+    // take whatever the workers haven't. The only waiting left is for tasks
+    // a worker is in the middle of, or which depend on one
+    while (! job.isFinished())
+        job.performNextTask();
+
+    currentJob = nullptr;
+}
+
+bool RenderPool::isReleased (const int64 mark) const noexcept
+{
+    // a worker holding a job read the epoch before it read the job, so it
+    // shows an epoch no later than the job's last run
+    for (auto* const worker : workers)
+    {
+        const int64 entered = worker->entered.get();
+        if (entered != 0 && entered <= mark)
+            return false;
+    }
+
+    return true;
+}
+
+void RenderPool::waitForRelease (const int64 mark) const
+{
+    while (! isReleased (mark))
+        Thread::sleep (1);
+}
+
+}
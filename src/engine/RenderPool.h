@@ -0,0 +1,141 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/Semaphore.h"
+
+namespace Element {
+
+/** A pool of pre-spawned, realtime priority threads which help the audio
+    thread render independent parts of a graph.
+
+    Use a SharedResourcePointer<RenderPool> to access it. Worker threads are
+    only created once start() has been called from a non-realtime thread.
+
+    The audio thread never waits on a worker which hasn't picked up a task:
+    workers are woken without locking, the caller takes every task nobody
+    else has claimed, and run() returns as soon as the job is finished even
+    if a worker woke too late to help. A late worker may still hold the job
+    afterwards, so jobs must survive being looked at by one and anything
+    which deletes a job must wait for isReleased().
+ */
+class RenderPool
+{
+public:
+    /** A unit of parallel work.  The caller of RenderPool::run and all
+        workers call performNextTask() until isFinished() returns true.
+        Workers from an earlier run can call either at any time, so tasks
+        should be claimed through a TaskCounter or something like it */
+    class Job
+    {
+    public:
+        virtual ~Job() { }
+
+        /** Perform one task if one is ready.  Returns false if nothing
+            could be done at this time. This is called concurrently */
+        virtual bool performNextTask() = 0;
+
+        /** Returns true when every task in this job has been performed */
+        virtual bool isFinished() const = 0;
+    };
+
+    /** Hands out the task indexes of a job for one block. Each reset starts
+        a new generation and claims made by a late worker against an older
+        one fail, so a job can be reused block after block */
+    class TaskCounter
+    {
+    public:
+        /** Starts a new block of numTasks. Write everything the tasks read
+            before calling this */
+        void reset (const int numTasks) noexcept
+        {
+            jassert (isPositiveAndBelow (numTasks, (int) maxTasks));
+            const int64 generation = (state.get() >> (2 * indexBits)) + 1;
+            state = (generation << (2 * indexBits)) | ((int64) numTasks << indexBits);
+        }
+
+        /** Returns the index of the next unclaimed task, or -1 if there isn't one */
+        int claim() noexcept
+        {
+            for (;;)
+            {
+                const int64 current = state.get();
+                const int index = (int) (current & indexMask);
+                if (index >= (int) ((current >> indexBits) & indexMask))
+                    return -1;
+                if (state.compareAndSetBool (current + 1, current))
+                    return index;
+            }
+        }
+
+    private:
+        enum { indexBits = 20, maxTasks = 1 << indexBits, indexMask = maxTasks - 1 };
+        Atomic<int64> state { 0 };
+    };
+
+    RenderPool();
+    ~RenderPool();
+
+    /** Creates and starts the worker threads if not done already.
+        Don't call this from the audio thread */
+    void start();
+
+    /** Stops and deletes all worker threads */
+    void stop();
+
+    /** Returns the number of workers available, not counting the caller of run() */
+    int getNumWorkers() const { return workers.size(); }
+
+    /** True if every worker got realtime scheduling. Until then, handing a
+        worker a task can leave the audio thread waiting on a thread with a
+        lower priority than its own */
+    bool isRealtime() const noexcept;
+
+    /** Performs a job with the help of the worker threads and returns when it is
+        complete.  If the pool is busy with another job (e.g. a nested graph) or
+        has no workers, the job is run entirely on the calling thread. */
+    void run (Job& job);
+
+    /** Returns a mark to check with isReleased(). Take it once a job will
+        never be passed to run() again */
+    int64 getEpoch() const noexcept { return epoch.get(); }
+
+    /** True once no worker can still hold a job which was last run before
+        epoch was taken, after which the job can be deleted */
+    bool isReleased (int64 epoch) const noexcept;
+
+    /** Sleeps until isReleased() is true. Not for the audio thread */
+    void waitForRelease (int64 epoch) const;
+
+private:
+    class Worker;
+    OwnedArray<Worker> workers;
+    Semaphore wakeup;
+    Atomic<Job*> currentJob { nullptr };
+    Atomic<int64> epoch { 1 };
+    Atomic<int> numRealtime { 0 };
+
+    void performJobIfAvailable (Worker&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderPool)
+};
+
+}
@@ -0,0 +1,96 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/Semaphore.h"
+
+#if JUCE_LINUX
+ #include <semaphore.h>
+ #include <errno.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+ #include <mach/semaphore.h>
+ #include <mach/task.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#endif
+
+namespace Element {
+
+#if JUCE_LINUX
+struct Semaphore::Native
+{
+    Native()                    { sem_init (&sem, 0, 0); }
+    ~Native()                   { sem_destroy (&sem); }
+    void post (int n) noexcept  { while (--n >= 0) sem_post (&sem); }
+    void wait() noexcept        { while (sem_wait (&sem) != 0 && errno == EINTR) { } }
+    sem_t sem;
+};
+#elif JUCE_MAC
+struct Semaphore::Native
+{
+    Native()                    { semaphore_create (mach_task_self(), &sem, SYNC_POLICY_FIFO, 0); }
+    ~Native()                   { semaphore_destroy (mach_task_self(), sem); }
+    void post (int n) noexcept  { while (--n >= 0) semaphore_signal (sem); }
+    void wait() noexcept        { while (semaphore_wait (sem) == KERN_ABORTED) { } }
+    semaphore_t sem;
+};
+#elif JUCE_WINDOWS
+struct Semaphore::Native
+{
+    Native()                    { sem = CreateSemaphore (nullptr, 0, MAXLONG, nullptr); }
+    ~Native()                   { CloseHandle (sem); }
+    void post (int n) noexcept  { ReleaseSemaphore (sem, n, nullptr); }
+    void wait() noexcept        { WaitForSingleObject (sem, INFINITE); }
+    HANDLE sem;
+};
+#else
+ #error "Semaphore isn't implemented on this platform"
+#endif
+
+Semaphore::Semaphore (const int maxCount_)
+    : maxCount (jmax (1, maxCount_)),
+      native (new Native()) { }
+
+Semaphore::~Semaphore() { }
+
+void Semaphore::signal (const int numSignals) noexcept
+{
+    jassert (numSignals > 0);
+
+    // a negative count is the number of threads asleep in the kernel
+    int old, next;
+    do {
+        old  = count.get();
+        next = old + jmin (numSignals, maxCount - old);
+        if (next == old)
+            return;
+    } while (! count.compareAndSetBool (next, old));
+
+    const int numToWake = jmin (next, 0) - jmin (old, 0);
+    if (numToWake > 0)
+        native->post (numToWake);
+}
+
+void Semaphore::wait() noexcept
+{
+    if (--count < 0)
+        native->wait();
+}
+
+}
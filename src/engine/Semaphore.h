@@ -0,0 +1,55 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A counting semaphore which only enters the kernel when a thread has to
+    sleep or be woken. signal() never takes a lock, so the audio thread can
+    use it to wake helper threads where a WaitableEvent would lock a mutex.
+ */
+class Semaphore
+{
+public:
+    /** Creates a semaphore which holds at most maxCount unclaimed signals.
+        Signals beyond that are dropped, so waking threads which are already
+        busy doesn't pile up */
+    explicit Semaphore (int maxCount = std::numeric_limits<int>::max());
+    ~Semaphore();
+
+    /** Wakes up to count waiting threads, or lets that many future waits
+        through. Realtime safe */
+    void signal (int count = 1) noexcept;
+
+    /** Blocks until signalled */
+    void wait() noexcept;
+
+private:
+    Atomic<int> count { 0 };
+    const int maxCount;
+    struct Native;
+    std::unique_ptr<Native> native;
+
+    JUCE_DECLARE_NON_COPYABLE (Semaphore)
+};
+
+}
@@ -0,0 +1,61 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Hands values of T from one writer thread to one reader thread without
+    locks or allocation. The reader always sees the most recently published
+    value and never one that is still being written. */
+template<class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    /** Returns the value to fill in before calling publish(). Writer only */
+    T& getWriteBuffer() noexcept { return slots [back]; }
+
+    /** Makes the write buffer the latest value. Writer only */
+    void publish() noexcept
+    {
+        back = state.exchange (back | dirtyFlag) & indexMask;
+    }
+
+    /** Returns the latest published value. Reader only. The reference is
+        valid until the next call to read() */
+    const T& read() noexcept
+    {
+        if ((state.get() & dirtyFlag) != 0)
+            front = state.exchange (front) & indexMask;
+        return slots [front];
+    }
+
+private:
+    enum { indexMask = 3, dirtyFlag = 4 };
+    T slots [3];
+    int back = 0, front = 1;
+    Atomic<int> state { 2 };
+
+    JUCE_DECLARE_NON_COPYABLE (TripleBuffer)
+};
+
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "engine/nodes/MidiFilterNode.h"
+#include "engine/FixedMidiBuffer.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 
@@ -41,7 +42,12 @@ public:
     void setState (const void* data, int size) override { ignoreUnused (data, size); }
     void getState (MemoryBlock& block) override { ignoreUnused (block); }
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    void prepareToRender (double sampleRate, int maxBufferSize) override
+    {
+        ignoreUnused (sampleRate, maxBufferSize);
+        FixedMidiBuffer::reserve (tempMidi);
+    }
+
     void releaseResources() override { }
 
     inline void render (AudioSampleBuffer& audio, MidiPipe& midi) override
@@ -73,7 +79,7 @@ public:
         {
             if (msg.getChannel() <= 0)
                 continue;
-            buffers[msg.getChannel() - 1]->addEvent (msg, frame);
+            FixedMidiBuffer::addEvent (*buffers[msg.getChannel() - 1], msg, frame);
         }
 
         input.swapWith (tempMidi);
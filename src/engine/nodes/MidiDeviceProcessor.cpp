@@ -18,6 +18,7 @@
 */
 
 #include "engine/nodes/MidiDeviceProcessor.h"
+#include "engine/GraphProcessor.h"
 #include "engine/MidiEngine.h"
 #include "gui/LookAndFeel.h"
 
@@ -157,7 +158,8 @@ const String MidiDeviceProcessor::getName() const
 
 void MidiDeviceProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
-    inputMessages.reset (sampleRate);
+    inputClock.reset (sampleRate);
+    inputMessages.clear();
     if (prepared)
         return;
     
@@ -196,8 +198,17 @@ void MidiDeviceProcessor::processBlock (AudioBuffer<float>& audio, MidiBuffer& m
     const auto nframes = audio.getNumSamples();
     if (inputDevice)
     {
+        // in a graph the time is taken once per host block, not per part of one
         midi.clear (0, nframes);
-        inputMessages.removeNextBlockOfMessages (midi, nframes);
+        if (auto* const graph = parentGraph.get())
+        {
+            inputMessages.pull (midi, graph->getMidiInputClock(), nframes);
+        }
+        else
+        {
+            inputClock.update (Time::getMillisecondCounterHiRes(), nframes);
+            inputMessages.pull (midi, inputClock, nframes);
+        }
     }
     else
     {
@@ -215,8 +226,8 @@ void MidiDeviceProcessor::processBlock (AudioBuffer<float>& audio, MidiBuffer& m
 void MidiDeviceProcessor::releaseResources()
 {
     prepared = false;
-    inputMessages.reset (getSampleRate());
     midi.removeMidiInputCallback (this);
+    inputMessages.clear();
 
     if (input)
     {
@@ -265,7 +276,7 @@ void MidiDeviceProcessor::handleIncomingMidiMessage (MidiInput* source, const Mi
 {
     if (message.isActiveSense())
         return;
-    inputMessages.addMessageToQueue (message);
+    inputMessages.push (message);
 }
 
 void MidiDeviceProcessor::handlePartialSysexMessage (MidiInput* source, const uint8* messageData,
@@ -20,9 +20,11 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/MidiInputQueue.h"
 
 namespace Element {
 
+class GraphProcessor;
 class MidiEngine;
 
 class MidiDeviceProcessor : public BaseProcessor,
@@ -56,6 +58,10 @@ public:
     const String& getCurrentDevice() const { return deviceName; }
     bool isDeviceOpen() const;
 
+    /** Set by the node holding this device. Input is then placed with the
+        graph's clock instead of this device's own */
+    void setParentGraph (GraphProcessor* graph) noexcept { parentGraph = graph; }
+
     void reload();
     
     const String getName() const override;
@@ -135,7 +141,9 @@ private:
     String deviceName;
     ScopedPointer<MidiInput> input;
     ScopedPointer<MidiOutput> output;
-    MidiMessageCollector inputMessages;
+    MidiInputQueue inputMessages;
+    MidiInputClock inputClock;      // used outside a graph
+    Atomic<GraphProcessor*> parentGraph { nullptr };
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiDeviceProcessor);
 };
 
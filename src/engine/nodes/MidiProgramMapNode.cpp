@@ -18,6 +18,7 @@
 */
 
 #include "engine/nodes/MidiProgramMapNode.h"
+#include "engine/FixedMidiBuffer.h"
 
 namespace Element {
 
@@ -43,9 +44,11 @@ void MidiProgramMapNode::clear()
 void MidiProgramMapNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
     ignoreUnused (sampleRate, maxBufferSize);
+    FixedMidiBuffer::reserve (tempMidi);
     
     {
         ScopedLock sl (lock);
+        FixedMidiBuffer::reserve (toSendMidi);
         for (int i = 0; i <= 127; ++i)
             programMap [i] = -1;
         for (const auto* const entry : entries)
@@ -78,7 +81,7 @@ void MidiProgramMapNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     {
         MidiBuffer::Iterator iter1 (toSendMidi);
         while (iter1.getNextEvent (msg, frame))
-            midiIn->addEvent (msg, frame);
+            FixedMidiBuffer::addEvent (*midiIn, msg, frame);
         toSendMidi.clear();
     }
 
@@ -90,13 +93,13 @@ void MidiProgramMapNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
         if (msg.isProgramChange() && programMap [msg.getProgramChangeNumber()] >= 0)
         {
             program = msg.getProgramChangeNumber();
-            tempMidi.addEvent (MidiMessage::programChange (
+            FixedMidiBuffer::addEvent (tempMidi, MidiMessage::programChange (
                 msg.getChannel(), programMap [msg.getProgramChangeNumber()]),
                 frame);
         }
         else
         {
-            tempMidi.addEvent (msg, frame);
+            FixedMidiBuffer::addEvent (tempMidi, msg, frame);
         }
     }
 
@@ -33,6 +33,7 @@
 #include "gui/NavigationConcertinaPanel.h"
 #include "gui/NodeIOConfiguration.h"
 #include "engine/nodes/SubGraphProcessor.h"
+#include "engine/AudioEngine.h"
 #include "engine/nodes/BaseProcessor.h"
 
 #include "session/PluginManager.h"
@@ -567,7 +568,22 @@ public:
     
     void paintOverChildren (Graphics& g) override
     {
-        ignoreUnused (g);
+        if (! NodeProfile::isEnabled())
+            return;
+
+        GraphNodePtr obj = node.getGraphNode();
+        if (obj == nullptr)
+            return;
+
+        const auto stats = obj->getProfileStats();
+        String text;
+        text << String (stats.load, 1) << "% "
+             << String (roundToInt (stats.p99Micros)) << "us";
+
+        auto r = getBoxRectangle().reduced (4, 2).removeFromTop (12);
+        g.setColour (stats.load >= 50.0 ? Colors::toggleRed : Colour (0xff333333));
+        g.setFont (Font (9.f));
+        g.drawText (text, r, Justification::centredRight, false);
     }
 
     void paint (Graphics& g) override
@@ -1063,10 +1079,13 @@ GraphEditorComponent::GraphEditorComponent()
 {
     setOpaque (true);
     data.addListener (this);
+    if (NodeProfile::isEnabled())
+        startTimer (profileRefreshMillis);
 }
 
 GraphEditorComponent::~GraphEditorComponent()
 {
+    stopTimer();
     data.removeListener (this);
     graph = Node();
     data = ValueTree();
@@ -1075,6 +1094,21 @@ GraphEditorComponent::~GraphEditorComponent()
     deleteAllChildren();
 }
 
+void GraphEditorComponent::timerCallback()
+{
+    // repaint once more after profiling stops to clear the overlay
+    const bool profiling = NodeProfile::isEnabled();
+    if (! profiling)
+        stopTimer();
+    if (! profiling && ! showingProfile)
+        return;
+    showingProfile = profiling;
+
+    for (int i = getNumChildComponents(); --i >= 0;)
+        if (auto* const fc = dynamic_cast<FilterComponent*> (getChildComponent (i)))
+            fc->repaint();
+}
+
 void GraphEditorComponent::setNode (const Node& n)
 {
     bool isGraph = n.isGraph();
@@ -1156,6 +1190,7 @@ void GraphEditorComponent::mouseDown (const MouseEvent& e)
        #endif
         menu.addSeparator();
         menu.addItem (6, "Fixed node positions", true, areResizePositionsFrozen());
+        menu.addItem (8, "Show DSP load", true, NodeProfile::isEnabled());
         menu.addSeparator();
         
         menu.addSectionHeader ("Plugins");
@@ -1211,6 +1246,15 @@ void GraphEditorComponent::mouseDown (const MouseEvent& e)
                     setResizePositionsFrozen (! areResizePositionsFrozen());
                     return;
                     break;
+
+                case 8:
+                    if (auto* world = ViewHelpers::getGlobals (this))
+                        world->getAudioEngine()->setNodeProfilingEnabled (! NodeProfile::isEnabled());
+                    if (NodeProfile::isEnabled())
+                        startTimer (profileRefreshMillis);
+                    timerCallback();
+                    return;
+                    break;
                 
                 case 7:
                 {
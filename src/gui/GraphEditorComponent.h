@@ -35,6 +35,7 @@ class GraphEditorComponent   : public Component,
                                public ChangeListener,
                                public DragAndDropTarget,
                                private ValueTree::Listener,
+                               private Timer,
                                public ViewHelperMixin
 {
 public:
@@ -98,6 +99,8 @@ private:
     SelectedItemSet<uint32> selectedNodes;
 
     bool ignoreNodeSelected = false;
+    bool showingProfile = false;
+    enum { profileRefreshMillis = 500 };    // only runs while profiling
 
     void selectNode (const Node& node, ModifierKeys mods);
 
@@ -119,6 +122,7 @@ private:
     PinComponent* findPinAt (const int x, const int y) const;
     
     void updateSelection();
+    void timerCallback() override;
     
     void valueTreePropertyChanged (ValueTree& treeWhosePropertyHasChanged, const Identifier& property) override { }
     void valueTreeChildAdded (ValueTree& parentTree, ValueTree& childWhichHasBeenAdded) override;
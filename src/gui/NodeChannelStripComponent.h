@@ -60,6 +60,7 @@ public:
 
     ~NodeChannelStripComponent()
     {
+        setMeteredNode (nullptr);
         unbindSignals();
     }
 
@@ -204,6 +205,7 @@ public:
         audioIns.clearQuick(); audioOuts.clearQuick();
         node.getPorts (audioIns, audioOuts, PortType::Audio);
         displayName.referTo (node.getPropertyAsValue (Tags::name));
+        setMeteredNode (isVisible() ? node.getGraphNode() : nullptr);
         stabilizeContent();
         startTimerHz (meterSpeedHz);
 
@@ -212,6 +214,12 @@ public:
     }
 
     inline Node getNode() const { return node; }
+
+    /** @internal */
+    void visibilityChanged() override
+    {
+        setMeteredNode (isVisible() ? node.getGraphNode() : nullptr);
+    }
     
     inline void setComboBoxesVisible (bool showChannelBox = true, bool showFlowBox = true)
     {
@@ -261,6 +269,7 @@ private:
     bool useFlowBox = true;
     bool useChannelBox = true;
 
+    GraphNodePtr meteredNode;
     int meterSpeedHz    = 15;
     bool isAudioOutNode = false;
     bool isAudioInNode  = false;
@@ -274,6 +283,18 @@ private:
     SignalConnection volumeDoubleClickedConnection;
     SignalConnection muteChangedConnection;
 
+    /** The engine only measures levels of nodes with a visible meter */
+    inline void setMeteredNode (GraphNode* newNode)
+    {
+        if (meteredNode.get() == newNode)
+            return;
+        if (meteredNode != nullptr)
+            meteredNode->removeMeterWatcher();
+        meteredNode = newNode;
+        if (meteredNode != nullptr)
+            meteredNode->addMeterWatcher();
+    }
+
     inline bool isMonitoringInputs() const  { return flowBox.getSelectedId() == 1; }
     inline bool isMonitoringOutputs() const { return flowBox.getSelectedId() == 2; }
 
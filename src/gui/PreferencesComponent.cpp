@@ -350,6 +350,28 @@ namespace Element {
             askToSaveSession.setToggleState (settings.askToSaveSession(), dontSendNotification);
             askToSaveSession.getToggleStateValue().addListener (this);
 
+            addAndMakeVisible (loadGraphsOnDemandLabel);
+            loadGraphsOnDemandLabel.setText ("Load graphs when selected", dontSendNotification);
+            loadGraphsOnDemandLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (loadGraphsOnDemand);
+            loadGraphsOnDemand.setClickingTogglesState (true);
+            loadGraphsOnDemand.setToggleState (settings.loadGraphsOnDemand(), dontSendNotification);
+            loadGraphsOnDemand.getToggleStateValue().addListener (this);
+
+            addAndMakeVisible (graphMemoryBudgetLabel);
+            graphMemoryBudgetLabel.setText ("Memory for loaded graphs", dontSendNotification);
+            graphMemoryBudgetLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (graphMemoryBudgetBox);
+            graphMemoryBudgetBox.addItem ("No limit", 1);
+            for (int gigabytes = 1; gigabytes <= 32; gigabytes *= 2)
+                graphMemoryBudgetBox.addItem (String (gigabytes) + " GB", gigabytes * 1024);
+            graphMemoryBudgetBox.setSelectedId (jmax (1, settings.getGraphMemoryBudget()), dontSendNotification);
+            graphMemoryBudgetBox.setEnabled (settings.loadGraphsOnDemand());
+            graphMemoryBudgetBox.setTooltip ("Graph sizes are estimated from the memory used while "
+                                             "they load, so plugins which allocate later may go over this");
+            graphMemoryBudget.referTo (graphMemoryBudgetBox.getSelectedIdAsValue());
+            graphMemoryBudget.addListener (this);
+
            #ifdef EL_PRO
             addAndMakeVisible (defaultSessionFileLabel);
             defaultSessionFileLabel.setText ("Default new Session", dontSendNotification);
@@ -381,6 +403,7 @@ namespace Element {
         virtual ~GeneralSettingsPage() noexcept
         {
             clockSource.removeListener (this);
+            graphMemoryBudget.removeListener (this);
         }
 
         void filenameComponentChanged (FilenameComponent* f) override
@@ -431,6 +454,8 @@ namespace Element {
             layoutSetting (r, hidePluginWindowsLabel, hidePluginWindows);
             layoutSetting (r, openLastSessionLabel, openLastSession);
             layoutSetting (r, askToSaveSessionLabel, askToSaveSession);
+            layoutSetting (r, loadGraphsOnDemandLabel, loadGraphsOnDemand);
+            layoutSetting (r, graphMemoryBudgetLabel, graphMemoryBudgetBox, 120);
             
            #ifdef EL_PRO
             layoutSetting (r, defaultSessionFileLabel, defaultSessionFile, 190 - settingHeight);
@@ -490,6 +515,16 @@ namespace Element {
             {
                 settings.setHidePluginWindowsWhenFocusLost (hidePluginWindows.getToggleState());
             }
+            else if (value.refersToSameSourceAs (loadGraphsOnDemand.getToggleStateValue()))
+            {
+                settings.setLoadGraphsOnDemand (loadGraphsOnDemand.getToggleState());
+                graphMemoryBudgetBox.setEnabled (loadGraphsOnDemand.getToggleState());
+            }
+            else if (value.refersToSameSourceAs (graphMemoryBudget))
+            {
+                const int megabytes = (int) graphMemoryBudget.getValue();
+                settings.setGraphMemoryBudget (megabytes > 1 ? megabytes : 0);
+            }
 
             settings.saveIfNeeded();
             gui.stabilizeViews();
@@ -524,6 +559,13 @@ namespace Element {
         Label askToSaveSessionLabel;
         SettingButton askToSaveSession;
 
+        Label loadGraphsOnDemandLabel;
+        SettingButton loadGraphsOnDemand;
+
+        Label graphMemoryBudgetLabel;
+        ComboBox graphMemoryBudgetBox;
+        Value graphMemoryBudget;
+
         Label defaultSessionFileLabel;
         FilenameComponent defaultSessionFile;
         TextButton defaultSessionClearButton;
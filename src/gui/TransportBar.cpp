@@ -56,6 +56,26 @@ public:
     }
 };
     
+/** Shows the device callback load and deadline misses, double click to reset */
+class CallbackLoadLabel : public Label
+{
+public:
+    CallbackLoadLabel (TransportBar& t) : owner (t)
+    {
+        setJustificationType (Justification::centred);
+        setFont (Font (12.f));
+    }
+
+    void mouseDoubleClick (const MouseEvent&) override
+    {
+        if (auto e = owner.engine)
+            e->resetCallbackStats();
+        owner.updateCallbackLoad();
+    }
+
+    TransportBar& owner;
+};
+
 TransportBar::TransportBar ()
 {
     addAndMakeVisible (play = new SettingButton ());
@@ -85,6 +105,9 @@ TransportBar::TransportBar ()
     addAndMakeVisible (subLabel = new SubBeatLabel());
     subLabel->setName ("subLabel");
 
+    addAndMakeVisible (loadLabel = new CallbackLoadLabel (*this));
+    loadLabel->setName ("loadLabel");
+
     setBeatTime (0.f);
     setSize (260, 16);
     updateWidth();
@@ -100,6 +123,7 @@ TransportBar::~TransportBar()
     barLabel = nullptr;
     beatLabel = nullptr;
     subLabel = nullptr;
+    loadLabel = nullptr;
 }
 
 bool TransportBar::checkForMonitor()
@@ -128,6 +152,43 @@ void TransportBar::timerCallback()
         record->setToggleState (monitor->recording.get(), dontSendNotification);
 
     stabilize();
+
+    if (++loadTicks >= 6)
+    {
+        loadTicks = 0;
+        updateCallbackLoad();
+    }
+}
+
+void TransportBar::updateCallbackLoad()
+{
+    if (! checkForMonitor())
+        return;
+
+    const auto stats = engine->getCallbackStats();
+    const int64 numMissed = stats.numOverruns + stats.numDeviceXruns;
+
+    String text = String (roundToInt (stats.meanLoad)) + "%";
+    if (numMissed > 0)
+        text << " " << String (numMissed) << "!";
+    loadLabel->setText (text, dontSendNotification);
+
+    if (numMissed > 0)
+        loadLabel->setColour (Label::textColourId, Colors::toggleRed);
+    else
+        loadLabel->removeColour (Label::textColourId);
+
+    String tip;
+    tip << "DSP load: " << String (stats.meanLoad, 1) << "% mean, "
+        << String (stats.p99Load, 1) << "% 99th percentile, "
+        << String (stats.maxLoad, 1) << "% max" << newLine
+        << "Missed deadlines: " << String (stats.numOverruns)
+        << ", late callbacks: " << String (stats.numLate)
+        << ", device xruns: " << String (stats.numDeviceXruns) << newLine;
+    for (const auto& block : stats.worstBlocks)
+        tip << block.toString() << newLine;
+    tip << "Double click to reset";
+    loadLabel->setTooltip (tip);
 }
 
 void TransportBar::paint (Graphics& g)
@@ -144,6 +205,7 @@ void TransportBar::resized()
     barLabel->setBounds (0, 0, 24, 16);
     beatLabel->setBounds (26, 0, 24, 16);
     subLabel->setBounds (52, 0, 24, 16);
+    loadLabel->setBounds (146, 0, 56, 16);
 }
 
 void TransportBar::buttonClicked (Button* buttonThatWasClicked)
@@ -192,7 +254,7 @@ void TransportBar::stabilize()
 
 void TransportBar::updateWidth()
 {
-    setSize (record->getRight(), getHeight());
+    setSize (loadLabel->getRight(), getHeight());
 }
 
 } /* namespace element */
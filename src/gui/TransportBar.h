@@ -54,12 +54,16 @@ private:
     ScopedPointer<DragableIntLabel> barLabel;
     ScopedPointer<DragableIntLabel> beatLabel;
     ScopedPointer<DragableIntLabel> subLabel;
+    ScopedPointer<Label> loadLabel;
+    int loadTicks = 0;
     
     friend class BarLabel;
+    friend class CallbackLoadLabel;
     friend class Timer;
     void timerCallback() override;
     
     bool checkForMonitor();
+    void updateCallbackLoad();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportBar)
 };
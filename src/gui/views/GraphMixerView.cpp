@@ -116,8 +116,34 @@ public:
         }
     }
 
+    void timerCallback() override
+    {
+        NodeChannelStripComponent::timerCallback();
+
+        // the DSP load overlay updates a couple times a second
+        const bool profiling = NodeProfile::isEnabled();
+        if ((profiling || showingProfile) && ++profileTicks >= 8)
+        {
+            profileTicks = 0;
+            showingProfile = profiling;
+            repaint();
+        }
+    }
+
     void paintOverChildren (Graphics& g) override
     {
+        if (NodeProfile::isEnabled())
+        {
+            if (GraphNodePtr obj = getNode().getGraphNode())
+            {
+                const auto stats = obj->getProfileStats();
+                g.setColour (stats.load >= 50.0 ? Colors::toggleRed : LookAndFeel::textColor);
+                g.setFont (Font (9.f));
+                g.drawText (String (stats.load, 1) + "%", getLocalBounds().reduced (3).removeFromTop (10),
+                            Justification::centredRight, false);
+            }
+        }
+
         if (selected || (hover && ! dragging && ! down))
         {
             g.setColour (Colors::toggleBlue);
@@ -167,6 +193,8 @@ private:
     bool dragging = false;
     bool down = false;
     bool hover = false;
+    bool showingProfile = false;
+    int profileTicks = 0;
 
     struct ChildListener : public MouseListener
     {
@@ -105,6 +105,160 @@ namespace Element {
         bool locked = false;
     };
 
+    class MultiCorePropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        MultiCorePropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Multi-Core", "Enabled", "Disabled"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+        }
+
+        bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::multiCore, false);
+        }
+
+        void setState (const bool newState) override
+        {
+            graph.setProperty (Tags::multiCore, newState);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setMultiCoreRendering (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
+    class SkipSilencePropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        SkipSilencePropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Skip Silent Nodes", "Enabled", "Disabled"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+        }
+
+        bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::skipSilence, false);
+        }
+
+        void setState (const bool newState) override
+        {
+            graph.setProperty (Tags::skipSilence, newState);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setSilentNodeSkipping (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
+    class RenderAheadPropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        RenderAheadPropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Render Ahead", "Enabled", "Disabled"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+        }
+
+        bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::renderAhead, false);
+        }
+
+        void setState (const bool newState) override
+        {
+            graph.setProperty (Tags::renderAhead, newState);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setAnticipativeRendering (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
+    class RenderQuantumPropertyComponent : public ChoicePropertyComponent
+    {
+    public:
+        RenderQuantumPropertyComponent (const Node& g)
+            : ChoicePropertyComponent ("Render Quantum"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+            choices.add ("Host Block");
+            for (const int size : sizes)
+                choices.add (String (size) + " Samples");
+        }
+
+        int getIndex() const override
+        {
+            const int quantum = graph.getProperty (Tags::renderQuantum, 0);
+            for (int i = 0; i < numElementsInArray (sizes); ++i)
+                if (sizes[i] == quantum)
+                    return i + 1;
+            return 0;
+        }
+
+        void setIndex (const int i) override
+        {
+            const int quantum = (i > 0 && i <= numElementsInArray (sizes)) ? sizes[i - 1] : 0;
+            graph.setProperty (Tags::renderQuantum, quantum);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setRenderQuantum (quantum);
+            refresh();
+        }
+
+    private:
+        Node graph;
+        const int sizes[4] = { 32, 64, 128, 256 };
+    };
+
+    class PipelineStagesPropertyComponent : public ChoicePropertyComponent
+    {
+    public:
+        PipelineStagesPropertyComponent (const Node& g)
+            : ChoicePropertyComponent ("Pipeline Stages"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+            choices.add ("Off");
+            for (int stages = 2; stages <= GraphProcessor::maxPipelineStages; ++stages)
+                choices.add (String (stages) + " Stages");
+        }
+
+        int getIndex() const override
+        {
+            const int stages = graph.getProperty (Tags::pipelineStages, 1);
+            return jlimit (1, GraphProcessor::maxPipelineStages, stages) - 1;
+        }
+
+        void setIndex (const int i) override
+        {
+            const int stages = jlimit (1, GraphProcessor::maxPipelineStages, i + 1);
+            graph.setProperty (Tags::pipelineStages, stages);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setPipelineStages (stages);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
     class VelocityCurvePropertyComponent : public ChoicePropertyComponent
     {
     public:
@@ -304,6 +458,11 @@ namespace Element {
                                                   TRANS("Name"), 256, false));
            #if defined (EL_PRO)
             props.add (new RenderModePropertyComponent (g));
+            props.add (new MultiCorePropertyComponent (g));
+            props.add (new SkipSilencePropertyComponent (g));
+            props.add (new RenderQuantumPropertyComponent (g));
+            props.add (new RenderAheadPropertyComponent (g));
+            props.add (new PipelineStagesPropertyComponent (g));
             props.add (new VelocityCurvePropertyComponent (g));
            #endif
 
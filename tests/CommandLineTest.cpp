@@ -0,0 +1,61 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class CommandLineTest : public UnitTestBase
+{
+public:
+    CommandLineTest() : UnitTestBase ("Command Line", "app", "commandLine") { }
+    virtual ~CommandLineTest() { }
+
+    void runTest() override
+    {
+        beginTest ("switches are whole arguments");
+        {
+            const CommandLine cli ("--full-screen --port=4000");
+            expect (cli.fullScreen);
+            expectEquals (cli.port, 4000);
+            expect (! cli.render);
+            expect (! cli.headless);
+        }
+
+        beginTest ("rendering is headless");
+        {
+            const CommandLine cli ("--render session.els --output=out.wav");
+            expect (cli.render);
+            expect (cli.headless);
+            expect (! cli.fullScreen);
+        }
+
+        beginTest ("switches inside other arguments are ignored");
+        {
+            const CommandLine cli ("\"/tmp/--render --headless.els\" --output=--full-screen.wav --port=x");
+            expect (! cli.render);
+            expect (! cli.headless);
+            expect (! cli.fullScreen);
+            expectEquals (cli.port, 3123);
+        }
+    }
+};
+
+static CommandLineTest sCommandLineTest;
+
+}
@@ -23,6 +23,7 @@
 #include "controllers/AppController.h"
 #include "controllers/SessionController.h"
 
+#include "engine/AllocationCounter.h"
 #include "engine/AudioEngine.h"
 #include "engine/GraphProcessor.h"
 #include "engine/MappingEngine.h"
@@ -99,6 +100,18 @@ protected:
         return thedir;
     }
 
+    /** Fails if anything rendered since AllocationCounter::reset() allocated,
+        freed or locked a mutex, and logs where it happened */
+    void expectRealtimeSafe()
+    {
+        if (! AllocationCounter::isEnabled())
+            return;
+        const int64 numViolations = AllocationCounter::getNumViolations();
+        if (numViolations > 0)
+            logMessage (AllocationCounter::createReport());
+        expectEquals (numViolations, (int64) 0);
+    }
+
     void runDispatchLoop (const int millisecondsToRunFor = 40) { MessageManager::getInstance()->runDispatchLoopUntil (millisecondsToRunFor); }
     
     Globals& getWorld() { initializeWorld(); return *world; }
@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "bench/Benchmark.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+namespace Element {
+
+Benchmark::Benchmark (const String& benchmarkName)
+    : name (benchmarkName)
+{
+    getAllBenchmarks().add (this);
+}
+
+Benchmark::~Benchmark()
+{
+    getAllBenchmarks().removeFirstMatchingValue (this);
+}
+
+Array<Benchmark*>& Benchmark::getAllBenchmarks()
+{
+    static Array<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+void BenchmarkRunner::runAll()
+{
+    for (auto* const benchmark : Benchmark::getAllBenchmarks())
+    {
+        if (options.filter.isNotEmpty() && options.filter != benchmark->getName())
+            continue;
+
+        Logger::writeToLog ("running: " + benchmark->getName());
+        current = benchmark;
+        benchmark->run (*this);
+        current = nullptr;
+    }
+}
+
+void BenchmarkRunner::addResult (const var& params, const var& metrics)
+{
+    jassert (current != nullptr);
+    DynamicObject::Ptr result = new DynamicObject();
+    result->setProperty ("benchmark", current->getName());
+    result->setProperty ("params", params);
+    result->setProperty ("metrics", metrics);
+    results.add (var (result.get()));
+    Logger::writeToLog ("  " + JSON::toString (params, true) + " " + JSON::toString (metrics, true));
+}
+
+var BenchmarkRunner::createReport() const
+{
+    DynamicObject::Ptr host = new DynamicObject();
+    host->setProperty ("os", SystemStats::getOperatingSystemName());
+    host->setProperty ("cpuVendor", SystemStats::getCpuVendor());
+    host->setProperty ("cpuMHz", SystemStats::getCpuSpeedInMegaherz());
+    host->setProperty ("numCpus", SystemStats::getNumCpus());
+
+    DynamicObject::Ptr report = new DynamicObject();
+    report->setProperty ("version", ProjectInfo::versionString);
+    report->setProperty ("date", Time::getCurrentTime().toISO8601 (true));
+    report->setProperty ("host", var (host.get()));
+    report->setProperty ("results", results);
+    return var (report.get());
+}
+
+int64 BenchmarkRunner::getResidentMemory()
+{
+   #if JUCE_LINUX
+    StringArray fields;
+    fields.addTokens (File ("/proc/self/statm").loadFileAsString(), true);
+    if (fields.size() > 1)
+        return fields[1].getLargeIntValue() * (int64) sysconf (_SC_PAGESIZE);
+   #endif
+    return -1;
+}
+
+var BenchmarkRunner::summarize (Array<double>& nanos)
+{
+    DynamicObject::Ptr summary = new DynamicObject();
+    if (nanos.isEmpty())
+        return var (summary.get());
+
+    nanos.sort();
+    double total = 0.0;
+    for (const auto n : nanos)
+        total += n;
+
+    const int last = nanos.size() - 1;
+    summary->setProperty ("meanNs",   total / (double) nanos.size());
+    summary->setProperty ("medianNs", nanos [last / 2]);
+    summary->setProperty ("p99Ns",    nanos [roundToInt (0.99 * last)]);
+    summary->setProperty ("minNs",    nanos.getFirst());
+    summary->setProperty ("maxNs",    nanos.getLast());
+    return var (summary.get());
+}
+
+}
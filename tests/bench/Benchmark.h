@@ -0,0 +1,93 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Settings shared by all benchmarks, parsed from the bench-element command line */
+struct BenchmarkOptions
+{
+    Array<int> nodeCounts { 16, 64, 256 };
+    Array<int> fanOuts { 1, 4 };         // nodes per layer
+    Array<int> fanIns { 1, 2 };          // sources summed into each node
+    Array<int> blockSizes { 64, 256, 1024 };
+    int numBlocks = 2000;               // timed process calls per configuration
+    int numRebuilds = 10;
+    bool multiCore = false;
+    File outputFile;
+    String filter;                      // only run benchmarks with this name
+};
+
+class BenchmarkRunner;
+
+/** A benchmark that reports one result per configuration it measures.
+    Instances register themselves when constructed, like a juce::UnitTest */
+class Benchmark
+{
+public:
+    explicit Benchmark (const String& benchmarkName);
+    virtual ~Benchmark();
+
+    const String& getName() const noexcept { return name; }
+
+    /** Measure every configuration and report via BenchmarkRunner::addResult */
+    virtual void run (BenchmarkRunner& runner) = 0;
+
+    static Array<Benchmark*>& getAllBenchmarks();
+
+private:
+    const String name;
+    JUCE_DECLARE_NON_COPYABLE (Benchmark)
+};
+
+/** Runs benchmarks and collects their results as JSON */
+class BenchmarkRunner
+{
+public:
+    explicit BenchmarkRunner (const BenchmarkOptions& opts) : options (opts) { }
+
+    const BenchmarkOptions& getOptions() const noexcept { return options; }
+
+    /** Runs all benchmarks which match the options' filter */
+    void runAll();
+
+    /** Adds a result for the benchmark being run. params describes the
+        configuration and metrics the measured values */
+    void addResult (const var& params, const var& metrics);
+
+    /** Returns the report: host information followed by all results */
+    var createReport() const;
+
+    /** Resident memory of this process in bytes, or -1 if unknown */
+    static int64 getResidentMemory();
+
+    /** Summary statistics of a set of timings, in nanoseconds */
+    static var summarize (Array<double>& nanos);
+
+private:
+    const BenchmarkOptions options;
+    Array<var> results;
+    Benchmark* current = nullptr;
+};
+
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bench/Benchmark.h"
+#include "engine/GraphProcessor.h"
+#include "engine/nodes/PlaceholderProcessor.h"
+
+namespace Element {
+
+/** Nanoseconds per GraphProcessor::processBlock for a graph with one node
+    between the audio input and output, with the node's gain, mute and
+    metering set up in different ways. The node passes audio through, so
+    this mostly times the work the graph does around a node's processor */
+class GainKernelBenchmark : public Benchmark
+{
+public:
+    GainKernelBenchmark() : Benchmark ("gainKernel") { }
+
+    void run (BenchmarkRunner& runner) override
+    {
+        for (const int blockSize : { 32, 64, 128, 256, 512, 1024 })
+            for (const auto& setup : setups)
+                measure (runner, setup, blockSize);
+    }
+
+private:
+    static const int numWarmupBlocks = 50;
+
+    struct Setup
+    {
+        const char* name;
+        bool gainRamp;          // the gain changes every block
+        bool muted;
+        bool metering;
+        bool skipSilence;
+    };
+
+    const Setup setups [5] = {
+        { "unity",                   false, false, false, false },
+        { "unity, skipping silence", false, false, false, true },
+        { "gain ramp",               true,  false, false, false },
+        { "gain ramp, metered",      true,  false, true,  false },
+        { "muted",                   false, true,  false, false }
+    };
+
+    void measure (BenchmarkRunner& runner, const Setup& setup, const int blockSize)
+    {
+        const double sampleRate = 44100.0;
+        const auto& options = runner.getOptions();
+
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr node   = graph.addNode (new PlaceholderProcessor (2, 2, false, false));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            graph.connectChannels (PortType::Audio, input->nodeId, ch, node->nodeId, ch);
+            graph.connectChannels (PortType::Audio, node->nodeId, ch, output->nodeId, ch);
+        }
+
+        graph.setSilentNodeSkipping (setup.skipSilence);
+        node->setMuted (setup.muted);
+        if (setup.metering)
+            node->addMeterWatcher();
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        AudioSampleBuffer noise (2, blockSize), block (2, blockSize);
+        Random random (blockSize);
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < blockSize; ++s)
+                noise.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+
+        MidiBuffer midi;
+        Array<double> nanos;
+        nanos.ensureStorageAllocated (options.numBlocks);
+
+        for (int b = 0; b < numWarmupBlocks + options.numBlocks; ++b)
+        {
+            block.makeCopyOf (noise, true);
+            midi.clear();
+            if (setup.gainRamp)
+                node->setGain (b % 2 == 0 ? 0.9f : 1.1f);
+
+            const int64 start = Time::getHighResolutionTicks();
+            graph.processBlock (block, midi);
+            if (b >= numWarmupBlocks)
+                nanos.add (1.0e9 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+        }
+
+        DynamicObject::Ptr params = new DynamicObject();
+        params->setProperty ("node", setup.name);
+        params->setProperty ("blockSize", blockSize);
+
+        const var metrics = BenchmarkRunner::summarize (nanos);
+        if (auto* const object = metrics.getDynamicObject())
+            object->setProperty ("nsPerSample", (double) object->getProperty ("meanNs") / (double) blockSize);
+
+        runner.addResult (var (params.get()), metrics);
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static GainKernelBenchmark sGainKernelBenchmark;
+
+}
@@ -0,0 +1,210 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "bench/Benchmark.h"
+#include "engine/AudioEngine.h"
+#include "engine/GraphProcessor.h"
+#include "engine/nodes/AllPassFilterNode.h"
+#include "engine/nodes/AudioMixerProcessor.h"
+#include "engine/nodes/AudioRouterNode.h"
+#include "engine/nodes/CombFilterProcessor.h"
+#include "engine/nodes/MidiChannelMapProcessor.h"
+#include "engine/nodes/ReverbProcessor.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+static const double benchSampleRate = 44100.0;
+
+/** A graph of internal nodes arranged in layers.  Each layer has fanOut
+    stereo nodes and every node sums fanIn nodes of the layer before it.
+    The last layer is mixed down to the graph output, and a chain of MIDI
+    filters runs from the MIDI input to the MIDI output */
+struct SyntheticGraph
+{
+    SyntheticGraph (const int numNodes, const int fanOut, const int fanIn, const int blockSize)
+    {
+        graph.setPlayConfigDetails (2, 2, benchSampleRate, blockSize);
+
+        GraphNodePtr input   = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output  = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr midiIn  = graph.addNode (new IOProcessor (IOProcessor::midiInputNode));
+        GraphNodePtr midiOut = graph.addNode (new IOProcessor (IOProcessor::midiOutputNode));
+
+        const int numMidiNodes  = jmax (1, numNodes / 8);
+        const int numAudioNodes = jmax (1, numNodes - numMidiNodes - 1);
+        Random random (numNodes * 31 + fanOut * 7 + fanIn);
+
+        Array<uint32> previousLayer, layer;
+        previousLayer.add (input->nodeId);
+
+        for (int i = 0; i < numAudioNodes; ++i)
+        {
+            GraphNodePtr node = createAudioNode (i);
+            layer.add (node->nodeId);
+
+            const int numSources = jmin (fanIn, previousLayer.size());
+            const int offset = random.nextInt (previousLayer.size());
+            for (int s = 0; s < numSources; ++s)
+                connectStereo (previousLayer [(offset + s) % previousLayer.size()], node->nodeId);
+
+            if (layer.size() >= fanOut && i < numAudioNodes - 1)
+            {
+                previousLayer.swapWith (layer);
+                layer.clearQuick();
+            }
+        }
+
+        auto* const mixer = new AudioMixerProcessor (layer.size(), benchSampleRate, blockSize);
+        GraphNodePtr mix = graph.addNode (mixer);
+        for (int i = 0; i < layer.size(); ++i)
+            for (int ch = 0; ch < 2; ++ch)
+                graph.connectChannels (PortType::Audio, layer.getUnchecked (i), ch, mix->nodeId, i * 2 + ch);
+        connectStereo (mix->nodeId, output->nodeId);
+
+        uint32 previousMidi = midiIn->nodeId;
+        for (int i = 0; i < numMidiNodes; ++i)
+        {
+            GraphNodePtr node = graph.addNode (new MidiChannelMapProcessor());
+            graph.connectChannels (PortType::Midi, previousMidi, 0, node->nodeId, 0);
+            previousMidi = node->nodeId;
+        }
+        graph.connectChannels (PortType::Midi, previousMidi, 0, midiOut->nodeId, 0);
+    }
+
+    ~SyntheticGraph()
+    {
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    GraphProcessor graph;
+
+private:
+    GraphNodePtr createAudioNode (const int index)
+    {
+        switch (index % 5)
+        {
+            case 0:  return graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            case 1:  return graph.addNode (new CombFilterProcessor (true));
+            case 2:  return graph.addNode (new AllPassFilterProcessor (true));
+            case 3:  return graph.addNode (new ReverbProcessor());
+            default: break;
+        }
+
+        return graph.addNode (new AudioRouterNode (2, 2));
+    }
+
+    void connectStereo (const uint32 source, const uint32 dest)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+            graph.connectChannels (PortType::Audio, source, ch, dest, ch);
+    }
+};
+
+static var createGraphParams (const int numNodes, const int fanOut, const int fanIn,
+                              const int blockSize, const bool multiCore)
+{
+    DynamicObject::Ptr params = new DynamicObject();
+    params->setProperty ("nodes", numNodes);
+    params->setProperty ("fanOut", fanOut);
+    params->setProperty ("fanIn", fanIn);
+    params->setProperty ("blockSize", blockSize);
+    params->setProperty ("multiCore", multiCore);
+    return var (params.get());
+}
+
+static double elapsedNanos (const int64 startTicks)
+{
+    return 1.0e9 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+}
+
+/** Nanoseconds per GraphProcessor::processBlock */
+class ProcessBlockBenchmark : public Benchmark
+{
+public:
+    ProcessBlockBenchmark() : Benchmark ("processBlock") { }
+
+    void run (BenchmarkRunner& runner) override
+    {
+        const auto& options = runner.getOptions();
+        for (const int numNodes : options.nodeCounts)
+            for (const int fanOut : options.fanOuts)
+                for (const int fanIn : options.fanIns)
+                    for (const int blockSize : options.blockSizes)
+                        measure (runner, numNodes, fanOut, fanIn, blockSize);
+    }
+
+private:
+    static const int numWarmupBlocks = 50;
+
+    void measure (BenchmarkRunner& runner, const int numNodes, const int fanOut,
+                  const int fanIn, const int blockSize)
+    {
+        const auto& options = runner.getOptions();
+        const int64 memoryBefore = BenchmarkRunner::getResidentMemory();
+
+        SyntheticGraph synth (numNodes, fanOut, fanIn, blockSize);
+        auto& graph = synth.graph;
+        graph.setMultiCoreRendering (options.multiCore);
+        graph.prepareToPlay (benchSampleRate, blockSize);
+
+        AudioSampleBuffer noise (2, blockSize), block (2, blockSize);
+        Random random (blockSize);
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < blockSize; ++s)
+                noise.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+
+        MidiBuffer midi;
+        Array<double> nanos;
+        nanos.ensureStorageAllocated (options.numBlocks);
+
+        for (int b = 0; b < numWarmupBlocks + options.numBlocks; ++b)
+        {
+            block.makeCopyOf (noise, true);
+            midi.clear();
+            midi.addEvent (MidiMessage::noteOn (1 + b % 16, 60, 1.f), 0);
+            midi.addEvent (MidiMessage::noteOff (1 + b % 16, 60), blockSize - 1);
+
+            const int64 start = Time::getHighResolutionTicks();
+            graph.processBlock (block, midi);
+            if (b >= numWarmupBlocks)
+                nanos.add (elapsedNanos (start));
+        }
+
+        const var metrics = BenchmarkRunner::summarize (nanos);
+        if (auto* const object = metrics.getDynamicObject())
+        {
+            const double mean = object->getProperty ("meanNs");
+            const double budget = 1.0e9 * (double) blockSize / benchSampleRate;
+            object->setProperty ("nsPerNode", mean / (double) graph.getNumNodes());
+            object->setProperty ("cpuLoad", mean / budget);
+            object->setProperty ("latencySamples", graph.getLatencySamples());
+            object->setProperty ("bufferBytes", graph.getBufferFootprint().getTotalBytes());
+            if (memoryBefore >= 0)
+                object->setProperty ("residentBytesAdded", BenchmarkRunner::getResidentMemory() - memoryBefore);
+        }
+
+        runner.addResult (createGraphParams (numNodes, fanOut, fanIn, blockSize, options.multiCore), metrics);
+    }
+};
+
+static ProcessBlockBenchmark sProcessBlockBenchmark;
+
+}
@@ -0,0 +1,91 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bench/Benchmark.h"
+#include "engine/GraphProcessor.h"
+#include "engine/nodes/PlaceholderProcessor.h"
+
+namespace Element {
+
+/** Time taken to compile the rendering sequence of a random graph. The nodes
+    do nothing, so this measures the compile and not the nodes preparing.
+    Each node takes its input from fanIn of the nodes before it */
+class GraphBuildBenchmark : public Benchmark
+{
+public:
+    GraphBuildBenchmark() : Benchmark ("rebuild") { }
+
+    void run (BenchmarkRunner& runner) override
+    {
+        const auto& options = runner.getOptions();
+        for (const int numNodes : options.nodeCounts)
+            for (const int fanIn : options.fanIns)
+                measure (runner, numNodes, fanIn, options.blockSizes.getFirst());
+    }
+
+private:
+    void measure (BenchmarkRunner& runner, const int numNodes, const int fanIn, const int blockSize)
+    {
+        const auto& options = runner.getOptions();
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.setMultiCoreRendering (options.multiCore);
+        Random random (numNodes);
+        Array<uint32> ids;
+
+        for (int i = 0; i < numNodes; ++i)
+        {
+            GraphNodePtr node = graph.addNode (new PlaceholderProcessor (2, 2, false, false));
+            ids.add (node->nodeId);
+
+            for (int s = 0; i > 0 && s < fanIn; ++s)
+            {
+                const uint32 source = ids [random.nextInt (i)];
+                for (int ch = 0; ch < 2; ++ch)
+                    graph.connectChannels (PortType::Audio, source, ch, node->nodeId, ch);
+            }
+        }
+
+        Array<double> nanos;
+        for (int i = 0; i < options.numRebuilds; ++i)
+        {
+            // prepareToPlay rebuilds synchronously
+            const int64 start = Time::getHighResolutionTicks();
+            graph.prepareToPlay (44100.0, blockSize);
+            nanos.add (1.0e9 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+            graph.releaseResources();
+        }
+
+        DynamicObject::Ptr params = new DynamicObject();
+        params->setProperty ("nodes", numNodes);
+        params->setProperty ("fanIn", fanIn);
+        params->setProperty ("blockSize", blockSize);
+        params->setProperty ("multiCore", options.multiCore);
+
+        const var metrics = BenchmarkRunner::summarize (nanos);
+        if (auto* const object = metrics.getDynamicObject())
+            object->setProperty ("connections", graph.getNumConnections());
+
+        runner.addResult (var (params.get()), metrics);
+        graph.clear();
+    }
+};
+
+static GraphBuildBenchmark sGraphBuildBenchmark;
+
+}
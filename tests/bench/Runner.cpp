@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "bench/Benchmark.h"
+
+using namespace Element;
+
+static Array<int> parseIntList (const String& list)
+{
+    Array<int> values;
+    for (const auto& token : StringArray::fromTokens (list, ",", String()))
+        if (token.trim().getIntValue() > 0)
+            values.add (token.trim().getIntValue());
+    return values;
+}
+
+static void printUsage()
+{
+    Logger::writeToLog ("usage: bench-element [options] [benchmark]");
+    Logger::writeToLog ("  --nodes=16,64,256        node counts of the synthetic graphs");
+    Logger::writeToLog ("  --fan-out=1,4            nodes per layer");
+    Logger::writeToLog ("  --fan-in=1,2             sources summed into each node");
+    Logger::writeToLog ("  --block-sizes=64,256     host block sizes");
+    Logger::writeToLog ("  --blocks=2000            timed blocks per configuration");
+    Logger::writeToLog ("  --rebuilds=10            timed rebuilds per configuration");
+    Logger::writeToLog ("  --multi-core             render graphs on the render pool");
+    Logger::writeToLog ("  --output=FILE            where to write results, default bench-element.json");
+    String names = "benchmarks:";
+    for (auto* const benchmark : Benchmark::getAllBenchmarks())
+        names << " " << benchmark->getName();
+    Logger::writeToLog (names);
+}
+
+int main (int argc, char** argv)
+{
+    MessageManager::getInstance();
+    juce::initialiseJuce_GUI();
+
+    BenchmarkOptions options;
+    options.outputFile = File::getCurrentWorkingDirectory().getChildFile ("bench-element.json");
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const String arg (String::fromUTF8 (argv[i]));
+        const String name  = arg.upToFirstOccurrenceOf ("=", false, false);
+        const String value = arg.fromFirstOccurrenceOf ("=", false, false);
+        Array<int> values = parseIntList (value);
+
+        if (name == "--nodes" && values.size() > 0)
+            options.nodeCounts = values;
+        else if (name == "--fan-out" && values.size() > 0)
+            options.fanOuts = values;
+        else if (name == "--fan-in" && values.size() > 0)
+            options.fanIns = values;
+        else if (name == "--block-sizes" && values.size() > 0)
+            options.blockSizes = values;
+        else if (name == "--blocks" && values.size() > 0)
+            options.numBlocks = values.getFirst();
+        else if (name == "--rebuilds" && values.size() > 0)
+            options.numRebuilds = values.getFirst();
+        else if (name == "--multi-core")
+            options.multiCore = true;
+        else if (name == "--output" && value.isNotEmpty())
+            options.outputFile = File::getCurrentWorkingDirectory().getChildFile (value.unquoted());
+        else if (! arg.startsWith ("-"))
+            options.filter = arg;
+        else
+        {
+            printUsage();
+            juce::shutdownJuce_GUI();
+            return 1;
+        }
+    }
+
+    BenchmarkRunner runner (options);
+    runner.runAll();
+
+    const bool written = options.outputFile.replaceWithText (JSON::toString (runner.createReport()));
+    Logger::writeToLog ((written ? "results written to: " : "could not write: ")
+                            + options.outputFile.getFullPathName());
+
+    juce::shutdownJuce_GUI();
+    return written ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "bench/Benchmark.h"
+#include "controllers/AppController.h"
+#include "controllers/EngineController.h"
+#include "controllers/SessionController.h"
+#include "engine/AudioEngine.h"
+#include "engine/InternalFormat.h"
+#include "engine/nodes/BaseProcessor.h"
+#include "session/Node.h"
+#include "session/PluginManager.h"
+#include "session/Session.h"
+#include "Globals.h"
+#include "Settings.h"
+
+namespace Element {
+
+/** Time and memory used to load and save sessions with a chain of
+    internal nodes, running the controllers headless */
+class SessionBenchmark : public Benchmark
+{
+public:
+    SessionBenchmark() : Benchmark ("session") { }
+
+    void run (BenchmarkRunner& runner) override
+    {
+        initializeWorld();
+        for (const int numNodes : runner.getOptions().nodeCounts)
+            measure (runner, numNodes);
+        shutdownWorld();
+    }
+
+private:
+    std::unique_ptr<Globals> world;
+    std::unique_ptr<AppController> app;
+
+    void initializeWorld()
+    {
+        world.reset (new Globals ("--headless"));
+        world->setEngine (new AudioEngine (*world));
+        world->getPluginManager().addDefaultFormats();
+        world->getPluginManager().addFormat (new ElementAudioPluginFormat (*world));
+        world->getPluginManager().addFormat (new InternalFormat (*world->getAudioEngine(), world->getMidiEngine()));
+        app.reset (new AppController (*world));
+        app->activate();
+        auto& settings = world->getSettings();
+        PropertiesFile::Options opts = settings.getStorageParameters();
+        opts.applicationName = "ElementBench";
+        settings.setStorageParameters (opts);
+        settings.setCheckForUpdates (false);
+    }
+
+    void shutdownWorld()
+    {
+        app->deactivate();
+        app.reset (nullptr);
+        world->setEngine (nullptr);
+        world.reset (nullptr);
+    }
+
+    PluginDescription findDescription (const String& identifier) const
+    {
+        OwnedArray<PluginDescription> types;
+        if (auto* const format = world->getPluginManager().getAudioPluginFormat ("Element"))
+            format->findAllTypesForFile (types, identifier);
+        return types.size() > 0 ? *types.getLast() : PluginDescription();
+    }
+
+    void measure (BenchmarkRunner& runner, const int numNodes)
+    {
+        auto* const sc = app->findChild<SessionController>();
+        auto* const ec = app->findChild<EngineController>();
+        auto session = world->getSession();
+
+        const StringArray identifiers { "element.volume", "element.comb", "element.allPass",
+                                        EL_INTERNAL_ID_REVERB, EL_INTERNAL_ID_AUDIO_ROUTER,
+                                        EL_INTERNAL_ID_MIDI_CHANNEL_MAP };
+        Array<PluginDescription> types;
+        for (const auto& identifier : identifiers)
+            types.add (findDescription (identifier));
+
+        sc->openDefaultSession();
+        const Node graph (session->getCurrentGraph());
+        Node previous;
+        for (int i = 0; i < numNodes; ++i)
+        {
+            const Node node (ec->addPlugin (graph, types.getReference (i % types.size()), ConnectionBuilder(), true));
+            if (! node.isValid())
+                continue;
+            if (previous.isValid())
+                for (int ch = 0; ch < 2; ++ch)
+                    ec->connectChannels (previous.getNodeId(), ch, node.getNodeId(), ch);
+            previous = node;
+        }
+
+        const File file (File::getSpecialLocation (File::tempDirectory)
+            .getChildFile ("bench-element-" + String (numNodes) + ".els"));
+        session->saveGraphState();
+        if (ScopedPointer<XmlElement> xml = session->createXml())
+            xml->writeToFile (file, String());
+        sc->resetChanges();
+
+        Array<double> loadNanos, saveNanos;
+        int64 residentBytesAdded = -1;
+
+        for (int i = 0; i < jmax (1, runner.getOptions().numRebuilds); ++i)
+        {
+            const int64 memoryBefore = BenchmarkRunner::getResidentMemory();
+            int64 start = Time::getHighResolutionTicks();
+            sc->openFile (file);
+            loadNanos.add (1.0e9 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+            if (i == 0 && memoryBefore >= 0)
+                residentBytesAdded = BenchmarkRunner::getResidentMemory() - memoryBefore;
+
+            // let the graphs compile before saving
+            MessageManager::getInstance()->runDispatchLoopUntil (20);
+
+            start = Time::getHighResolutionTicks();
+            sc->saveSession (false);
+            saveNanos.add (1.0e9 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+        }
+
+        DynamicObject::Ptr params = new DynamicObject();
+        params->setProperty ("nodes", numNodes);
+
+        DynamicObject::Ptr metrics = new DynamicObject();
+        metrics->setProperty ("load", BenchmarkRunner::summarize (loadNanos));
+        metrics->setProperty ("save", BenchmarkRunner::summarize (saveNanos));
+        metrics->setProperty ("fileBytes", file.getSize());
+        metrics->setProperty ("residentBytesAdded", residentBytesAdded);
+        runner.addResult (var (params.get()), var (metrics.get()));
+
+        sc->resetChanges (true);
+        file.deleteFile();
+    }
+};
+
+static SessionBenchmark sSessionBenchmark;
+
+}
@@ -0,0 +1,92 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "controllers/GraphLoadPolicy.h"
+
+namespace Element {
+
+class GraphLoadPolicyTest : public UnitTestBase
+{
+public:
+    GraphLoadPolicyTest() : UnitTestBase ("Graph Load Policy", "controllers", "graphLoadPolicy") { }
+    virtual ~GraphLoadPolicyTest() { }
+
+    void runTest() override
+    {
+        typedef GraphLoadPolicy::Graph Graph;
+        const int64 megabyte = 1024 * 1024;
+
+        // programs 20, 5, none, 10, none, 1
+        Array<Graph> graphs;
+        for (const int program : { 20, 5, -1, 10, -1, 1 })
+        {
+            Graph graph;
+            graph.midiProgram = program;
+            graphs.add (graph);
+        }
+
+        beginTest ("program order");
+        const auto order = GraphLoadPolicy::getProgramOrder (graphs);
+        expect (order == Array<int> ({ 5, 1, 3, 0, 2, 4 }));
+
+        GraphLoadPolicy policy;
+        policy.setNumNeighbours (1);
+
+        beginTest ("neighbours in program order");
+        expect (policy.findNeighbours (graphs, 3) == Array<int> ({ 0, 1 }));
+        expect (policy.findNeighbours (graphs, 5) == Array<int> ({ 1 }));
+
+        beginTest ("prefetch skips loaded graphs and respects the budget");
+        graphs.getReference(3).loaded = true;
+        graphs.getReference(3).memoryBytes = 100 * megabyte;
+        graphs.getReference(0).loaded = true;
+        graphs.getReference(0).memoryBytes = 100 * megabyte;
+        expect (policy.findGraphsToPrefetch (graphs, 3) == Array<int> ({ 1 }));
+        policy.setMemoryBudget (150 * megabyte);
+        expect (policy.findGraphsToPrefetch (graphs, 3).isEmpty());
+
+        beginTest ("least recently used graphs are unloaded first");
+        policy.setMemoryBudget (250 * megabyte);
+        for (const int index : { 2, 4, 5 })
+        {
+            graphs.getReference(index).loaded = true;
+            graphs.getReference(index).memoryBytes = 50 * megabyte;
+        }
+        graphs.getReference(2).lastUsed = 3;
+        graphs.getReference(4).lastUsed = 1;
+        graphs.getReference(5).lastUsed = 2;
+        graphs.getReference(0).lastUsed = 4;
+        graphs.getReference(3).lastUsed = 5;
+        // loaded: 100 + 100 + 50 * 3 = 350, the active graph 3 and its neighbour 0 stay
+        expect (policy.findGraphsToUnload (graphs, 3) == Array<int> ({ 4, 5 }));
+
+        beginTest ("pinned graphs stay loaded");
+        graphs.getReference(4).pinned = true;
+        expect (policy.findGraphsToUnload (graphs, 3) == Array<int> ({ 5, 2 }));
+
+        beginTest ("no budget never unloads");
+        policy.setMemoryBudget (0);
+        expect (policy.findGraphsToUnload (graphs, 3).isEmpty());
+    }
+};
+
+static GraphLoadPolicyTest sGraphLoadPolicyTest;
+
+}
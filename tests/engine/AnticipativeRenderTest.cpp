@@ -0,0 +1,190 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/BaseProcessor.h"
+
+namespace Element {
+
+/** Outputs a ramp which doesn't depend on any input */
+class RampProcessor : public BaseProcessor
+{
+public:
+    RampProcessor()                         { setPlayConfigDetails (0, 2, 44100.0, 512); }
+    const String getName() const override   { return "Ramp"; }
+
+    void fillInPluginDescription (PluginDescription& desc) const override
+    {
+        desc.name = getName();
+        desc.fileOrIdentifier = "element.test.ramp";
+        desc.numInputChannels = 0;
+        desc.numOutputChannels = 2;
+    }
+
+    void prepareToPlay (double sampleRate, int blockSize) override
+    {
+        setPlayConfigDetails (0, 2, sampleRate, blockSize);
+    }
+
+    void releaseResources() override { }
+
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+    {
+        for (int s = 0; s < buffer.getNumSamples(); ++s, ++position)
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                buffer.setSample (c, s, (float) (position % 1000) / 1000.f);
+        midi.clear();
+    }
+
+    double getTailLengthSeconds() const override            { return 0.0; }
+    bool acceptsMidi() const override                       { return false; }
+    bool producesMidi() const override                      { return false; }
+    AudioProcessorEditor* createEditor() override           { return nullptr; }
+    bool hasEditor() const override                         { return false; }
+    int getNumPrograms() override                           { return 1; }
+    int getCurrentProgram() override                        { return 0; }
+    void setCurrentProgram (int) override                   { }
+    const String getProgramName (int) override              { return String(); }
+    void changeProgramName (int, const String&) override    { }
+    void getStateInformation (MemoryBlock&) override        { }
+    void setStateInformation (const void*, int) override    { }
+
+private:
+    int64 position = 0;
+};
+
+class AnticipativeRenderTest : public UnitTestBase
+{
+public:
+    AnticipativeRenderTest() : UnitTestBase ("Anticipative Rendering", "engine", "renderAhead") { }
+    virtual ~AnticipativeRenderTest() { }
+
+    void runTest() override
+    {
+        beginTest ("rendering ahead doesn't change the output");
+        AudioSampleBuffer live, ahead;
+        Counts liveCounts, aheadCounts;
+        const int latency = render (live, false, -1, false, liveCounts);
+        expectEquals (liveCounts.missed, (int64) 0);
+        expectEquals (liveCounts.rendered, (int64) 0);
+        expectEquals (render (ahead, true, -1, false, aheadCounts), latency);
+        expect (aheadCounts.rendered > 0, "nothing was rendered ahead");
+        // only the first block, before the ahead thread was woken
+        expect (aheadCounts.missed <= 1, "the ahead thread fell behind");
+        expectIdentical (live, ahead);
+
+        beginTest ("recompiling keeps what was rendered ahead");
+        // a new sequence starts the live branch's latency compensation over,
+        // so only the branch rendered ahead is heard
+        AudioSampleBuffer liveQuiet, aheadRecompiled;
+        render (liveQuiet, false, -1, true, liveCounts);
+        expect (liveQuiet.getMagnitude (0, liveQuiet.getNumSamples()) > 0.f, "nothing was rendered");
+        render (aheadRecompiled, true, numBlocks / 2, true, aheadCounts);
+        expect (aheadCounts.rendered > 0, "nothing was rendered ahead");
+        expect (aheadCounts.missed <= 1, "the ahead thread fell behind");
+        expectIdentical (liveQuiet, aheadRecompiled);
+    }
+
+private:
+    static const int blockSize = 128;
+    static const int numBlocks = 32;
+    static const int numBlocksAhead = 4;    // as many as the graph buffers
+
+    struct Counts
+    {
+        int64 missed = 0, rendered = 0;
+    };
+
+    void expectIdentical (const AudioSampleBuffer& live, const AudioSampleBuffer& ahead)
+    {
+        bool identical = live.getNumSamples() == ahead.getNumSamples();
+        for (int c = 0; identical && c < live.getNumChannels(); ++c)
+            identical = 0 == memcmp (live.getReadPointer (c), ahead.getReadPointer (c),
+                                     sizeof (float) * (size_t) live.getNumSamples());
+        expect (identical, "output rendered ahead differs from live output");
+    }
+
+    /** Renders the test graph, recompiling it before recompileBlock if that
+        isn't negative. Returns the graph's latency */
+    int render (AudioSampleBuffer& result, const bool renderAhead, const int recompileBlock,
+                const bool silentInput, Counts& counts)
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.setAnticipativeRendering (renderAhead);
+
+        // the ramp and the latent volume after it don't need live input
+        auto* const latentVolume = new VolumeProcessor (-60.0, 12.0, true);
+        latentVolume->setLatencySamples (37);
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr ramp   = graph.addNode (new RampProcessor());
+        GraphNodePtr latent = graph.addNode (latentVolume);
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        ramp->connectAudioTo (latent);
+        latent->connectAudioTo (output);
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+        graph.resetNodeBlockCounts();
+
+        Random random (4321);
+        result.setSize (2, blockSize * numBlocks);
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            // compiles a new sequence, which the next block swaps in
+            if (b == recompileBlock)
+                graph.prepareToPlay (44100.0, blockSize);
+
+            for (int c = 0; c < 2; ++c)
+                for (int s = 0; s < blockSize; ++s)
+                    block.setSample (c, s, silentInput ? 0.f : random.nextFloat() * 2.f - 1.f);
+            midi.clear();
+
+            AllocationCounter::reset();
+            graph.processBlock (block, midi);
+            expectRealtimeSafe();
+
+            for (int c = 0; c < 2; ++c)
+                result.copyFrom (c, b * blockSize, block, c, 0, blockSize);
+
+            // give the ahead thread time to fill its buffers again, so the
+            // device callback never has to render them itself
+            const int64 produced = b + 1 + numBlocksAhead;
+            for (int i = 0; renderAhead && i < 1000 && graph.getNumAheadBlocksRendered()
+                                                    + graph.getNumAheadBlocksMissed() < produced; ++i)
+                Thread::sleep (1);
+        }
+
+        counts.missed = graph.getNumAheadBlocksMissed();
+        counts.rendered = graph.getNumAheadBlocksRendered();
+        const int latency = graph.getLatencySamples();
+        input = output = ramp = latent = volume = nullptr;
+        graph.releaseResources();
+        graph.clear();
+        return latency;
+    }
+};
+
+static AnticipativeRenderTest sAnticipativeRenderTest;
+
+}
@@ -0,0 +1,88 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+
+namespace Element {
+
+class BufferAssignmentTest : public UnitTestBase
+{
+public:
+    BufferAssignmentTest() : UnitTestBase ("Buffer Assignment", "engine", "buffers") { }
+    virtual ~BufferAssignmentTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        // a long chain of unity gain nodes with a parallel branch at each step
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr last = input;
+        for (int i = 0; i < chainLength; ++i)
+        {
+            GraphNodePtr node   = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            GraphNodePtr branch = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            last->connectAudioTo (node);
+            last->connectAudioTo (branch);
+            branch->connectAudioTo (node);
+            last = node;
+        }
+        last->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("buffers are shared between values that don't overlap");
+        const auto footprint = graph.getBufferFootprint();
+        expect (footprint.numAudioBuffers > 0);
+        expect (footprint.numAudioBuffers <= footprint.numAudioBuffersBuilt);
+        expect (footprint.numAudioBuffers < chainLength);
+        expectEquals (footprint.blockSize, blockSize);
+        expect (footprint.audioBytes >= (int64) (footprint.numAudioBuffers * blockSize * sizeof (float)));
+        logMessage (String ("audio buffers: ") + String (footprint.numAudioBuffers)
+                    + " built: " + String (footprint.numAudioBuffersBuilt)
+                    + " bytes: " + String (footprint.getTotalBytes()));
+
+        beginTest ("shared buffers render the same signal");
+        // every step doubles the signal
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+        block.clear();
+        block.setSample (0, 0, 1.f);
+        block.setSample (1, 1, 1.f);
+        graph.processBlock (block, midi);
+        const float expected = (float) (1 << chainLength);
+        expectWithinAbsoluteError (block.getSample (0, 0), expected, 0.001f);
+        expectWithinAbsoluteError (block.getSample (1, 1), expected, 0.001f);
+        expectEquals (block.getSample (0, 1), 0.f);
+        expectEquals (block.getSample (1, 0), 0.f);
+
+        input = output = last = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 128;
+    static const int chainLength = 12;
+};
+
+static BufferAssignmentTest sBufferAssignmentTest;
+
+}
@@ -0,0 +1,92 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/CallbackTelemetry.h"
+
+namespace Element {
+
+class CallbackTelemetryTest : public UnitTestBase
+{
+public:
+    CallbackTelemetryTest() : UnitTestBase ("Callback Telemetry", "engine", "callbackTelemetry") { }
+    virtual ~CallbackTelemetryTest() { }
+
+    void runTest() override
+    {
+        CallbackTelemetry telemetry;
+
+        beginTest ("quick callbacks");
+        for (int i = 0; i < numQuick; ++i)
+            callback (telemetry, 0, 0);
+        auto stats = telemetry.getStats();
+        expect (stats.numCallbacks == numQuick);
+        expect (stats.numOverruns == 0);
+        expect (stats.meanLoad <= stats.maxLoad);
+        expect (stats.p99Load <= stats.maxLoad);
+
+        int inHistogram = 0;
+        for (const int count : stats.histogram)
+            inHistogram += count;
+        expectEquals (inHistogram, numQuick);
+
+        beginTest ("a slow callback is counted and kept with its events");
+        callback (telemetry, 4 * periodMillis, CallbackTelemetry::sequenceSwapped);
+        stats = telemetry.getStats();
+        expect (stats.numCallbacks == numQuick + 1);
+        expect (stats.numOverruns == 1);
+        expect (stats.maxLoad > 100.0);
+        expect (stats.worstBlocks.size() > 0);
+        const auto worst = stats.worstBlocks.getFirst();
+        expect (worst.load > 100.f);
+        expect (worst.graphLoad > 100.f);
+        expectEquals (worst.events, (int) CallbackTelemetry::sequenceSwapped);
+        expect (worst.toString().contains ("sequence swap"));
+
+        beginTest ("reset");
+        telemetry.reset();
+        expect (telemetry.getStats().numCallbacks == 0);
+        callback (telemetry, 0, 0);
+        stats = telemetry.getStats();
+        expect (stats.numCallbacks == 1);
+        expect (stats.numOverruns == 0);
+    }
+
+private:
+    static const int numQuick = 32;
+    static const int numSamples = 512;
+    static const int periodMillis = 12;   // 512 samples at 44.1 kHz is about 11.6 ms
+
+    void callback (CallbackTelemetry& telemetry, const int graphMillis, const int events)
+    {
+        const int64 start = telemetry.callbackStarted();
+        if (graphMillis > 0)
+        {
+            const int64 graphStart = Time::getHighResolutionTicks();
+            Thread::sleep (graphMillis);
+            telemetry.addGraphTicks (Time::getHighResolutionTicks() - graphStart);
+        }
+        telemetry.addEvents (events);
+        telemetry.callbackFinished (start, numSamples, 44100.0);
+    }
+};
+
+static CallbackTelemetryTest sCallbackTelemetryTest;
+
+}
@@ -0,0 +1,183 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/AllocationCounter.h"
+#include "engine/FixedMidiBuffer.h"
+#include "engine/nodes/MidiChannelSplitterNode.h"
+
+namespace Element {
+
+class FixedMidiBufferTest : public UnitTestBase
+{
+public:
+    FixedMidiBufferTest() : UnitTestBase ("Fixed MIDI Buffers", "engine", "fixedMidi") { }
+    virtual ~FixedMidiBufferTest() { }
+
+    void runTest() override
+    {
+        testOverflow();
+        testCopy();
+        testMerge();
+        testGraphRender();
+    }
+
+private:
+    void testOverflow()
+    {
+        beginTest ("full buffers drop events instead of growing");
+        MidiBuffer buffer;
+        FixedMidiBuffer::reserve (buffer);
+        FixedMidiBuffer::resetNumDroppedEvents();
+        const auto note = MidiMessage::noteOn (1, 60, 1.f);
+
+        const int eventSize = FixedMidiBuffer::getEventSize (3);
+        const int numThatFit = FixedMidiBuffer::capacity / eventSize;
+        int numAdded = 0;
+        AllocationCounter::reset();
+        {
+            const AllocationCounter::ScopedRender rendering;
+            for (int i = 0; i < numThatFit + 10; ++i)
+                if (FixedMidiBuffer::addEvent (buffer, note, i))
+                    ++numAdded;
+        }
+
+        expectRealtimeSafe();
+        expectEquals (numAdded, numThatFit);
+        expectEquals (buffer.getNumEvents(), numThatFit);
+        expectEquals (FixedMidiBuffer::getNumBytesUsed (buffer), numThatFit * eventSize);
+        expectEquals (FixedMidiBuffer::getNumDroppedEvents(), (int64) 10);
+        FixedMidiBuffer::resetNumDroppedEvents();
+    }
+
+    void testCopy()
+    {
+        beginTest ("copy reuses storage");
+        MidiBuffer source, dest;
+        FixedMidiBuffer::reserve (dest);
+        for (int i = 0; i < 100; ++i)
+            source.addEvent (MidiMessage::controllerEvent (1, 7, i), i);
+
+        AllocationCounter::reset();
+        {
+            const AllocationCounter::ScopedRender rendering;
+            FixedMidiBuffer::copy (dest, source);
+        }
+
+        expectRealtimeSafe();
+        expect (haveSameEvents (dest, source), "copied events differ");
+    }
+
+    void testMerge()
+    {
+        beginTest ("merge matches addEvents");
+        Random random (4321);
+        MidiBuffer sources [5];
+        MidiBuffer expected, merged;
+        FixedMidiBuffer::reserve (merged);
+        FixedMidiBuffer::Reader readers [5];
+
+        for (int i = 0; i < 5; ++i)
+        {
+            for (int e = 0; e < 40; ++e)
+                sources[i].addEvent (MidiMessage::noteOn (i + 1, e, 1.f), random.nextInt (64));
+            expected.addEvents (sources[i], 0, -1, 0);
+            readers[i].reset (sources[i]);
+        }
+
+        FixedMidiBuffer::merge (merged, readers, 5);
+        expectEquals (merged.getNumEvents(), 200);
+        expect (haveSameEvents (merged, expected), "merged events are out of order");
+    }
+
+    void testGraphRender()
+    {
+        beginTest ("graph renders MIDI without allocating");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (0, 0, 44100.0, blockSize);
+
+        GraphNodePtr midiIn = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::midiInputNode));
+        GraphNodePtr midiOut = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::midiOutputNode));
+        GraphNodePtr splitter = graph.addNode (new MidiChannelSplitterNode());
+
+        // the output mixes the direct input with every channel of the splitter
+        graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, splitter->nodeId, 0);
+        graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, midiOut->nodeId, 0);
+        for (int ch = 0; ch < 16; ++ch)
+            graph.connectChannels (PortType::Midi, splitter->nodeId, ch, midiOut->nodeId, 0);
+
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioSampleBuffer audio (1, blockSize);
+        MidiBuffer midi;
+        FixedMidiBuffer::reserve (midi);
+        Random random (1234);
+        bool ordered = true, complete = true;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            // the first block is rendered before counting starts
+            if (b == 1)
+                AllocationCounter::reset();
+
+            midi.clear();
+            for (int e = 0; e < 32; ++e)
+                midi.addEvent (MidiMessage::noteOn (1 + random.nextInt (16), 60, 1.f),
+                               random.nextInt (blockSize));
+
+            graph.processBlock (audio, midi);
+
+            complete &= midi.getNumEvents() == 64;
+            int lastFrame = 0;
+            for (FixedMidiBuffer::Reader reader (midi); ! reader.isDone(); reader.next())
+            {
+                ordered &= reader.getTime() >= lastFrame;
+                lastFrame = reader.getTime();
+            }
+        }
+
+        expect (complete, "events went missing");
+        expect (ordered, "events are out of order");
+        expectEquals (FixedMidiBuffer::getNumDroppedEvents(), (int64) 0);
+        expectRealtimeSafe();
+
+        midiIn = midiOut = splitter = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    static bool haveSameEvents (const MidiBuffer& a, const MidiBuffer& b)
+    {
+        FixedMidiBuffer::Reader ra (a), rb (b);
+        for (; ! ra.isDone() && ! rb.isDone(); ra.next(), rb.next())
+            if (ra.getTime() != rb.getTime() || ra.getNumBytes() != rb.getNumBytes()
+                 || memcmp (ra.getData(), rb.getData(), (size_t) ra.getNumBytes()) != 0)
+                return false;
+        return ra.isDone() && rb.isDone();
+    }
+
+    static const int blockSize = 256;
+    static const int numBlocks = 16;
+};
+
+static FixedMidiBufferTest sFixedMidiBufferTest;
+
+}
@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+
+namespace Element {
+
+class GraphHibernationTest : public UnitTestBase
+{
+public:
+    GraphHibernationTest() : UnitTestBase ("Graph Hibernation", "engine", "hibernation") { }
+    virtual ~GraphHibernationTest() { }
+
+    void runTest() override
+    {
+        AudioEnginePtr engine = new AudioEngine (getWorld());
+        OwnedArray<RootGraph> graphs;
+        for (int i = 0; i < 2; ++i)
+        {
+            auto* const graph = graphs.add (new RootGraph());
+            graph->setRenderMode (RootGraph::SingleGraph);
+            engine->addGraph (graph);
+        }
+
+        engine->prepareExternalPlayback (44100.0, blockSize, 2, 2);
+
+        beginTest ("inactive graph hibernates once silent");
+        render (*engine, numBlocksPerSecond);
+        expect (! graphs[0]->isHibernating());
+        expect (graphs[1]->isHibernating());
+
+        beginTest ("switching wakes the target graph");
+        engine->setActiveGraph (1);
+        render (*engine, 1);
+        expect (! graphs[1]->isHibernating());
+
+        beginTest ("previous graph hibernates after the switch");
+        render (*engine, numBlocksPerSecond);
+        expect (graphs[0]->isHibernating());
+        expect (! graphs[1]->isHibernating());
+
+        engine->releaseExternalResources();
+        for (auto* const graph : graphs)
+            engine->removeGraph (graph);
+    }
+
+private:
+    static const int blockSize = 512;
+    static const int numBlocksPerSecond = 44100 / blockSize;
+
+    void render (AudioEngine& engine, const int numBlocks)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            audio.clear();
+            midi.clear();
+            engine.processExternalBuffers (audio, midi);
+        }
+    }
+};
+
+static GraphHibernationTest sGraphHibernationTest;
+
+}
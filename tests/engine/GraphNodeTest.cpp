@@ -240,6 +240,35 @@ public:
 
 static GetTypeStringTest sGetTypeStringTest;
 
+/** Test MIDI filter settings reach the render thread's snapshot */
+class MidiFilterSettingsTest : public GraphNodeTest
+{
+public:
+    MidiFilterSettingsTest() : GraphNodeTest ("Node MIDI Filter Settings", "midiFilter") { }
+    void runTest() override
+    {
+        GraphNodePtr node = graph->addNode (new PlaceholderProcessor (2, 2, true, false));
+
+        beginTest ("defaults");
+        expect (node->getMidiFilterSettings().isDefault());
+
+        beginTest ("publishes changes");
+        node->setKeyRange (36, 60);
+        node->setTransposeOffset (12);
+        const auto& settings = node->getMidiFilterSettings();
+        expect (! settings.isDefault());
+        expect (settings.keyRange == Range<int> (36, 60));
+        expect (settings.transposeOffset == 12);
+
+        beginTest ("back to defaults");
+        node->setKeyRange (0, 127);
+        node->setTransposeOffset (0);
+        expect (node->getMidiFilterSettings().isDefault());
+    }
+};
+
+static MidiFilterSettingsTest sMidiFilterSettingsTest;
+
 }
 
 }
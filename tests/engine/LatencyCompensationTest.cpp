@@ -0,0 +1,145 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class LatencyCompensationTest : public UnitTestBase
+{
+public:
+    LatencyCompensationTest() : UnitTestBase ("Latency Compensation", "engine", "latency") { }
+    virtual ~LatencyCompensationTest() { }
+
+    void runTest() override
+    {
+        testAudio();
+        testMidi();
+    }
+
+private:
+    static const int blockSize = 64;
+    static const int numBlocks = 4;
+    static const int latency = 100;
+
+    /** Reports latency but doesn't delay anything, and drops the MIDI going
+        through it so only the compensated path reaches the output */
+    class LatentMidiSink : public PlaceholderProcessor
+    {
+    public:
+        LatentMidiSink() : PlaceholderProcessor (2, 2, true, true) { setLatencySamples (latency); }
+        void processBlock (AudioBuffer<float>&, MidiBuffer& midi) override { midi.clear(); }
+    };
+
+    void testAudio()
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        // the input reaches the output directly and through a latent node
+        auto* const volume = new VolumeProcessor (-60.0, 12.0, true);
+        volume->setLatencySamples (latency);
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr latent = graph.addNode (volume);
+        input->connectAudioTo (latent);
+        latent->connectAudioTo (output);
+        input->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("direct path is delayed across blocks");
+        expectEquals (graph.getLatencySamples(), latency);
+
+        AudioSampleBuffer result (1, blockSize * numBlocks);
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            block.clear();
+            if (b == 0)
+                block.setSample (0, 0, 1.f);
+            midi.clear();
+            graph.processBlock (block, midi);
+            result.copyFrom (0, b * blockSize, block, 0, 0, blockSize);
+        }
+
+        expectWithinAbsoluteError (result.getSample (0, latency), 1.f, 0.0001f);
+        expectEquals (result.getMagnitude (0, 1, latency - 1), 0.f);
+        expectEquals (result.getMagnitude (0, latency + 1, result.getNumSamples() - latency - 1), 0.f);
+
+        input = output = latent = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    void testMidi()
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        // MIDI reaches the output directly, next to a latent node
+        GraphNodePtr midiIn  = graph.addNode (new IOProcessor (IOProcessor::midiInputNode));
+        GraphNodePtr midiOut = graph.addNode (new IOProcessor (IOProcessor::midiOutputNode));
+        GraphNodePtr latent  = graph.addNode (new LatentMidiSink());
+        graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, latent->nodeId, 0);
+        graph.connectChannels (PortType::Midi, latent->nodeId, 0, midiOut->nodeId, 0);
+        graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, midiOut->nodeId, 0);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("direct MIDI is delayed across blocks in order");
+
+        // events sharing a frame, at the end of a block and in the next one
+        struct Event { int time; int note; };
+        const Event events[] = { { 0, 60 }, { 10, 61 }, { 10, 62 }, { blockSize - 1, 63 }, { blockSize + 5, 64 } };
+        const int numEvents = numElementsInArray (events);
+
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+        Array<Event> received;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            block.clear();
+            midi.clear();
+            for (const auto& event : events)
+                if (event.time / blockSize == b)
+                    midi.addEvent (MidiMessage::noteOn (1, event.note, 1.f), event.time % blockSize);
+
+            graph.processBlock (block, midi);
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+                received.add ({ b * blockSize + frame, msg.getNoteNumber() });
+        }
+
+        expectEquals (received.size(), numEvents);
+        for (int i = 0; i < jmin (numEvents, received.size()); ++i)
+        {
+            expectEquals (received.getReference (i).time, events[i].time + latency);
+            expectEquals (received.getReference (i).note, events[i].note);
+        }
+
+        midiIn = midiOut = latent = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static LatencyCompensationTest sLatencyCompensationTest;
+
+}
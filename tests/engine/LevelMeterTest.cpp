@@ -0,0 +1,72 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/LevelMeter.h"
+
+namespace Element {
+
+class LevelMeterTest : public UnitTestBase
+{
+public:
+    LevelMeterTest() : UnitTestBase ("Level Meter", "engine", "levelMeter") { }
+    virtual ~LevelMeterTest() { }
+
+    void runTest() override
+    {
+        beginTest ("measure matches AudioBuffer");
+        Random random (4321);
+        for (const int numSamples : { 1, 3, 4, 31, 64, 257, 1024 })
+        {
+            AudioSampleBuffer buffer (1, numSamples);
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample (0, i, random.nextFloat() * 2.f - 1.f);
+
+            float peak = 0.f, sumOfSquares = 0.f;
+            LevelMeter::measure (buffer.getReadPointer (0), numSamples, peak, sumOfSquares);
+            expectEquals (peak, buffer.getMagnitude (0, 0, numSamples));
+            expectWithinAbsoluteError (std::sqrt (sumOfSquares / (float) numSamples),
+                                       buffer.getRMSLevel (0, 0, numSamples), 0.0001f);
+        }
+
+        beginTest ("readings are decimated");
+        LevelMeter meter;
+        meter.prepare (2, 48000.0, 30.0); // 1600 samples a reading
+        AudioSampleBuffer block (2, 512);
+        block.clear();
+        block.setSample (1, 100, -0.5f);
+        int numReadings = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            meter.addChannel (0, block.getReadPointer (0), block.getNumSamples());
+            meter.addChannel (1, block.getReadPointer (1), block.getNumSamples());
+            if (meter.advance (block.getNumSamples()))
+            {
+                ++numReadings;
+                expectEquals (meter.getPeak (0), 0.f);
+                expectEquals (meter.getPeak (1), 0.5f);
+                meter.reset();
+            }
+        }
+        expectEquals (numReadings, 2);
+    }
+};
+
+static LevelMeterTest sLevelMeterTest;
+
+}
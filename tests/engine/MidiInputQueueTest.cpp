@@ -0,0 +1,293 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/FixedMidiBuffer.h"
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+class MidiInputQueueTest : public UnitTestBase
+{
+public:
+    MidiInputQueueTest() : UnitTestBase ("MIDI Input Queue", "engine", "midiInputQueue") { }
+    virtual ~MidiInputQueueTest() { }
+
+    void runTest() override
+    {
+        testClock();
+        testJitter();
+        testOffsets();
+        testParts();
+        testSysex();
+        testOverflow();
+        testDevices();
+        testRealtime();
+    }
+
+private:
+    // 10 ms blocks, chosen so block times are exact in binary
+    static const int blockSize = 640;
+    static constexpr double sampleRate = 64000.0;
+
+    void testClock()
+    {
+        beginTest ("times map into the previous block period");
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        clock.update (1000.0, blockSize);
+        clock.update (1010.0, blockSize);
+        clock.update (1020.0, blockSize);
+        expectEquals (clock.getWindowStart(), 1010.0);
+        expectEquals (clock.getWindowEnd(), 1020.0);
+        expectEquals (clock.getSampleOffset (1015.0, blockSize), blockSize / 2);
+        expectEquals (clock.getSampleOffset (1005.0, blockSize), 0);
+        expectEquals (clock.getSampleOffset (1030.0, blockSize), blockSize - 1);
+    }
+
+    void testJitter()
+    {
+        beginTest ("callback jitter is smoothed");
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        Random random (1234);
+        double minLength = 1000.0, maxLength = 0.0;
+
+        for (int i = 0; i < 200; ++i)
+        {
+            const double jitter = 4.0 * random.nextDouble() - 2.0;
+            clock.update (1000.0 + 10.0 * i + jitter, blockSize);
+            if (i < 10)
+                continue;
+            const double length = clock.getWindowEnd() - clock.getWindowStart();
+            minLength = jmin (minLength, length);
+            maxLength = jmax (maxLength, length);
+        }
+
+        expectGreaterThan (minLength, 9.0);
+        expectLessThan (maxLength, 11.0);
+    }
+
+    void testOffsets()
+    {
+        beginTest ("events keep their place and wait for their block");
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        clock.update (1000.0, blockSize);
+        clock.update (1010.0, blockSize);
+
+        MidiInputQueue queue;
+        push (queue, MidiMessage::noteOn (1, 60, 1.f), 1002.0);
+        push (queue, MidiMessage::noteOn (1, 61, 1.f), 1007.0);
+        push (queue, MidiMessage::noteOn (1, 62, 1.f), 1012.0);
+
+        MidiBuffer midi;
+        queue.pull (midi, clock, blockSize);
+        expectEquals (midi.getNumEvents(), 2);
+        expectEquals (queue.getNumReady(), 1);
+        FixedMidiBuffer::Reader reader (midi);
+        expectEquals (reader.getTime(), 128);
+        expectEquals ((int) reader.getData()[1], 60);
+        reader.next();
+        expectEquals (reader.getTime(), 448);
+        expectEquals ((int) reader.getData()[1], 61);
+
+        midi.clear();
+        clock.update (1020.0, blockSize);
+        queue.pull (midi, clock, blockSize);
+        expectEquals (midi.getNumEvents(), 1);
+        expectEquals (queue.getNumReady(), 0);
+        expectEquals (FixedMidiBuffer::Reader (midi).getTime(), 128);
+
+        beginTest ("messages without a usable timestamp are stamped on arrival");
+        expect (queue.push (MidiMessage::noteOn (1, 63, 1.f)));
+        expect (queue.push (MidiMessage::noteOn (1, 64, 1.f).withTimeStamp (Time::getMillisecondCounterHiRes())));
+        clock.reset (sampleRate);
+        clock.update (Time::getMillisecondCounterHiRes() + 1.0, blockSize);
+        midi.clear();
+        queue.pull (midi, clock, blockSize);
+        expectEquals (midi.getNumEvents(), 2);
+    }
+
+    void testParts()
+    {
+        beginTest ("the parts of a split block share its window");
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        clock.update (1000.0, blockSize);
+        clock.update (1010.0, blockSize);
+
+        const auto first  = clock.getPart (0, blockSize / 4, blockSize);
+        const auto second = clock.getPart (blockSize / 4, blockSize * 3 / 4, blockSize);
+        expectEquals (first.getWindowStart(), 1000.0);
+        expectEquals (first.getWindowEnd(), 1002.5);
+        expectEquals (second.getWindowStart(), 1002.5);
+        expectEquals (second.getWindowEnd(), 1010.0);
+
+        MidiInputQueue queue;
+        push (queue, MidiMessage::noteOn (1, 60, 1.f), 1001.0);
+        push (queue, MidiMessage::noteOn (1, 61, 1.f), 1006.0);
+
+        MidiBuffer midi;
+        queue.pull (midi, first, blockSize / 4);
+        expectEquals (midi.getNumEvents(), 1);
+        expectEquals (FixedMidiBuffer::Reader (midi).getTime(), 64);
+
+        midi.clear();
+        queue.pull (midi, second, blockSize * 3 / 4);
+        expectEquals (midi.getNumEvents(), 1);
+        expectEquals (FixedMidiBuffer::Reader (midi).getTime(), 224);
+        expectEquals (queue.getNumReady(), 0);
+    }
+
+    void testSysex()
+    {
+        beginTest ("sysex survives the byte ring wrapping");
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        clock.update (1000.0, blockSize);
+        MidiInputQueue queue (16, 256);
+        MidiBuffer midi;
+        bool intact = true;
+
+        for (int i = 0; i < 50; ++i)
+        {
+            uint8 data [100];
+            for (int j = 0; j < 100; ++j)
+                data[j] = (uint8) ((i + j) & 0x7f);
+            const auto message = MidiMessage::createSysExMessage (data, 100);
+            push (queue, message, 995.0);
+
+            midi.clear();
+            queue.pull (midi, clock, blockSize);
+            FixedMidiBuffer::Reader reader (midi);
+            intact &= midi.getNumEvents() == 1
+                && reader.getNumBytes() == message.getRawDataSize()
+                && 0 == memcmp (reader.getData(), message.getRawData(), (size_t) message.getRawDataSize());
+        }
+
+        expect (intact, "sysex was corrupted");
+    }
+
+    void testOverflow()
+    {
+        beginTest ("full queues drop and count");
+        FixedMidiBuffer::resetNumDroppedEvents();
+        MidiInputQueue queue (4, 64);
+        int numAdded = 0;
+        for (int i = 0; i < 10; ++i)
+            if (push (queue, MidiMessage::noteOn (1, 60, 1.f), 1000.0))
+                ++numAdded;
+        expectEquals (numAdded, 4);
+
+        uint8 data [100] = { 0 };
+        queue.clear();
+        expect (! push (queue, MidiMessage::createSysExMessage (data, 100), 1000.0));
+        expectEquals (FixedMidiBuffer::getNumDroppedEvents(), (int64) 7);
+        FixedMidiBuffer::resetNumDroppedEvents();
+    }
+
+    void testDevices()
+    {
+        beginTest ("every device and the shared queue are pulled");
+        // never dereferenced, only used to tell sources apart
+        auto* const deviceA = reinterpret_cast<MidiInput*> ((pointer_sized_int) 0x10);
+        auto* const deviceB = reinterpret_cast<MidiInput*> ((pointer_sized_int) 0x20);
+        const double now = Time::getMillisecondCounterHiRes();
+
+        MidiInputQueueSet queues (1);
+        queues.push (deviceA, "A", MidiMessage::noteOn (1, 60, 1.f).withTimeStamp (0.001 * (now - 6.0)));
+        queues.push (deviceB, "B", MidiMessage::noteOn (1, 61, 1.f).withTimeStamp (0.001 * (now - 4.0)));
+        queues.push (nullptr, MidiMessage::noteOn (1, 62, 1.f).withTimeStamp (0.001 * (now - 8.0)));
+
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        clock.update (now, blockSize);
+        MidiBuffer midi;
+        queues.pull (midi, clock, blockSize);
+
+        expectEquals (midi.getNumEvents(), 3);
+        int lastFrame = -1, lastNote = 0;
+        bool ordered = true;
+        for (FixedMidiBuffer::Reader reader (midi); ! reader.isDone(); reader.next())
+        {
+            ordered &= reader.getTime() > lastFrame;
+            lastFrame = reader.getTime();
+            lastNote = reader.getData()[1];
+        }
+        expect (ordered, "events are out of order");
+        expectEquals (lastNote, 61);
+
+        beginTest ("a device opened again gets its old queue");
+        auto* const reopenedA = reinterpret_cast<MidiInput*> ((pointer_sized_int) 0x30);
+        MidiInputQueueSet named (3);
+        named.push (deviceA, "A", MidiMessage::noteOn (1, 60, 1.f).withTimeStamp (0.001 * (now - 6.0)));
+        named.push (reopenedA, "A", MidiMessage::noteOn (1, 61, 1.f).withTimeStamp (0.001 * (now - 5.0)));
+        named.push (deviceB, "B", MidiMessage::noteOn (1, 62, 1.f).withTimeStamp (0.001 * (now - 4.0)));
+        expectEquals (named.getNumDevices(), 2);
+
+        midi.clear();
+        named.pull (midi, clock, blockSize);
+        expectEquals (midi.getNumEvents(), 3);
+    }
+
+    void testRealtime()
+    {
+        beginTest ("pulling doesn't allocate or lock");
+        MidiInputClock clock;
+        clock.reset (sampleRate);
+        MidiInputQueue queue;
+        MidiBuffer midi;
+        FixedMidiBuffer::reserve (midi);
+        uint8 data [64] = { 0 };
+        const auto sysex = MidiMessage::createSysExMessage (data, 64);
+        const auto controller = MidiMessage::controllerEvent (1, 7, 64);
+        bool complete = true;
+        AllocationCounter::reset();
+
+        for (int b = 0; b < 16; ++b)
+        {
+            const double blockStart = 1000.0 + 10.0 * b;
+            for (int e = 0; e < 8; ++e)
+                push (queue, controller, blockStart - 9.0 + e);
+            push (queue, sysex, blockStart - 1.0);
+
+            {
+                const AllocationCounter::ScopedRender rendering;
+                clock.update (blockStart, blockSize);
+                midi.clear();
+                queue.pull (midi, clock, blockSize);
+            }
+
+            complete &= midi.getNumEvents() == 9;
+        }
+
+        expect (complete, "events went missing");
+        expectRealtimeSafe();
+    }
+
+    static bool push (MidiInputQueue& queue, const MidiMessage& message, const double time)
+    {
+        return queue.push (message.getRawData(), message.getRawDataSize(), time);
+    }
+};
+
+static MidiInputQueueTest sMidiInputQueueTest;
+
+}
@@ -0,0 +1,95 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class MultiCoreRenderTest : public UnitTestBase
+{
+public:
+    MultiCoreRenderTest() : UnitTestBase ("Multi-Core Rendering", "engine", "multiCore") { }
+    virtual ~MultiCoreRenderTest() { }
+
+    void runTest() override
+    {
+        beginTest ("parallel output matches serial output");
+        AudioSampleBuffer serial, parallel;
+        render (serial, false);
+        render (parallel, true);
+
+        bool identical = serial.getNumSamples() == parallel.getNumSamples();
+        for (int c = 0; identical && c < serial.getNumChannels(); ++c)
+            identical = 0 == memcmp (serial.getReadPointer (c), parallel.getReadPointer (c),
+                                     sizeof (float) * (size_t) serial.getNumSamples());
+        expect (identical, "multi-core output differs from single-core output");
+    }
+
+private:
+    static const int blockSize = 256;
+    static const int numBlocks = 8;
+    static const int numBranches = 6;
+
+    void render (AudioSampleBuffer& result, const bool multiCore)
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.setMultiCoreRendering (multiCore);
+
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+
+        for (int i = 0; i < numBranches; ++i)
+        {
+            auto* const volume = new VolumeProcessor (-60.0, 12.0, true);
+            volume->getParameters().getUnchecked(0)->setValue (0.1f + 0.13f * (float) i);
+            GraphNodePtr node = graph.addNode (volume);
+            input->connectAudioTo (node);
+            node->connectAudioTo (output);
+        }
+
+        // compiles the rendering sequence synchronously
+        graph.prepareToPlay (44100.0, blockSize);
+
+        Random random (1234);
+        result.setSize (2, blockSize * numBlocks);
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int c = 0; c < 2; ++c)
+                for (int s = 0; s < blockSize; ++s)
+                    block.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+            midi.clear();
+            AllocationCounter::reset();
+            graph.processBlock (block, midi);
+            expectRealtimeSafe();
+            for (int c = 0; c < 2; ++c)
+                result.copyFrom (c, b * blockSize, block, c, 0, blockSize);
+        }
+
+        input = output = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static MultiCoreRenderTest sMultiCoreRenderTest;
+
+}
@@ -0,0 +1,86 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class NodeProfileTest : public UnitTestBase
+{
+public:
+    NodeProfileTest() : UnitTestBase ("Node Profiling", "engine", "nodeProfile") { }
+    virtual ~NodeProfileTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("nothing is recorded while disabled");
+        NodeProfile::setEnabled (false);
+        render (graph);
+        expect (volume->getProfileStats().numBlocks == 0);
+
+        beginTest ("every block is recorded while enabled");
+        NodeProfile::setEnabled (true);
+        render (graph);
+        auto stats = volume->getProfileStats();
+        expect (stats.numBlocks == numBlocks);
+        expect (stats.meanMicros <= stats.maxMicros);
+        expect (stats.p99Micros <= stats.maxMicros);
+        expect (stats.load >= 0.0);
+
+        beginTest ("reset");
+        volume->getProfile().reset();
+        expect (volume->getProfileStats().numBlocks == 0);
+        render (graph);
+        expect (volume->getProfileStats().numBlocks == numBlocks);
+        NodeProfile::setEnabled (false);
+
+        input = output = volume = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 256;
+    static const int numBlocks = 16;
+
+    void render (GraphProcessor& graph)
+    {
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            block.clear();
+            block.setSample (0, 0, 1.f);
+            midi.clear();
+            graph.processBlock (block, midi);
+        }
+    }
+};
+
+static NodeProfileTest sNodeProfileTest;
+
+}
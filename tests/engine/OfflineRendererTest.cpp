@@ -0,0 +1,221 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/OfflineRenderer.h"
+
+namespace Element {
+
+class OfflineRendererTest : public UnitTestBase
+{
+public:
+    OfflineRendererTest() : UnitTestBase ("Offline Renderer", "engine", "offlineRender") { }
+    virtual ~OfflineRendererTest() { }
+
+    void initialise() override
+    {
+        initializeWorld();
+    }
+
+    void shutdown() override
+    {
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        const File dir (File::createTempFile ("render"));
+        dir.createDirectory();
+        const File sessionFile (getDataDir().getChildFile ("Sessions/Default.els"));
+        getAppController().findChild<SessionController>()->openFile (sessionFile);
+        runDispatchLoop (40);
+
+        beginTest ("command line");
+        {
+            File source;
+            OfflineRenderer::Options options;
+            const String commandLine = "--render \"" + sessionFile.getFullPathName() + "\" --output=\""
+                + dir.getChildFile ("out put.flac").getFullPathName() + "\" --rate=48000 --block=256 --length=3.5 --all-graphs";
+            expect (OfflineRenderer::parseCommandLine (commandLine, source, options).wasOk());
+            expect (source == sessionFile);
+            expect (options.outputFile == dir.getChildFile ("out put.flac"));
+            expectEquals (options.sampleRate, 48000.0);
+            expectEquals (options.blockSize, 256);
+            expectEquals (options.lengthSeconds, 3.5);
+            expect (options.allGraphs);
+            expect (OfflineRenderer::parseCommandLine ("--render --output=x.wav", source, options).failed());
+        }
+
+        OfflineRenderer renderer (*getWorld().getAudioEngine());
+
+        beginTest ("renders the requested length");
+        {
+            OfflineRenderer::Options options;
+            options.outputFile = dir.getChildFile ("length.wav");
+            options.lengthSeconds = 1.0;
+            options.blockSize = 300;
+            expect (renderer.render (options).wasOk());
+            expectEquals (getLengthInSamples (options.outputFile), (int64) 44100);
+            expectEquals (renderer.getStats().numSamples, (int64) 44100);
+        }
+
+        beginTest ("length follows the MIDI file");
+        {
+            OfflineRenderer::Options options;
+            options.outputFile = dir.getChildFile ("midi.wav");
+            options.midiFile = dir.getChildFile ("notes.mid");
+            options.tailSeconds = 0.5;
+            writeMidiFile (options.midiFile);
+            expect (renderer.render (options).wasOk());
+            expectEquals (getLengthInSamples (options.outputFile), (int64) (44100 * 3 / 2));
+        }
+
+        beginTest ("MIDI plays the graph, the same every time");
+        {
+            // a gate on the active graph outputs a level while the note is held
+            auto* const graph = getWorld().getAudioEngine()->getGraph (getWorld().getAudioEngine()->getActiveGraph());
+            expect (graph != nullptr);
+            GraphNodePtr midiIn = graph->addNode (new IOProcessor (IOProcessor::midiInputNode));
+            GraphNodePtr output = graph->addNode (new IOProcessor (IOProcessor::audioOutputNode));
+            GraphNodePtr gate   = graph->addNode (new NoteGate());
+            graph->connectChannels (PortType::Midi, midiIn->nodeId, 0, gate->nodeId, 0);
+            gate->connectAudioTo (output);
+
+            OfflineRenderer::Options options;
+            options.midiFile = dir.getChildFile ("notes.mid");
+            options.tailSeconds = 0.5;
+            options.blockSize = 300;
+            AudioSampleBuffer first, second;
+            options.outputFile = dir.getChildFile ("first.wav");
+            expect (renderer.render (options).wasOk());
+            readSamples (options.outputFile, first);
+            options.outputFile = dir.getChildFile ("second.wav");
+            expect (renderer.render (options).wasOk());
+            readSamples (options.outputFile, second);
+
+            // the note is held from a quarter second to one second
+            const int numSamples = first.getNumSamples();
+            const int noteOn = 11025, noteOff = 44100, margin = 64;
+            expectEquals (numSamples, 44100 * 3 / 2);
+            expectEquals (first.getMagnitude (0, 0, noteOn - margin), 0.f);
+            const auto held = first.findMinMax (0, noteOn + margin, noteOff - noteOn - 2 * margin);
+            expectWithinAbsoluteError (held.getStart(), NoteGate::level, 0.0001f);
+            expectWithinAbsoluteError (held.getEnd(), NoteGate::level, 0.0001f);
+            expectEquals (first.getMagnitude (0, noteOff + margin, numSamples - noteOff - margin), 0.f);
+
+            bool identical = second.getNumSamples() == numSamples;
+            for (int c = 0; identical && c < first.getNumChannels(); ++c)
+                identical = 0 == memcmp (first.getReadPointer (c), second.getReadPointer (c),
+                                         sizeof (float) * (size_t) numSamples);
+            expect (identical, "rendering twice gave different samples");
+
+            graph->removeNode (gate->nodeId);
+            graph->removeNode (output->nodeId);
+            graph->removeNode (midiIn->nodeId);
+            midiIn = output = gate = nullptr;
+        }
+
+        beginTest ("fails without a length or MIDI file");
+        {
+            OfflineRenderer::Options options;
+            options.outputFile = dir.getChildFile ("none.wav");
+            expect (renderer.render (options).failed());
+        }
+
+        dir.deleteRecursively();
+    }
+
+private:
+    /** Outputs a constant level while any note is held */
+    class NoteGate : public PlaceholderProcessor
+    {
+    public:
+        static constexpr float level = 0.5f;
+
+        NoteGate() : PlaceholderProcessor (2, 2, true, false) { }
+
+        void processBlock (AudioBuffer<float>& audio, MidiBuffer& midi) override
+        {
+            int start = 0;
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                fill (audio, start, frame);
+                if (msg.isNoteOn())
+                    ++numHeld;
+                else if (msg.isNoteOff() && numHeld > 0)
+                    --numHeld;
+                start = frame;
+            }
+
+            fill (audio, start, audio.getNumSamples());
+            midi.clear();
+        }
+
+    private:
+        int numHeld = 0;
+
+        void fill (AudioBuffer<float>& audio, const int start, const int end)
+        {
+            for (int c = 0; c < audio.getNumChannels(); ++c)
+                FloatVectorOperations::fill (audio.getWritePointer (c, start),
+                                             numHeld > 0 ? level : 0.f, end - start);
+        }
+    };
+
+    static void readSamples (const File& file, AudioSampleBuffer& samples)
+    {
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatReader> reader (wav.createReaderFor (file.createInputStream(), true));
+        samples.setSize (2, reader != nullptr ? (int) reader->lengthInSamples : 0);
+        samples.clear();
+        if (reader != nullptr)
+            reader->read (&samples, 0, samples.getNumSamples(), 0, true, true);
+    }
+
+    static int64 getLengthInSamples (const File& file)
+    {
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatReader> reader (wav.createReaderFor (file.createInputStream(), true));
+        return reader != nullptr ? reader->lengthInSamples : -1;
+    }
+
+    /** A note from a quarter second to one second, at the default 120 BPM */
+    static void writeMidiFile (const File& file)
+    {
+        MidiMessageSequence track;
+        track.addEvent (MidiMessage::noteOn (1, 60, 1.f), 480.0);
+        track.addEvent (MidiMessage::noteOff (1, 60), 1920.0);
+        track.updateMatchedPairs();
+
+        MidiFile midiFile;
+        midiFile.setTicksPerQuarterNote (960);
+        midiFile.addTrack (track);
+        file.deleteFile();
+        FileOutputStream stream (file);
+        midiFile.writeTo (stream);
+    }
+};
+
+constexpr float OfflineRendererTest::NoteGate::level;
+
+static OfflineRendererTest sOfflineRendererTest;
+
+}
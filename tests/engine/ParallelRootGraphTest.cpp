@@ -0,0 +1,97 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+
+namespace Element {
+
+class ParallelRootGraphTest : public UnitTestBase
+{
+public:
+    ParallelRootGraphTest() : UnitTestBase ("Parallel Root Graphs", "engine", "parallelRoots") { }
+    virtual ~ParallelRootGraphTest() { }
+
+    void runTest() override
+    {
+        AudioEnginePtr engine = new AudioEngine (getWorld());
+        OwnedArray<RootGraph> graphs;
+        for (int i = 0; i < numGraphs; ++i)
+        {
+            auto* const graph = graphs.add (new RootGraph());
+            graph->setRenderMode (RootGraph::Parallel);
+            engine->addGraph (graph);
+        }
+
+        engine->prepareExternalPlayback (44100.0, blockSize, 2, 2);
+        for (auto* const graph : graphs)
+        {
+            GraphNodePtr input  = graph->addNode (new IOProcessor (IOProcessor::audioInputNode));
+            GraphNodePtr output = graph->addNode (new IOProcessor (IOProcessor::audioOutputNode));
+            input->connectAudioTo (output);
+        }
+
+        // compiles the rendering sequences synchronously
+        engine->prepareExternalPlayback (44100.0, blockSize, 2, 2);
+
+        beginTest ("parallel graphs are summed in a fixed order");
+        Random random (4321);
+        AudioSampleBuffer audio (2, blockSize), expected (2, blockSize);
+        MidiBuffer midi;
+        bool identical = true;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int c = 0; c < 2; ++c)
+                for (int s = 0; s < blockSize; ++s)
+                    audio.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+
+            expected.clear();
+            for (int g = 0; g < numGraphs; ++g)
+                for (int c = 0; c < 2; ++c)
+                    expected.addFrom (c, 0, audio, c, 0, blockSize);
+
+            midi.clear();
+            AllocationCounter::reset();
+            engine->processExternalBuffers (audio, midi);
+            expectRealtimeSafe();
+
+            for (int c = 0; identical && c < 2; ++c)
+                identical = 0 == memcmp (audio.getReadPointer (c), expected.getReadPointer (c),
+                                         sizeof (float) * (size_t) blockSize);
+        }
+
+        expect (identical, "mixed output differs from the serial sum of the graphs");
+
+        engine->releaseExternalResources();
+        for (auto* const graph : graphs)
+        {
+            engine->removeGraph (graph);
+            graph->clear();
+        }
+    }
+
+private:
+    static const int blockSize = 256;
+    static const int numBlocks = 16;
+    static const int numGraphs = 4;
+};
+
+static ParallelRootGraphTest sParallelRootGraphTest;
+
+}
@@ -0,0 +1,152 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/FixedMidiBuffer.h"
+
+namespace Element {
+
+class PipelineRenderTest : public UnitTestBase
+{
+public:
+    PipelineRenderTest() : UnitTestBase ("Pipelined Rendering", "engine", "pipeline") { }
+    virtual ~PipelineRenderTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        GraphNodePtr input   = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output  = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr midiIn  = graph.addNode (new IOProcessor (IOProcessor::midiInputNode));
+        GraphNodePtr midiOut = graph.addNode (new IOProcessor (IOProcessor::midiOutputNode));
+
+        GraphNodePtr previous = input;
+        for (int i = 0; i < chainLength; ++i)
+        {
+            GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            previous->connectAudioTo (volume);
+            previous = volume;
+        }
+        previous->connectAudioTo (output);
+        graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, midiOut->nodeId, 0);
+
+        beginTest ("a single stage adds no latency");
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getLatencySamples(), 0);
+        expectDelayedBy (graph, 0);
+
+        beginTest ("each stage boundary adds a block of latency");
+        graph.setPipelineStages (numStages);
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getLatencySamples(), (numStages - 1) * blockSize);
+        expectDelayedBy (graph, (numStages - 1) * blockSize);
+
+        beginTest ("turning pipelining off removes the latency");
+        graph.setPipelineStages (1);
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getLatencySamples(), 0);
+
+        input = output = midiIn = midiOut = previous = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 128;
+    static const int chainLength = 6;
+    static const int numStages = 3;
+
+    /** Renders noise and notes in blocks of varying size, expecting both to come
+        out unchanged and exactly numSamplesDelay later */
+    void expectDelayedBy (GraphProcessor& graph, const int numSamplesDelay)
+    {
+        const int sizes[] = { blockSize, blockSize / 2 + 3, 1, blockSize - 4, blockSize, 17, blockSize };
+        int total = 0;
+        for (const int size : sizes)
+            total += size;
+
+        Random random (numSamplesDelay);
+        AudioSampleBuffer source (2, total), result (2, total);
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < total; ++s)
+                source.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+
+        const int noteTime = blockSize / 3;
+        Array<int> noteTimes;
+        AudioSampleBuffer block;
+        MidiBuffer midi;
+        FixedMidiBuffer::reserve (midi);
+        int start = 0;
+
+        for (const int size : sizes)
+        {
+            block.setSize (2, size, false, false, true);
+            for (int c = 0; c < 2; ++c)
+                block.copyFrom (c, 0, source, c, start, size);
+
+            midi.clear();
+            if (noteTime >= start && noteTime < start + size)
+                midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), noteTime - start);
+
+            AllocationCounter::reset();
+            graph.processBlock (block, midi);
+            expectRealtimeSafe();
+
+            for (int c = 0; c < 2; ++c)
+                result.copyFrom (c, start, block, c, 0, size);
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+                noteTimes.add (start + frame);
+
+            start += size;
+        }
+
+        bool delayed = true;
+        for (int c = 0; delayed && c < 2; ++c)
+        {
+            for (int s = 0; delayed && s < total; ++s)
+            {
+                const float expected = s < numSamplesDelay ? 0.f : source.getSample (c, s - numSamplesDelay);
+                delayed = result.getSample (c, s) == expected;
+            }
+        }
+        expect (delayed, "audio was not delayed by exactly the reported latency");
+
+        expectEquals (noteTimes.size(), noteTime + numSamplesDelay < total ? 1 : 0);
+        if (noteTimes.size() > 0)
+            expectEquals (noteTimes.getFirst(), noteTime + numSamplesDelay);
+
+        // clear out anything still in the pipeline
+        block.setSize (2, blockSize, false, false, true);
+        for (int i = 0; i < numStages; ++i)
+        {
+            block.clear();
+            midi.clear();
+            graph.processBlock (block, midi);
+        }
+    }
+};
+
+static PipelineRenderTest sPipelineRenderTest;
+
+}
@@ -0,0 +1,72 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/AllocationCounter.h"
+
+namespace Element {
+
+class RealtimeAuditTest : public UnitTestBase
+{
+public:
+    RealtimeAuditTest() : UnitTestBase ("Real-time Audit", "engine", "realtimeAudit") { }
+    virtual ~RealtimeAuditTest() { }
+
+    void runTest() override
+    {
+        if (! AllocationCounter::isEnabled())
+        {
+            logMessage ("real-time audit is not compiled in");
+            return;
+        }
+
+        beginTest ("calls made while rendering are recorded");
+        AllocationCounter::reset();
+        {
+            const AllocationCounter::ScopedRender rendering;
+            allocated.reset (new int (1));
+            allocated.reset();
+            const ScopedLock sl (lock);
+        }
+
+        expectEquals (AllocationCounter::getCount(), (int64) 1);
+       #if JUCE_LINUX
+        // the allocation, the free and the lock
+        expectEquals (AllocationCounter::getNumViolations(), (int64) 3);
+        expect (AllocationCounter::createReport().contains ("mutex lock"));
+       #endif
+
+        beginTest ("threads which aren't rendering are ignored");
+        AllocationCounter::reset();
+        allocated.reset (new int (1));
+        allocated.reset();
+        {
+            const ScopedLock sl (lock);
+        }
+        expectEquals (AllocationCounter::getNumViolations(), (int64) 0);
+    }
+
+private:
+    std::unique_ptr<int> allocated;
+    CriticalSection lock;
+};
+
+static RealtimeAuditTest sRealtimeAuditTest;
+
+}
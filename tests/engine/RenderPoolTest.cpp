@@ -0,0 +1,110 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/RenderPool.h"
+
+namespace Element {
+
+class RenderPoolTest : public UnitTestBase
+{
+public:
+    RenderPoolTest() : UnitTestBase ("Render Pool", "engine", "renderPool") { }
+    virtual ~RenderPoolTest() { }
+
+    void runTest() override
+    {
+        testTaskCounter();
+        testRun();
+    }
+
+private:
+    void testTaskCounter()
+    {
+        beginTest ("task counter hands out each task once per generation");
+        RenderPool::TaskCounter tasks;
+        expectEquals (tasks.claim(), -1);
+
+        tasks.reset (3);
+        expectEquals (tasks.claim(), 0);
+        expectEquals (tasks.claim(), 1);
+        expectEquals (tasks.claim(), 2);
+        expectEquals (tasks.claim(), -1);
+
+        tasks.reset (2);
+        expectEquals (tasks.claim(), 0);
+        expectEquals (tasks.claim(), 1);
+        expectEquals (tasks.claim(), -1);
+    }
+
+    struct CountingJob : public RenderPool::Job
+    {
+        enum { numTasks = 64 };
+
+        void prepare() noexcept
+        {
+            remaining = numTasks;
+            tasks.reset (numTasks);
+        }
+
+        bool performNextTask() override
+        {
+            const int index = tasks.claim();
+            if (index < 0)
+                return false;
+            ++counts[index];
+            --remaining;
+            return true;
+        }
+
+        bool isFinished() const override { return remaining.get() <= 0; }
+
+        RenderPool::TaskCounter tasks;
+        Atomic<int> remaining { 0 };
+        Atomic<int> counts [numTasks];
+    };
+
+    void testRun()
+    {
+        beginTest ("every task runs exactly once per block");
+        SharedResourcePointer<RenderPool> pool;
+        pool->start();
+
+        CountingJob job;
+        const int numBlocks = 500;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            job.prepare();
+            pool->run (job);
+        }
+
+        bool exact = true;
+        for (int i = 0; i < CountingJob::numTasks; ++i)
+            exact &= job.counts[i].get() == numBlocks;
+        expect (exact, "a task was skipped or run twice");
+
+        // nothing is in the pool anymore, so late workers let go eventually
+        pool->waitForRelease (pool->getEpoch());
+        expect (pool->isReleased (pool->getEpoch()));
+    }
+};
+
+static RenderPoolTest sRenderPoolTest;
+
+}
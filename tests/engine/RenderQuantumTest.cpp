@@ -0,0 +1,128 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/AllocationCounter.h"
+#include "engine/FixedMidiBuffer.h"
+
+namespace Element {
+
+class RenderQuantumTest : public UnitTestBase
+{
+public:
+    RenderQuantumTest() : UnitTestBase ("Render Quantum", "engine", "renderQuantum") { }
+    virtual ~RenderQuantumTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        GraphNodePtr input   = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output  = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr midiIn  = graph.addNode (new IOProcessor (IOProcessor::midiInputNode));
+        GraphNodePtr midiOut = graph.addNode (new IOProcessor (IOProcessor::midiOutputNode));
+        GraphNodePtr volume  = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, midiOut->nodeId, 0);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("host blocks larger than the prepared size are split");
+        expectEquals (graph.getBufferFootprint().blockSize, blockSize);
+        expectRendersUnchanged (graph, blockSize * 7 + 13);
+
+        beginTest ("a render quantum splits every block");
+        graph.setRenderQuantum (quantum);
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getBufferFootprint().blockSize, quantum);
+        expectRendersUnchanged (graph, blockSize);
+        expectRendersUnchanged (graph, quantum / 2 + 1);
+
+        graph.resetNodeBlockCounts();
+        process (graph, blockSize);
+        const int64 split = graph.getNumNodeBlocksProcessed();
+        graph.setRenderQuantum (0);
+        graph.prepareToPlay (44100.0, blockSize);
+        graph.resetNodeBlockCounts();
+        process (graph, blockSize);
+        expectEquals (split, graph.getNumNodeBlocksProcessed() * (blockSize / quantum));
+
+        input = output = midiIn = midiOut = volume = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 256;
+    static const int quantum = 32;
+
+    AudioSampleBuffer block, expected;
+    MidiBuffer midi;
+
+    void process (GraphProcessor& graph, const int numSamples)
+    {
+        block.setSize (2, numSamples, false, false, true);
+        block.clear();
+        midi.clear();
+        graph.processBlock (block, midi);
+    }
+
+    void expectRendersUnchanged (GraphProcessor& graph, const int numSamples)
+    {
+        Random random (numSamples);
+        block.setSize (2, numSamples);
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < numSamples; ++s)
+                block.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+        expected.makeCopyOf (block);
+
+        midi.clear();
+        FixedMidiBuffer::reserve (midi);
+        const int times[] = { 0, quantum - 1, quantum, blockSize, numSamples - 1 };
+        for (const int time : times)
+            if (time < numSamples)
+                midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), time);
+        const int numEvents = midi.getNumEvents();
+
+        AllocationCounter::reset();
+        graph.processBlock (block, midi);
+        expectRealtimeSafe();
+
+        bool identical = true;
+        for (int c = 0; identical && c < 2; ++c)
+            identical = 0 == memcmp (block.getReadPointer (c), expected.getReadPointer (c),
+                                     sizeof (float) * (size_t) numSamples);
+        expect (identical, "audio changed when rendered in pieces");
+
+        expectEquals (midi.getNumEvents(), numEvents);
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0, index = 0;
+        while (iter.getNextEvent (msg, frame))
+        {
+            while (times[index] >= numSamples)
+                ++index;
+            expectEquals (frame, times[index++]);
+        }
+    }
+};
+
+static RenderQuantumTest sRenderQuantumTest;
+
+}
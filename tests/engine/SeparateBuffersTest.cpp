@@ -0,0 +1,103 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/AllocationCounter.h"
+
+namespace Element {
+
+class SeparateBuffersTest : public UnitTestBase
+{
+public:
+    SeparateBuffersTest() : UnitTestBase ("Separate I/O Buffers", "engine", "separateBuffers") { }
+    virtual ~SeparateBuffersTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("output matches in-place rendering and input is untouched");
+        expectMatchesInPlace (graph, blockSize);
+
+        beginTest ("split into a render quantum");
+        graph.setRenderQuantum (quantum);
+        graph.prepareToPlay (44100.0, blockSize);
+        expectMatchesInPlace (graph, blockSize);
+        expectMatchesInPlace (graph, quantum / 2 + 1);
+
+        input = output = volume = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 256;
+    static const int quantum = 32;
+
+    AudioSampleBuffer source, inPlace, separate;
+    MidiBuffer midi;
+
+    void expectMatchesInPlace (GraphProcessor& graph, const int numSamples)
+    {
+        Random random (numSamples);
+        source.setSize (2, numSamples);
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < numSamples; ++s)
+                source.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+
+        inPlace.makeCopyOf (source);
+        midi.clear();
+        graph.processBlock (inPlace, midi);
+
+        // stale data the graph has to overwrite, not mix with
+        separate.setSize (2, numSamples);
+        for (int c = 0; c < 2; ++c)
+            FloatVectorOperations::fill (separate.getWritePointer (c), 0.5f, numSamples);
+
+        const AudioSampleBuffer copyOfSource (source);
+        midi.clear();
+        AllocationCounter::reset();
+        graph.processBlock (source, separate, midi);
+        expectRealtimeSafe();
+
+        bool identical = true, untouched = true;
+        for (int c = 0; c < 2; ++c)
+        {
+            identical = identical && 0 == memcmp (separate.getReadPointer (c), inPlace.getReadPointer (c),
+                                                  sizeof (float) * (size_t) numSamples);
+            untouched = untouched && 0 == memcmp (source.getReadPointer (c), copyOfSource.getReadPointer (c),
+                                                  sizeof (float) * (size_t) numSamples);
+        }
+
+        expect (identical, "output differs from in-place rendering");
+        expect (untouched, "the input buffer was written to");
+    }
+};
+
+static SeparateBuffersTest sSeparateBuffersTest;
+
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class SilenceSkipTest : public UnitTestBase
+{
+public:
+    SilenceSkipTest() : UnitTestBase ("Silent Node Skipping", "engine", "skipSilence") { }
+    virtual ~SilenceSkipTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.setSilentNodeSkipping (true);
+
+        GraphNodePtr input  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("silent input is skipped");
+        graph.resetNodeBlockCounts();
+        render (graph, false);
+        expect (graph.getNumNodeBlocksSkipped() == numBlocks);
+        // IO nodes always render
+        expect (graph.getNumNodeBlocksProcessed() == 2 * numBlocks);
+
+        beginTest ("audible input is processed");
+        graph.resetNodeBlockCounts();
+        expect (render (graph, true) > 0.f);
+        expect (graph.getNumNodeBlocksSkipped() == 0);
+        expect (graph.getNumNodeBlocksProcessed() == 3 * numBlocks);
+
+        beginTest ("silence after audio clears the output");
+        expect (render (graph, false) == 0.f);
+
+        // a short block only makes the start of each buffer silent
+        beginTest ("silence in shorter blocks doesn't leave audio behind");
+        for (const bool skipping : { true, false })
+        {
+            graph.setSilentNodeSkipping (skipping);
+            for (const int shortSize : { 1, 17, blockSize / 2, blockSize - 1 })
+            {
+                expect (renderBlock (graph, blockSize, true) > 0.f);
+                renderBlock (graph, shortSize, false);
+                expectEquals (renderBlock (graph, blockSize, false), 0.f);
+
+                expect (renderBlock (graph, shortSize, true) > 0.f);
+                expectEquals (renderBlock (graph, blockSize, false), 0.f);
+                expectEquals (renderBlock (graph, shortSize, false), 0.f);
+            }
+        }
+
+        input = output = volume = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 256;
+    static const int numBlocks = 4;
+
+    /** Renders some blocks through the graph and returns the peak of the last one */
+    float render (GraphProcessor& graph, const bool audible)
+    {
+        Random random (1234);
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            block.clear();
+            for (int c = 0; audible && c < 2; ++c)
+                for (int s = 0; s < blockSize; ++s)
+                    block.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+            midi.clear();
+            graph.processBlock (block, midi);
+        }
+
+        return block.getMagnitude (0, blockSize);
+    }
+
+    /** Renders one block of numSamples and returns its peak */
+    float renderBlock (GraphProcessor& graph, const int numSamples, const bool audible)
+    {
+        Random random (numSamples);
+        AudioSampleBuffer block (2, numSamples);
+        MidiBuffer midi;
+
+        block.clear();
+        for (int c = 0; audible && c < 2; ++c)
+            for (int s = 0; s < numSamples; ++s)
+                block.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+        graph.processBlock (block, midi);
+        return block.getMagnitude (0, numSamples);
+    }
+};
+
+static SilenceSkipTest sSilenceSkipTest;
+
+}